@@ -15,6 +15,7 @@
 
 #include "constants.hpp"
 #include "util.hpp"
+#include "stringpool.hpp"
 
 using std::string;
 using std::vector;
@@ -393,6 +394,24 @@ public:
     return res;
   }
   
+  // the strings interned in the string pool: no intermediate vector of strings
+  vector<uint32_t> to_string_ids() const {
+    if(is_error()){
+      return stringtools::intern_strings(UNSET::STRING_VECTOR);
+    }
+    const SEXP &Rstr = Rexpr;
+    stringtools::StringPool &pool = stringtools::get_string_pool();
+    
+    uint n = Rf_length(Rstr);
+    vector<uint32_t> res;
+    res.reserve(n);
+    for(uint i=0 ; i<n ; ++i){
+      res.push_back(pool.intern(Rf_translateCharUTF8(STRING_ELT(Rstr, i))));
+    }
+    
+    return res;
+  }
+  
   operator bool() const {
     if(is_error()){
       return false;
@@ -203,6 +203,121 @@ inline bool is_R_numeric_vector(const string &x, vector<int> &values){
   return i == n;
 }
 
+//
+// data sets -------------------------------------------------------------------
+//
+
+// modification time of a file or folder, as an opaque stamp (0 if absent)
+inline int64_t path_stamp(const fs::path &p){
+  std::error_code ec;
+  const fs::file_time_type t = fs::last_write_time(p, ec);
+  return ec ? 0 : static_cast<int64_t>(t.time_since_epoch().count());
+}
+
+// fingerprint of the installed packages: the library folders and their modification time
+// NOTA: installing, updating or removing a package modifies the library folder
+uint64_t libraries_fingerprint(const vector<string> &all_lib_path){
+  const ToIndexHash hash;
+  uint64_t h = mix64(all_lib_path.size());
+  for(const auto &lib_path : all_lib_path){
+    h = hash_combine64(h, hash(lib_path));
+    h = hash_combine64(h, hash(path_stamp(lib_path)));
+  }
+  
+  return h;
+}
+
+vector<string> read_package_datasets(const fs::path &pkg_path, bool add_package){
+  
+  const fs::path meta_path = pkg_path / "Meta/data.rds";
+  vector<string> pkg_info = R::R_run("readRDS(" + str::dquote(util::format_path(meta_path.string())) + ")[, 1]");
+  
+  const string pkg = pkg_path.filename().string();
+  const bool is_default = pkg == "datasets";
+  const string suffix = ", package = \"" + pkg + "\"";
+  
+  vector<string> res;
+  for(const auto &s : pkg_info){
+    if(!str::str_contains(s, '(')){
+      if(is_default || !add_package){
+        res.push_back(s);
+      } else {
+        res.push_back(s + suffix);
+      }
+    }
+  }
+  
+  return res;
+}
+
+void update_package_datasets(CachedData &data_cached, const vector<fs::path> &all_pkg_path,
+                             bool add_package){
+  // the cache is updated incrementally, its vectors are:
+  // 0: all the data sets, sorted
+  // 1: the paths of the packages with a data.rds
+  // 2: their modification times
+  // 3: their number of data sets
+  // 4: the data sets of each package, concatenated
+  // => only the packages with a new modification time are read again
+  
+  // the previous scan: path => (modification time, first data set, number of data sets)
+  std::map<std::string_view, std::tuple<std::string_view, size_t, size_t>> previous;
+  const vector<std::string_view> *pprev_datasets = nullptr;
+  if(data_cached.exists() && data_cached.n_vectors() == 5){
+    const vector<std::string_view> &prev_paths = data_cached.get_cached_views(1);
+    const vector<std::string_view> &prev_stamps = data_cached.get_cached_views(2);
+    const vector<std::string_view> &prev_counts = data_cached.get_cached_views(3);
+    pprev_datasets = &data_cached.get_cached_views(4);
+    
+    size_t start = 0;
+    for(size_t k = 0 ; k < prev_paths.size() && k < prev_stamps.size() && k < prev_counts.size() ; ++k){
+      const size_t n = std::strtoull(string(prev_counts[k]).c_str(), nullptr, 10);
+      if(start + n > pprev_datasets->size()){
+        break;
+      }
+      
+      previous[prev_paths[k]] = {prev_stamps[k], start, n};
+      start += n;
+    }
+  }
+  
+  vector<string> all_paths, all_stamps, all_counts, all_pkg_datasets;
+  for(const auto &pkg_path : all_pkg_path){
+    
+    if(!fs::exists(pkg_path / "Meta/data.rds")){
+      continue;
+    }
+    
+    const string path = pkg_path.string();
+    const string stamp = std::to_string(path_stamp(pkg_path));
+    
+    vector<string> pkg_datasets;
+    auto loc = previous.find(path);
+    if(loc != previous.end() && std::get<0>(loc->second) == stamp){
+      // unchanged package
+      const auto &[prev_stamp, start, n] = loc->second;
+      for(size_t i = start ; i < start + n ; ++i){
+        pkg_datasets.emplace_back((*pprev_datasets)[i]);
+      }
+    } else {
+      pkg_datasets = read_package_datasets(pkg_path, add_package);
+    }
+    
+    all_paths.push_back(path);
+    all_stamps.push_back(stamp);
+    all_counts.push_back(std::to_string(pkg_datasets.size()));
+    util::append(all_pkg_datasets, pkg_datasets);
+  }
+  
+  vector<string> all_datasets = all_pkg_datasets;
+  util::vector_sort_unique(all_datasets);
+  
+  // NOTA: written even when empty => the fingerprint is stored and the
+  // libraries are not scanned again until they change
+  data_cached.set_cached_vectors({all_datasets, all_paths, all_stamps, all_counts, all_pkg_datasets},
+                                 CachedData::SIZE::UNEQUAL);
+}
+
 } // end anonymous namespace
 
 
@@ -382,7 +497,7 @@ AC_String RAutocomplete::suggest_introspection(){
   
   choices = std::move(values_unik);
   choices.set_meta("labels", std::move(labels));
-  choices.set_meta("is_char", is_char ? "true" : "false");
+  choices.set_meta("is_char", is_char);
   
   choices.set_finalize(AC_FINALIZE::INTROSPECTION);
   return choices;
@@ -438,9 +553,7 @@ AC_String RAutocomplete::suggest_package(bool add_colon){
   }
   
   if(add_colon){
-    for(auto &pkgs : *installed_packages.get_string_vec_ptr()){
-      pkgs += "::";
-    }
+    installed_packages.add_suffix("::");
     
     installed_packages.set_finalize(AC_FINALIZE::PACKAGE_EXPORT);
     
@@ -463,20 +576,17 @@ AC_String RAutocomplete::suggest_package(bool add_colon){
 
 AC_String RAutocomplete::suggest_CRAN_package(){
   // we run the internet search every 50 days
+  // => when outdated, the old list is used until the refresh, run when R is idle
   CachedData pkg_cached("CRAN_packages.txt");
   
-  if(pkg_cached.days_since_last_write() > 50){
-    // we invalidate the cache
-    AC_String pkgs = R::R_run("available.packages()[, \"Package\"]");
-    
-    if(pkgs.empty()){
-      pkgs.set_cause_empty("The list of available packages on CRAN could not be retrived");
-      return pkgs;
-    }
-    
-    pkg_cached.set_cached_vector(pkgs.get_string_vec());
+  pkg_cached.refresh_if_stale(CachedData::days(50), [](){
+    vector<string> pkgs = R::R_run("available.packages()[, \"Package\"]");
+    return pkgs.empty() ? vector<vector<string>>() : vector<vector<string>>{pkgs};
+  });
     
-    pkgs.set_finalize(AC_FINALIZE::QUOTE);
+  if(pkg_cached.is_unset()){
+    AC_String pkgs;
+    pkgs.set_cause_empty("The list of available packages on CRAN could not be retrived");
     return pkgs;
   }
   
@@ -607,9 +717,7 @@ AC_String RAutocomplete::suggest_argument(){
     return choices;
   }
   
-  for(auto &str : *arg_names.get_string_vec_ptr()){
-    str += " = ";
-  }
+  arg_names.add_suffix(" = ");
   
   arg_names.set_finalize(AC_FINALIZE::NONE);
   
@@ -753,36 +861,26 @@ AC_String RAutocomplete::suggest_functions(bool add_ls_functions){
     funs = R::R_run("grep(\"^[[:alpha:]]\", sort(unlist(lapply(" + loaded_NS + ", function(x) getNamespaceExports(x)))), value = TRUE)");
   }
   
+  // the three vectors are appended at once
   AC_String all_funs;
-  
-  if(!pkg_funs.empty()){
-    all_funs.push_back(pkg_funs);
-  }
-  
-  if(!ls_funs.empty()){
-    all_funs.push_back(ls_funs);
-  }
-  
-  all_funs.push_back(funs).set_finalize(AC_FINALIZE::FUNCTION);
+  all_funs.concat({&pkg_funs, &ls_funs, &funs}).set_finalize(AC_FINALIZE::FUNCTION);
   
   return all_funs;
 
 }
 
 AC_String RAutocomplete::suggest_all_datasets(){
+  // the cache is updated when packages are installed or removed
   
-  CachedData data_cached(get_Rversion() + "/datasets_extensive.txt");
-  
+  vector<string> all_lib_path = R::R_run(".libPaths()");
   
+  CachedData data_cached(get_Rversion() + "/datasets_extensive.txt");
+  data_cached.set_fingerprint_fun([&](){ return libraries_fingerprint(all_lib_path); });
   
-  if(data_cached.is_unset()){
+  if(data_cached.is_stale()){
     
-    vector<string> all_lib_path_str = R::R_run(".libPaths()");
-    vector<string> all_data_info;
-    
-    int index = 0;
-    for(const auto &lib_path_str : all_lib_path_str){
-      ++index;
+    vector<fs::path> all_pkg_path;
+    for(const auto &lib_path_str : all_lib_path){
       
       fs::path lib_path = lib_path_str;
       
@@ -791,36 +889,16 @@ AC_String RAutocomplete::suggest_all_datasets(){
       }
       
       for(auto &p : fs::directory_iterator(lib_path)){
-        const fs::path &meta_path = p.path() / "Meta/data.rds";
-        
-        if(fs::exists(meta_path)){
-          const string pkg = p.path().filename().string();
-          vector<string> pkg_info = R::R_run(
-            "readRDS(paste0(.libPaths()[" + std::to_string(index) + "], '/" + pkg + "/Meta/data.rds'))[, 1]"
-          );
-          const bool is_default = pkg == "datasets";
-          
-          const string suffix = ", package = \"" + pkg + "\"";
-          for(const auto &s : pkg_info){
-            if(!str::str_contains(s, '(')){
-              if(is_default){
-                all_data_info.push_back(s);
-              } else {
-                all_data_info.push_back(s + suffix);
-              }
-            }
-          }
-        }
+        all_pkg_path.push_back(p.path());
       }
     }
     
-    if(all_data_info.empty()){
-      return AC_String();
-    }
-    
-    util::vector_sort_unique(all_data_info);
-    
-    data_cached.set_cached_vector(all_data_info);
+    update_package_datasets(data_cached, all_pkg_path, true);
+  }
+  
+  // NOTA: no data set is stored as an empty vector
+  if(data_cached.is_unset() || data_cached.get_cached_views(0).empty()){
+    return AC_String();
   }
   
   AC_String all_data_sets = data_cached.get_cached_vector();
@@ -832,41 +910,24 @@ AC_String RAutocomplete::suggest_all_datasets(){
 
 AC_String RAutocomplete::suggest_basic_datasets(){
   
+  vector<string> all_lib_path = R::R_run(".libPaths()");
+  
   CachedData data_cached(get_Rversion() + "/datasets_basic.txt");
+  data_cached.set_fingerprint_fun([&](){ return libraries_fingerprint(all_lib_path); });
   
-  if(data_cached.is_unset()){
+  if(data_cached.is_stale()){
     
-    vector<string> all_dataset_names;
-    vector<string> all_libpath = R::R_run(".libPaths()");
-    for(const auto &libpath : all_libpath){
-      
-      fs::path path = fs::path{libpath + "/datasets/Meta/data.rds"};
-      
-      if(fs::exists(path)){
-        vector<string> dataset_names = R::R_run("readRDS(" + str::dquote(util::format_path(path.string())) + ")[, 1]");
-        if(!dataset_names.empty()){
-          util::append(all_dataset_names, dataset_names);
-        }
-      }
-    }
-    
-    if(all_dataset_names.empty()){
-      return AC_String();
-    }
-    
-    if(all_libpath.size() > 0){
-      util::vector_sort_unique(all_dataset_names);
-    }
-    
-    vector<string> clean_ds;
-    for(const auto &s : all_dataset_names){
-      if(!str::str_contains(s, '(')){
-        clean_ds.push_back(s);
-      }
+    vector<fs::path> all_pkg_path;
+    for(const auto &lib_path : all_lib_path){
+      all_pkg_path.push_back(fs::path{lib_path} / "datasets");
     }
     
-    data_cached.set_cached_vector(clean_ds);
-    
+    update_package_datasets(data_cached, all_pkg_path, false);
+  }
+  
+  // NOTA: no data set is stored as an empty vector
+  if(data_cached.is_unset() || data_cached.get_cached_views(0).empty()){
+    return AC_String();
   }
   
   AC_String all_data_sets = data_cached.get_cached_vector();
@@ -1020,30 +1081,77 @@ AC_String RAutocomplete::suggest_default(){
   
   AC_String vars = suggest_variables(query.size() >= 2);
   
-  choices.push_back(vars);
-  
-  bool early_suggest = query.size() == 1 && choices.empty();
+  bool early_suggest = query.size() == 1 && choices.empty() && vars.empty();
   
+  AC_String funs;
   if(query.size() >= 2 || early_suggest){
     // we add the functions
-    AC_String funs = suggest_functions(false);
-    choices.push_back(funs);
+    funs = suggest_functions(false);
   }
   
+  AC_String pkgs, ds;
   if(query.size() >= 3 || early_suggest){
     // adding packages + data sets suggestions
-    AC_String pkgs = suggest_package(true);
-    choices.push_back(pkgs);
-    AC_String ds = suggest_basic_datasets();
+    pkgs = suggest_package(true);
+    ds = suggest_basic_datasets();
     ds.set_finalize(AC_FINALIZE::NONE);
-    choices.push_back(ds);
   }
   
+  // all the suggestions are appended at once
+  choices.concat({&vars, &funs, &pkgs, &ds});
+  
   return choices;
 }
 
+void RAutocomplete::load_spell_dictionary(){
+  // the dictionary of the tokens of the known identifiers, used to correct 
+  // misspelled queries (see SpellDictionary)
+  // => it is cached on disk and rebuilt every 30 days
+  
+  const int max_edits = str::get_misspell_max_edits();
+  if(max_edits == 0){
+    return;
+  }
+  
+  CachedData dict_cached(get_Rversion() + "/spell_dictionary.txt");
+  const auto ttl = CachedData::days(30);
+  
+  std::shared_ptr<const str::SpellDictionary> pdict;
+  if(!dict_cached.is_stale(ttl)){
+    vector<vector<string>> all_lines;
+    for(size_t i = 0 ; i < dict_cached.n_vectors() ; ++i){
+      all_lines.push_back(dict_cached.get_cached_vector(i));
+    }
+    pdict = str::SpellDictionary::from_lines(all_lines);
+  }
+  
+  if(!pdict || pdict->max_edits() < max_edits){
+    // the identifiers: installed packages, exports of the loaded packages, data sets
+    vector<string> all_identifiers = R::R_run("list.files(.libPaths())");
+    vector<string> all_exports = R::R_run("unlist(lapply(loadedNamespaces(), function(x) getNamespaceExports(x)))");
+    util::append(all_identifiers, all_exports);
+    util::append(all_identifiers, suggest_basic_datasets().get_string_vec());
+    
+    if(all_identifiers.empty()){
+      return;
+    }
+    
+    pdict = std::make_shared<const str::SpellDictionary>(str::identifier_tokens(all_identifiers), max_edits);
+    
+    vector<vector<string>> all_lines = pdict->to_lines();
+    dict_cached.set_ttl(ttl).set_cached_vectors({all_lines[0], all_lines[1], all_lines[2]}, CachedData::SIZE::UNEQUAL);
+  }
+  
+  str::set_spell_dictionary(pdict);
+}
+
 StringMatch RAutocomplete::make_suggestions(const AutocompleteContext &context){
   
+  if(!is_spell_dictionary_loaded){
+    is_spell_dictionary_loaded = true;
+    load_spell_dictionary();
+  }
+  
   in_autocomp = true;
   map_code_suggestion.clear();
   first_update = true;
@@ -1149,6 +1257,7 @@ void RAutocomplete::quit_autocomp(){
   
   current_suggestion.clear();
   map_code_suggestion.clear();
+  match_stack.clear();
   in_autocomp = false;
   
 }
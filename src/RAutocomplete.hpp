@@ -8,6 +8,8 @@
 
 #include "util.hpp"
 #include "stringtools.hpp"
+#include "misspell.hpp"
+#include "spelldict.hpp"
 #include "autocomplete.hpp"
 #include "cache.hpp"
 #include "R.hpp"
@@ -119,17 +121,15 @@ public:
   AC_String() = default;
   
   AC_String(R::CPP_SEXP &&x){
-    str::vec_str &&v = static_cast<str::vec_str>(x);
-    set_string_vector(v);
+    set_string_ids(x.to_string_ids());
   }
   
   AC_String(const str::vec_str &x){
-    str::vec_str &&v = static_cast<str::vec_str>(x);
-    set_string_vector(v);
+    set_string_vector(x);
   }
   
   AC_String(str::vec_str &&x){
-    set_string_vector(x);
+    set_string_vector(std::move(x));
   }
   
   AC_String& set_finalize(AC_FINALIZE x){
@@ -138,16 +138,20 @@ public:
   }
   
   AC_String& operator=(R::CPP_SEXP &&x){
-    str::vec_str &&v = static_cast<str::vec_str>(x);
-    set_string_vector(v);
+    set_string_ids(x.to_string_ids());
     return *this;
   }
   
-  AC_String& push_back(AC_String& x){
+  AC_String& push_back(const AC_String& x){
     str::MetaStringVec::push_back(x);
     return *this;
   }
   
+  AC_String& concat(const vector<const str::MetaStringVec*> &all_x){
+    str::MetaStringVec::concat(all_x);
+    return *this;
+  }
+  
 };
 
 
@@ -429,6 +433,13 @@ class RAutocomplete: public ServerAutocomplete {
   
   AutocompleteSuggestion current_suggestion{};
   std::map<char, AutocompleteSuggestion> map_code_suggestion;
+  
+  // successive matches while the user keeps typing
+  str::StringMatchStack match_stack;
+  
+  // the spell dictionary is loaded at the first autocompletion
+  bool is_spell_dictionary_loaded = false;
+  void load_spell_dictionary();
   string allowed_codes;
   bool first_update = false;
   
@@ -459,7 +470,7 @@ class RAutocomplete: public ServerAutocomplete {
   AC_String suggest_tilde();
   
   inline StringMatch build_and_save_suggestion(const string &query, str::MetaStringVec &choices){
-    StringMatch res = str::string_match(query, choices);
+    StringMatch res = match_stack.match(query, choices);
     current_suggestion.set_suggestion(res);
     return res;
   }
@@ -88,12 +88,12 @@ str::MetaStringVec suggest_path(string &context, const bool add_quotes){
     
     // we continue the autocomp only for folders
     const size_t n = all_paths.size();
-    vector<string> add_continue(n);
+    vector<bool> add_continue(n);
     bool add_meta = false;
     for(size_t i = 0 ; i < n ; ++i){
       if(all_paths[i].back() == '/'){
         add_meta = true;
-        add_continue[i] = "true";
+        add_continue[i] = true;
       }
     }
     
@@ -110,12 +110,12 @@ str::MetaStringVec suggest_path(string &context, const bool add_quotes){
         prepend = original_context.substr(0, original_context.size() - context.size());
       }
       
-      string prepend_size = std::to_string(str::utf8::count_wide_chars(prepend));
+      const int prepend_size = str::utf8::count_wide_chars(prepend);
                   
       vector<string> add_right(n);
       vector<string> add_left(n);
-      vector<string> add_n_del(n);
-      vector<string> add_shift(n);
+      vector<int> add_n_del(n);
+      vector<int> add_shift(n);
       
       bool any_quote = false;
       for(size_t i = 0 ; i < n ; ++i){
@@ -124,8 +124,8 @@ str::MetaStringVec suggest_path(string &context, const bool add_quotes){
           add_right[i] = "\"";
           add_left[i] = "\"" + prepend;
           add_n_del[i] = prepend_size;
-          if(add_continue[i] == "true"){
-            add_shift[i] = "-1";
+          if(add_continue[i]){
+            add_shift[i] = -1;
           }
         }
       }
@@ -195,53 +195,59 @@ void ConsoleAutocomplete::set_matches(StringMatch x, bool in_path){
     
     n_display = n_matches < max_height ? n_matches : max_height;
     
-    const uint n = all_matches.size();
-    lines_fmt.resize(n);
+    // NOTA: there can be tens of thousands of matches, only the pages 
+    // displayed are formatted (see line_fmt)
+    all_pages_fmt.resize((n_matches + page_size - 1) / page_size);
     
     // we don't highlight for starting letters because it is trivial
     // we only highlight when non starting matches can be found
     // ie this matching starts at 2+ letters
     const uint n_target = all_matches.get_target_size_wide();
-    const bool add_hightlight = n_target >= 2;
+    add_highlight = n_target >= 2;
     
     // suggestions can have VTS sequences, 
     // if so, we add two spaces before
     // 
-    const bool has_vts = all_matches.has_meta("vts");
-    vector<string> all_vts = has_vts ?  all_matches.get_meta_vector("vts") : vector<string>();
+    has_vts = all_matches.has_meta("vts");
     
     if(has_vts){
       // we add two spaces in front of the command, in case they are formatted
       max_width -= 2;
     }
     
-    uint value_width = 0;
-    for(uint i = 0 ; i < n ; ++i){
+    // the widths are computed on the first page
+    const uint n_first = n_matches < page_size ? n_matches : page_size;
+    
+    value_width = 0;
+    for(uint i = 0 ; i < n_first ; ++i){
       str::string_utf8 tmp = str::shorten(all_matches.string_at(i), max_width);
       if(tmp.size() > value_width){
         value_width = tmp.size();
       }
-      
-      lines_fmt[i] = tmp.str();
     }
     
-    bool has_labels = all_matches.has_meta("labels");
-    vector<string> all_labels = has_labels ?  all_matches.get_meta_vector("labels") : vector<string>();
+    has_labels = all_matches.has_meta("labels");
+    label_width = 0;
     
     if(has_labels){
-      uint label_size = str::max_size(all_labels);
-      if(label_size + value_width > max_width){
+      for(uint i = 0 ; i < n_first ; ++i){
+        const uint n_label = str::size_no_vts(all_matches.meta_at("labels", i));
+        if(n_label > label_width){
+          label_width = n_label;
+        }
+      }
+      
+      if(label_width + value_width > max_width){
         // 3/4 sugg, 1/4 label
         uint quarter_width = 0.25 * max_width;
         uint three_quarter_width = 0.75 * max_width;
-        if(quarter_width > label_size){
+        if(quarter_width > label_width){
           // no need to shorten the labels
-          value_width = max_width - label_size;
-          str::shorten_inplace(lines_fmt, value_width);
+          value_width = max_width - label_width;
           
         } else if(value_width < three_quarter_width){
           // no need to shorten the values
-          str::shorten_inplace(all_labels, max_width - value_width);
+          label_width = max_width - value_width;
           
         } else if(quarter_width <= 4){
           // we drop the labels
@@ -249,57 +255,10 @@ void ConsoleAutocomplete::set_matches(StringMatch x, bool in_path){
           
         } else {
           value_width = max_width - quarter_width;
-          str::shorten_inplace(lines_fmt, value_width);
-          str::shorten_inplace(all_labels, quarter_width);
+          label_width = quarter_width;
           
         }
       }
-      
-      if(has_labels){
-        str::right_fill_with_space_inplace(all_labels);
-      }
-      
-    }
-    
-    // we set them at the same width
-    for(uint i = 0 ; i < n ; ++i){
-      
-      str::string_utf8 tmp = lines_fmt[i];
-      
-      if(tmp.size() < value_width){
-        const uint origin_size = tmp.size();
-        for(uint j = 0 ; j < (value_width - origin_size) ; ++j){
-          tmp.push_back(' ');
-        }
-      }
-      
-      // we add highlighting of the match
-      if(add_hightlight){
-        const str::MatchInfo &match_info = all_matches.match_info_at(i);
-        const uint n_words = match_info.size();
-        for(int i = n_words - 1 ; i >= 0 ; --i){
-          const uint start = match_info.start_at(i);
-          const uint end = match_info.end_at(i);
-          if(start < tmp.size()){
-            // case when we have trimmed the result
-            const uint end_fixed = min(end, tmp.size());
-            tmp.insert(end_fixed, VTS::BOLD_NOT);
-            tmp.insert(start, VTS::BOLD);
-          }
-        }
-        
-      }
-      
-      if(has_labels){
-        tmp.push_back(all_labels[i]);
-      }
-      
-      if(has_vts){
-        tmp.insert(0, "  " + all_vts[i]);
-        tmp.push_back(VTS::RESET_FG_BG);
-      }
-      
-      lines_fmt[i] = tmp.str();
     }
     
   } else {
@@ -319,6 +278,70 @@ void ConsoleAutocomplete::set_matches(StringMatch x, bool in_path){
   
 }
 
+const string& ConsoleAutocomplete::line_fmt(uint i){
+  // the formatted line of the i-th match, its page is formatted if needed
+  
+  const uint page = i / page_size;
+  vector<string> &page_fmt = all_pages_fmt.at(page);
+  
+  if(!page_fmt.empty()){
+    return page_fmt.at(i - page * page_size);
+  }
+  
+  const uint i_start = page * page_size;
+  const uint i_end = min(n_matches, i_start + page_size);
+  page_fmt.reserve(i_end - i_start);
+  
+  // we set them at the same width
+  for(uint k = i_start ; k < i_end ; ++k){
+    
+    str::string_utf8 tmp = str::shorten(all_matches.string_at(k), value_width);
+    
+    if(tmp.size() < value_width){
+      const uint origin_size = tmp.size();
+      for(uint j = 0 ; j < (value_width - origin_size) ; ++j){
+        tmp.push_back(' ');
+      }
+    }
+    
+    // we add highlighting of the match
+    if(add_highlight){
+      const str::MatchInfo &match_info = all_matches.match_info_at(k);
+      const uint n_words = match_info.size();
+      for(int w = n_words - 1 ; w >= 0 ; --w){
+        const uint start = match_info.start_at(w);
+        const uint end = match_info.end_at(w);
+        if(start < tmp.size()){
+          // case when we have trimmed the result
+          const uint end_fixed = min(end, tmp.size());
+          tmp.insert(end_fixed, VTS::BOLD_NOT);
+          tmp.insert(start, VTS::BOLD);
+        }
+      }
+    
+    }
+    
+    if(has_labels){
+      string label = str::shorten(all_matches.meta_at("labels", k), label_width);
+      str::right_fill_with_space_inplace(label, label_width, false);
+      tmp.push_back(label);
+    }
+    
+    if(has_vts){
+      tmp.insert(0, "  " + all_matches.meta_at("vts", k));
+      tmp.push_back(VTS::RESET_FG_BG);
+    }
+    
+    if(row_max_width > 0){
+      page_fmt.push_back(str::shorten(tmp.str(), row_max_width));
+    } else {
+      page_fmt.push_back(tmp.str());
+    }
+  }
+  
+  return page_fmt.at(i - i_start);
+}
+
 void ConsoleAutocomplete::move(int side){
   
   if(is_empty){
@@ -368,6 +391,8 @@ void ConsoleAutocomplete::reset(){
   
   all_matches = StringMatch{};
   lines_fmt.clear();
+  all_pages_fmt.clear();
+  row_max_width = 0;
   n_matches = 0;
   index = 0;
   screen_start = 0;
@@ -546,7 +571,7 @@ void ConsoleAutocomplete::display(bool init){
   
   // now we adjust x_autocomp based on the lenght of the suggestions
   // we need to find the width first
-  uint sugg_width = str::size_no_vts(lines_fmt.at(0));
+  uint sugg_width = str::size_no_vts(is_empty ? lines_fmt.at(0) : line_fmt(0));
   const uint &w = pconcom->win_width;
   if(x_autocomp + sugg_width > w){
     if(sugg_width + 2 > w){
@@ -554,6 +579,12 @@ void ConsoleAutocomplete::display(bool init){
                       "sugg_width = ", sugg_width, "\n",
                       "w = ", w);
       str::shorten_inplace(lines_fmt, w / 2);
+      // NOTA: the pages are formatted lazily => the limit is applied by line_fmt
+      // to all the rows, the pages already formatted are redone
+      row_max_width = w / 2;
+      for(auto &page_fmt : all_pages_fmt){
+        page_fmt.clear();
+      }
       x_autocomp = 0;
     } else {
       x_autocomp = w - sugg_width - 2;
@@ -607,7 +638,7 @@ void ConsoleAutocomplete::display(bool init){
   uint j = 0;
   for(uint i=screen_start ; i<(screen_start + n_display) ; ++i){
     std::cout << VTS::cursor_move_at_x(x_autocomp);
-    std::cout << VTS::CURSOR_DOWN << (i == index ? selection_color : text_color) << lines_fmt[i] << VTS::RESET_FG_BG << scrollbar[j++] << VTS::CLEAR_RIGHT;
+    std::cout << VTS::CURSOR_DOWN << (i == index ? selection_color : text_color) << line_fmt(i) << VTS::RESET_FG_BG << scrollbar[j++] << VTS::CLEAR_RIGHT;
   }
   
   // we reset the cursor
@@ -50,33 +50,32 @@ public:
   AutocompChoices() = default;
   
   AutocompChoices(const str::vec_str &x){
-    str::vec_str &&v = static_cast<str::vec_str>(x);
-    set_string_vector(v);
+    set_string_vector(x);
   }
   
   AutocompChoices(str::vec_str &&x){
-    set_string_vector(x);
+    set_string_vector(std::move(x));
   }
   
   AutocompChoices(const MetaStringVec &x): MetaStringVec(x){}
   
-  AutocompChoices& push_back(AutocompChoices& x){
+  AutocompChoices& push_back(const AutocompChoices& x){
     str::MetaStringVec::push_back(x);
     return *this;
   }
   
   AutocompChoices& set_continue(const STYPE stype = STYPE::INHERIT){
-    str::MetaStringVec::set_meta("continue", "true", stype);
+    str::MetaStringVec::set_meta("continue", true, stype);
     return *this;
   }
   
   AutocompChoices& set_cursor_shift(int i, const STYPE stype = STYPE::INHERIT){
-    str::MetaStringVec::set_meta("cursor_shift", std::to_string(i), stype);
+    str::MetaStringVec::set_meta("cursor_shift", i, stype);
     return *this;
   }
   
   AutocompChoices& set_n_delete_left(int i, const STYPE stype = STYPE::INHERIT){
-    str::MetaStringVec::set_meta("n_delete_left", std::to_string(i), stype);
+    str::MetaStringVec::set_meta("n_delete_left", i, stype);
     return *this;
   }
   
@@ -91,7 +90,7 @@ public:
   }
   
   AutocompChoices& set_add_quotes(const STYPE stype = STYPE::INHERIT){
-    str::MetaStringVec::set_meta("add_quotes", "true", stype);
+    str::MetaStringVec::set_meta("add_quotes", true, stype);
     return *this;
   }
   
@@ -337,6 +336,7 @@ class ConsoleAutocomplete {
   ConsoleCommand *pconcom;
   
   StringMatch all_matches;
+  // the lines of the box when there is no match
   vector<string> lines_fmt;
   uint index = 0;
   uint screen_start = 0;
@@ -349,8 +349,21 @@ class ConsoleAutocomplete {
   const uint max_height = 7;
   const uint default_max_width = 65;
   
+  // the matches are formatted page by page, when they are displayed
+  // the layout (widths of the values and labels) is set by the first page
+  const uint page_size = 64;
+  vector<vector<string>> all_pages_fmt;
+  uint value_width = 0;
+  uint label_width = 0;
+  // set when the window is too narrow for the layout, 0 otherwise
+  uint row_max_width = 0;
+  bool has_labels = false;
+  bool has_vts = false;
+  bool add_highlight = false;
+  
   vector<string> gen_scrollbar(uint, uint);
   uint get_max_width();
+  const string& line_fmt(uint i);
   
 public:
   
@@ -5,18 +5,46 @@
 //=========================================================================//
 
 #include "cache.hpp"
+#include "durablefile.hpp"
 
 
+#include <cstring>
+
+// the binary header, see the implementation notes in cache.hpp
+struct CacheHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t n_vectors;
+  uint64_t n_strings;
+  uint64_t blob_size;
+  // the metadata
+  int64_t creation_time;
+  uint64_t fingerprint;
+  int64_t ttl;
+};
+static_assert(sizeof(CacheHeader) == 56, "the cache header must be packed");
+
+static const char CACHE_MAGIC[8] = {'S', 'I', 'R', 'C', 'A', 'C', 'H', 'E'};
+
 // the static values
 const string CachedData::SEPARATOR = "^^^";
+const uint32_t CachedData::VERSION = 2;
+const int64_t CachedData::REFRESH_RETRY_DELAY = 3600;
+std::map<string, CachedData::Refresh> CachedData::pending_refreshes;
+std::map<string, int64_t> CachedData::failed_refreshes;
 fs::path CachedData::root_path = "";
-std::map<string, CachedData::ptr_vec_vec_string> CachedData::global_cache = std::map<string, CachedData::ptr_vec_vec_string>();
+std::map<string, CachedData::ptr_content> CachedData::global_cache = std::map<string, CachedData::ptr_content>();
 
 CachedData::CachedData(string name, TYPE type){
   
   cache_name = name;
   cache_type = type;
   
+  // NOTA: the path is needed even when cached in memory, to rewrite the cache
+  const fs::path text_path = root_path / cache_name;
+  cache_path = text_path;
+  cache_path.replace_extension(".bin");
+  
   //
   // step 1: we look at whether the object is already cached in memory 
   //
@@ -24,7 +52,7 @@ CachedData::CachedData(string name, TYPE type){
   if(auto loc = global_cache.find(cache_name) ; loc != global_cache.end()){
     // the cache exists!
     cache_exists = true;
-    data = global_cache.at(cache_name);
+    data = loc->second;
     return;
   }
   
@@ -41,55 +69,193 @@ CachedData::CachedData(string name, TYPE type){
     return;
   }
 
-  cache_path = root_path / cache_name;
+  std::error_code ec;
+  if(fs::exists(cache_path, ec)){
+    // NOTA: a corrupt file is silently rebuilt
+    data = read_binary(cache_path);
+    if(data){
+      cache_exists = true;
+      global_cache[cache_name] = data;
+    }
+  }
   
-  if(fs::exists(cache_path)){
+  //
+  // step 3: migration of the old text format
+  //
     
-    // the date 
-    date_modified = fs::last_write_time(cache_path);
+  if(!data && text_path != cache_path && fs::exists(text_path, ec)){
     
-    // we read the file
-    std::ifstream cache_in{cache_path};
-    if(!cache_in.is_open()){
-      // NOTA: LATER, make it silent (the user does not need to know)
-      std::cerr << "Could not read the existing cache file at:\n'" << cache_path << "'\n";
+    bool is_error = false;
+    vec_vec_string all_vecs = read_text(text_path, is_error);
+    if(is_error){
       return;
     }
     
-    cache_exists = true;
+    // the migrated cache keeps the age of the text file
+    const fs::file_time_type text_date = fs::last_write_time(text_path, ec);
+    const auto text_age = std::chrono::duration_cast<std::chrono::seconds>(fs::file_time_type::clock::now() - text_date);
     
-    // NOTA:
-    // - we assume the data is well formatted
+    set_data(std::move(all_vecs), now_seconds() - text_age.count());
+    write_cache();
     
-    // we initialize the data
-    data = std::make_shared<vec_vec_string>();
-    data->push_back(vector<string>());
-    vector<string> *pvec = &(data->at(0));
+    if(fs::exists(cache_path, ec)){
+      fs::remove(text_path, ec);
+    }
+  }
+  
+}
+
+CachedData::ptr_content CachedData::read_binary(const fs::path &path){
+  
+  auto content = std::make_shared<Content>();
+  const MappedFile &file = content->file;
+  if(!content->file.open(path)){
+    return nullptr;
+  }
+  
+  const char *px = file.data();
+  const size_t n_bytes = file.size();
+  
+  //
+  // the header
+  //
+  
+  CacheHeader header;
+  if(n_bytes < sizeof(CacheHeader)){
+    return nullptr;
+  }
+  
+  std::memcpy(&header, px, sizeof(CacheHeader));
+  if(std::memcmp(header.magic, CACHE_MAGIC, 8) != 0 || header.version != VERSION){
+    return nullptr;
+  }
+  
+#ifdef _WIN32
+  // NOTA: Windows refuses to replace a file that has a mapped view, whatever
+  // the share flags => the content is copied and the file is unmapped right
+  // away, so that the other instances can still write the cache
+  content->bytes.resize((n_bytes + 7) / 8);
+  std::memcpy(content->bytes.data(), px, n_bytes);
+  px = reinterpret_cast<const char*>(content->bytes.data());
+  content->file.close();
+#endif
+  
+  content->meta.creation_time = header.creation_time;
+  content->meta.fingerprint = header.fingerprint;
+  content->meta.ttl = header.ttl;
+  
+  const uint64_t n_vectors = header.n_vectors;
+  const uint64_t n_strings = header.n_strings;
+  if(n_strings > n_bytes){
+    return nullptr;
+  }
+  
+  const size_t blob_pos = sizeof(CacheHeader) + 8 * (n_vectors + 1 + n_strings + 1);
+  if(blob_pos > n_bytes || n_bytes - blob_pos != header.blob_size){
+    return nullptr;
+  }
+  
+  //
+  // the offsets
+  //
+  
+  // NOTA: the view (or the copy) is 8-byte aligned and the header is 56 bytes => the offsets are aligned
+  const uint64_t *vec_start = reinterpret_cast<const uint64_t*>(px + sizeof(CacheHeader));
+  const uint64_t *str_start = vec_start + n_vectors + 1;
+  const char *blob = px + blob_pos;
+  
+  if(vec_start[0] != 0 || vec_start[n_vectors] != n_strings ||
+     str_start[0] != 0 || str_start[n_strings] != header.blob_size){
+    return nullptr;
+  }
+  
+  vector<vec_view> &all_views = content->all_views;
+  all_views.resize(n_vectors);
+  for(uint64_t v = 0 ; v < n_vectors ; ++v){
+    if(vec_start[v + 1] < vec_start[v]){
+      return nullptr;
+    }
     
-    std::string line;
-    while(std::getline(cache_in, line)){
-      
-      if(line == SEPARATOR){
-        // we go to the next vector
-        data->push_back(vector<string>());
-        pvec = &(data->back());
-      } else {
-        pvec->push_back(line);
+    vec_view &views = all_views[v];
+    views.reserve(vec_start[v + 1] - vec_start[v]);
+    for(uint64_t s = vec_start[v] ; s < vec_start[v + 1] ; ++s){
+      if(str_start[s + 1] < str_start[s]){
+        return nullptr;
       }
       
+      views.emplace_back(blob + str_start[s], str_start[s + 1] - str_start[s]);
     }
+  }
+  
+  return content;
+}
+
+CachedData::vec_vec_string CachedData::read_text(const fs::path &path, bool &is_error){
+  
+  vec_vec_string all_vecs;
+  
+  std::ifstream cache_in{path};
+  if(!cache_in.is_open()){
+    is_error = true;
+    return all_vecs;
+  }
+  
+  // NOTA:
+  // - we assume the data is well formatted
+  
+  all_vecs.push_back(vector<string>());
+  vector<string> *pvec = &(all_vecs.at(0));
+  
+  std::string line;
+  while(std::getline(cache_in, line)){
     
-    // we remove the last empty line
-    pvec->pop_back();
-    
-    cache_in.close();
+    if(line == SEPARATOR){
+      // we go to the next vector
+      all_vecs.push_back(vector<string>());
+      pvec = &(all_vecs.back());
+    } else {
+      pvec->push_back(line);
+    }
     
-    // we save the data in the global cache
-    global_cache[cache_name] = data;
   }
   
+  // we remove the last empty line
+  if(!pvec->empty()){
+    pvec->pop_back();
+  }
+  
+  return all_vecs;
 }
 
+CachedData::ptr_content CachedData::from_vectors(vec_vec_string &&all_vecs, const Meta &meta){
+  
+  auto content = std::make_shared<Content>();
+  content->all_owned = std::move(all_vecs);
+  content->meta = meta;
+  
+  for(const auto &vec : content->all_owned){
+    content->all_views.push_back(vec_view(vec.begin(), vec.end()));
+  }
+  
+  return content;
+}
+
+int64_t CachedData::now_seconds(){
+  const auto now = std::chrono::system_clock::now().time_since_epoch();
+  return std::chrono::duration_cast<std::chrono::seconds>(now).count();
+}
+  
+void CachedData::set_data(vec_vec_string &&all_vecs, int64_t creation_time){
+  
+  current_fingerprint();
+  next_meta.creation_time = creation_time;
+  data = from_vectors(std::move(all_vecs), next_meta);
+  cache_exists = true;
+  
+  // NOTA: the global cache is replaced, the previous content (and its mapped
+  // file, if any) is released when no longer used
+  global_cache[cache_name] = data;
+}
 
 void CachedData::write_cache(){
   
@@ -108,94 +274,210 @@ void CachedData::write_cache(){
   }
   
   //
-  // 2) we write 
+  // 2) the header and the offsets 
   //
   
+  const vector<vec_view> &all_views = data->all_views;
+  
+  CacheHeader header;
+  std::memcpy(header.magic, CACHE_MAGIC, 8);
+  header.version = VERSION;
+  header.n_vectors = all_views.size();
+  header.n_strings = 0;
+  header.blob_size = 0;
+  header.creation_time = data->meta.creation_time;
+  header.fingerprint = data->meta.fingerprint;
+  header.ttl = data->meta.ttl;
+  
+  vector<uint64_t> vec_start = {0};
+  vector<uint64_t> str_start = {0};
+  for(const auto &views : all_views){
+    for(const auto &sv : views){
+      header.blob_size += sv.size();
+      str_start.push_back(header.blob_size);
+    }
+    
+    header.n_strings += views.size();
+    vec_start.push_back(header.n_strings);
+  }
   
-  std::ofstream cache_out{cache_path};
+  //
+  // 3) we write 
+  //
   
-  if(!cache_out.is_open()){
+  string content;
+  content.reserve(sizeof(CacheHeader) + 8 * (vec_start.size() + str_start.size()) + header.blob_size);
+  content.append(reinterpret_cast<const char*>(&header), sizeof(CacheHeader));
+  content.append(reinterpret_cast<const char*>(vec_start.data()), 8 * vec_start.size());
+  content.append(reinterpret_cast<const char*>(str_start.data()), 8 * str_start.size());
+  for(const auto &views : all_views){
+    for(const auto &sv : views){
+      content.append(sv.data(), sv.size());
+    }
+  }
+  
+  // NOTA: the file is replaced in one step, the other instances never read a partial cache
+  if(write_file_atomic(cache_path, content, util::DoCheck(err)) != 0){
     // NOTA: LATER, make it silent (the user does not need to know)
-    
-    std::cerr << "Could not write the cache at:\n'" << cache_path << "'\n";
+    std::cerr << "Could not write the cache at:\n'" << cache_path << "'\n" << err << "\n";
     return;
   }
   
-  for(size_t index = 0 ; index < data->size() ; ++index){
-    
-    const vector<string> &vec = data->at(index);
-    const size_t n = vec.size();
-    
-    for(size_t i = 0 ; i < n ; ++i){
-      cache_out << vec[i] << "\n";
-    }
-    
-    if(index + 1 < data->size()){
-      cache_out << SEPARATOR << "\n";
-    }
+}
+
+
+
+bool CachedData::is_stale(std::chrono::seconds ttl) const {
     
+  if(!cache_exists){
+    return true;
+  }
+  
+  // NOTA: a cache created in the future (clock change) is not stale
+  return now_seconds() - data->meta.creation_time > ttl.count();
+}
+
+bool CachedData::is_stale() const {
+  
+  if(!cache_exists){
+    return true;
   }
   
-  cache_out << "\n";
+  if(fingerprint_fun && current_fingerprint() != data->meta.fingerprint){
+    return true;
+  }
   
-  cache_out.close();
+  const int64_t ttl = data->meta.ttl;
+  return ttl != 0 && is_stale(std::chrono::seconds(ttl));
+}
   
-  date_modified = fs::last_write_time(cache_path);
+const CachedData::Meta& CachedData::get_meta() const {
+  static const Meta empty_meta;
+  return cache_exists ? data->meta : empty_meta;
+}
   
+CachedData& CachedData::set_ttl(std::chrono::seconds ttl){
+  next_meta.ttl = ttl.count();
+  return *this;
 }
 
+CachedData& CachedData::set_fingerprint(uint64_t fingerprint){
+  next_meta.fingerprint = fingerprint;
+  is_fingerprint_set = true;
+  return *this;
+}
 
+CachedData& CachedData::set_fingerprint_fun(FingerprintFun fun){
+  fingerprint_fun = std::move(fun);
+  is_fingerprint_set = false;
+  return *this;
+}
 
-double CachedData::seconds_since_last_write(){
-    
-  if(is_unset()){
-    return 1e10;
+uint64_t CachedData::current_fingerprint() const {
+  
+  if(!is_fingerprint_set && fingerprint_fun){
+    next_meta.fingerprint = fingerprint_fun();
+    is_fingerprint_set = true;
   }
   
-  if(cache_type == TYPE::ONLY_MEMORY){
-    return 0;
+  return next_meta.fingerprint;
+}
+
+//
+// refresh ---------------------------------------------------------------------
+//
+
+bool CachedData::run_refresh(const string &name, const Refresh &refresh){
+  
+  vec_vec_string all_vecs = refresh.fun();
+  if(all_vecs.empty()){
+    failed_refreshes[name] = now_seconds();
+    return false;
   }
   
-  fs::path dummy_path = root_path / "dummy_time";
-  std::ofstream dummy{dummy_path};
-  dummy.close();
+  failed_refreshes.erase(name);
   
-  double seconds = std::chrono::duration_cast<std::chrono::seconds>(fs::last_write_time(dummy_path) - date_modified).count();
+  // NOTA: set_data replaces the content in the global cache
+  CachedData cache(name, refresh.type);
+  cache.next_meta = refresh.meta;
+  cache.set_data(std::move(all_vecs), now_seconds());
   
-  return seconds;
-};
+  if(refresh.type == TYPE::ON_DISK){
+    cache.write_cache();
+  }
+  
+  return true;
+}
 
-double CachedData::hours_since_last_write(){
-  double seconds = seconds_since_last_write();
-  return seconds / 3600.0;
-};
+void CachedData::run_pending_refreshes(){
+  
+  if(pending_refreshes.empty()){
+    return;
+  }
+  
+  // NOTA: a refresh may queue other refreshes
+  std::map<string, Refresh> all_refreshes;
+  all_refreshes.swap(pending_refreshes);
+  
+  for(const auto &[name, refresh] : all_refreshes){
+    run_refresh(name, refresh);
+  }
+}
 
-double CachedData::days_since_last_write(){
-  double seconds = seconds_since_last_write();
-  return seconds / 3600.0 / 24.0;
-};
+CachedData& CachedData::refresh_if_stale(std::chrono::seconds ttl, RefreshFun fun){
+  
+  if(!is_stale(ttl)){
+    return *this;
+  }
+  
+  if(auto loc = failed_refreshes.find(cache_name) ; loc != failed_refreshes.end()){
+    if(now_seconds() - loc->second < REFRESH_RETRY_DELAY){
+      return *this;
+    }
+  }
+  
+  Meta meta = next_meta;
+  meta.ttl = ttl.count();
+  Refresh refresh{std::move(fun), cache_type, meta};
+  
+  if(!cache_exists){
+    // nothing to serve: the data is computed now
+    if(run_refresh(cache_name, refresh)){
+      data = global_cache.at(cache_name);
+      cache_exists = true;
+    }
+    
+  } else {
+    // NOTA: an already queued refresh is kept
+    pending_refreshes.emplace(cache_name, std::move(refresh));
+  }
+  
+  return *this;
+}
 
-vector<string> CachedData::get_cached_vector(size_t index){
+const vector<std::string_view>& CachedData::get_cached_views(size_t index){
   
   if(!cache_exists){
     std::cerr << "Error: trying to access a cache that does not yet exists.\n";
   }
   
-  if(index >= data->size()){
+  if(index >= data->all_views.size()){
     std::cerr << "Error when getting the cache for '" << cache_name << 
-      "'.\nRequesting vector in position " << index << ", but there are only " << data->size() <<
+      "'.\nRequesting vector in position " << index << ", but there are only " << data->all_views.size() <<
       " vectors in the cache.\n";
   }
   
-  return data->at(index);
+  return data->all_views.at(index);
+}
+
+vector<string> CachedData::get_cached_vector(size_t index){
+  const vec_view &views = get_cached_views(index);
+  return vector<string>(views.begin(), views.end());
 }
 
 CachedData& CachedData::set_cached_vector(const vector<string> &x){
   
-  data = std::make_shared<vec_vec_string>();
-  data->push_back(x);
-  
-  cache_exists = true;
+  set_data(vec_vec_string{x}, now_seconds());
   
   if(cache_type == TYPE::ON_DISK){
     write_cache();
@@ -206,13 +488,11 @@ CachedData& CachedData::set_cached_vector(const vector<string> &x){
 
 CachedData& CachedData::set_cached_vectors(std::initializer_list<vector<string>> vecs, SIZE size){
   
-  data = std::make_shared<vec_vec_string>(vecs);
-  
-  if(size == SIZE::ALL_EQUAL && data->size() > 1){
-    const size_t n_vecs = data->size();
-    const size_t s0 = data->at(0).size();
-    for(size_t i = 1 ; i < n_vecs ; ++i){
-      size_t si = data->at(0).size();
+  if(size == SIZE::ALL_EQUAL && vecs.size() > 1){
+    const size_t s0 = vecs.begin()->size();
+    size_t i = 0;
+    for(const auto &vec : vecs){
+      const size_t si = vec.size();
       if(s0 != si){
         std::cerr << "Error when caching '" << cache_name << 
           "', the vectors to be cached must be of the same size. " <<
@@ -221,10 +501,11 @@ CachedData& CachedData::set_cached_vectors(std::initializer_list<vector<string>>
         
         return *this;
       }
+      ++i;
     }
   }
   
-  cache_exists = true;
+  set_data(vec_vec_string(vecs), now_seconds());
   
   if(cache_type == TYPE::ON_DISK){
     write_cache();
@@ -232,5 +513,3 @@ CachedData& CachedData::set_cached_vectors(std::initializer_list<vector<string>>
   
   return *this;
 }
-
-
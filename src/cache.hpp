@@ -7,19 +7,53 @@
 #pragma once
 
 #include "util.hpp"
+#include "mappedfile.hpp"
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <filesystem>
 #include <fstream>
 #include <memory>
 #include <map>
 #include <iostream>
+#include <cstdint>
+#include <chrono>
+#include <functional>
 
 namespace fs = std::filesystem;
 using std::string;
 using std::vector;
 
+// Implementation notes:
+// - the caches are stored in a binary file, read with a memory map:
+//   * header: magic "SIRCACHE", version, number of vectors, number of strings
+//     and size of the blob
+//   * offset tables: the strings of the vector v are [vec_start[v], vec_start[v + 1]),
+//     the bytes of the string s are [str_start[s], str_start[s + 1]) in the blob
+//   * the blob: all the strings, contiguous
+// - the header also stores the metadata: creation time, fingerprint of the
+//   source and TTL. It is loaded with the data => the freshness checks are
+//   in memory only, they never touch the file system
+// - fingerprint function (set_fingerprint_fun): computed at most once per object,
+//   the cache is stale when it differs from the stored fingerprint ; it is
+//   stored with the next data set
+// - stale-while-revalidate (refresh_if_stale):
+//   * a stale cache keeps serving its data, the refresh is queued and run at the
+//     next idle point of the event loop (run_pending_refreshes, main thread
+//     since the refresh functions call R)
+//   * the new content replaces the old one in global_cache in one step: the
+//     readers of the old content keep valid views
+//   * a failed refresh (empty result) is recorded and not retried before
+//     REFRESH_RETRY_DELAY
+// - the vectors are exposed as string_view on the mapped file (zero copy)
+// - on Windows, a file with a mapped view cannot be replaced => the file is
+//   copied in memory once its header is checked and it is unmapped right away.
+//   Otherwise the other instances could not write the cache for the whole session
+// - the cache named "x.txt" is stored in "x.bin". The old text files ("x.txt",
+//   vectors separated with ^^^) are migrated on first read
+// - a file with a bad header or bad offsets is considered as absent
+//
 
 class CachedData {
   
@@ -36,41 +70,117 @@ public:
     UNEQUAL,
   };
   
+  struct Meta {
+    // seconds since epoch (system clock)
+    int64_t creation_time = 0;
+    // to be compared with the fingerprint of the source of the data, 0 if none
+    uint64_t fingerprint = 0;
+    // in seconds, 0 if none
+    int64_t ttl = 0;
+  };
+  
+  // computes the data of the cache, an empty result means failure
+  using RefreshFun = std::function<vector<vector<string>>()>;
+  // fingerprint of the source of the data
+  using FingerprintFun = std::function<uint64_t()>;
+  
 private:
   
   using vec_string = vector<string>;
   using vec_vec_string = vector<vec_string>;
-  using ptr_vec_vec_string = std::shared_ptr<vec_vec_string>;
+  using vec_view = vector<std::string_view>;
+  
+  // the content of a cache: the strings live either in the mapped file (a
+  // copy of the file on Windows) or, when just computed, in memory
+  struct Content {
+    MappedFile file;
+    // Windows only: the content of the file, 8-byte aligned
+    vector<uint64_t> bytes;
+    vec_vec_string all_owned;
+    vector<vec_view> all_views;
+    Meta meta;
+  };
+  using ptr_content = std::shared_ptr<const Content>;
+  
+  struct Refresh {
+    RefreshFun fun;
+    TYPE type;
+    Meta meta;
+  };
   
   // static values
-  static std::map<string, ptr_vec_vec_string> global_cache;
+  static std::map<string, ptr_content> global_cache;
   static const string SEPARATOR;
+  static const uint32_t VERSION;
+  static const int64_t REFRESH_RETRY_DELAY;
+  
+  static std::map<string, Refresh> pending_refreshes;
+  // time of the last failed refresh
+  static std::map<string, int64_t> failed_refreshes;
   
   string cache_name;
   fs::path cache_path;
-  std::shared_ptr< vec_vec_string > data;
-  fs::file_time_type date_modified;
+  ptr_content data;
+  // the metadata of the next data set
+  mutable Meta next_meta;
+  FingerprintFun fingerprint_fun;
+  mutable bool is_fingerprint_set = false;
   
   bool cache_exists = false;
   TYPE cache_type = TYPE::ON_DISK;
   
+  static ptr_content read_binary(const fs::path &path);
+  static vec_vec_string read_text(const fs::path &path, bool &is_error);
+  static ptr_content from_vectors(vec_vec_string &&all_vecs, const Meta &meta);
+  static int64_t now_seconds();
+  static bool run_refresh(const string &name, const Refresh &refresh);
+  
+  uint64_t current_fingerprint() const;
+  void set_data(vec_vec_string &&all_vecs, int64_t creation_time);
   void write_cache();
   
 public:
   
   static fs::path root_path;
   
+  // forgets the caches in memory: the next reads are from the disk
+  static void clear_memory_cache(){ global_cache.clear(); }
+  
+  // to be run at the idle points of the event loop
+  static void run_pending_refreshes();
+  static bool has_pending_refresh(){ return !pending_refreshes.empty(); }
+  
   CachedData(string cache_name, TYPE cache_type = TYPE::ON_DISK);
   
   bool is_unset(){ return !cache_exists; }
   
   bool exists(){ return cache_exists; }
   
-  double seconds_since_last_write();
-  double hours_since_last_write();
-  double days_since_last_write();
+  size_t n_vectors(){ return cache_exists && data ? data->all_views.size() : 0; }
+  
+  static constexpr std::chrono::seconds days(int n){ return std::chrono::hours(24 * n); }
+  
+  // true if the cache does not exist or was created more than ttl ago
+  bool is_stale(std::chrono::seconds ttl) const;
+  // same with the TTL stored in the cache (never stale if there was none),
+  // and stale if the fingerprint of the source changed
+  bool is_stale() const;
+  
+  const Meta& get_meta() const;
+  
+  // to be called before setting the data
+  CachedData& set_ttl(std::chrono::seconds ttl);
+  CachedData& set_fingerprint(uint64_t fingerprint);
+  CachedData& set_fingerprint_fun(FingerprintFun fun);
+  
+  // unset cache: the data is computed now ; stale cache: the refresh is queued,
+  // the stale data is kept in the meantime
+  CachedData& refresh_if_stale(std::chrono::seconds ttl, RefreshFun fun);
   
+  // copy of the vector
   vector<string> get_cached_vector(size_t index = 0);
+  // views valid as long as the CachedData object lives
+  const vector<std::string_view>& get_cached_views(size_t index = 0);
   
   CachedData& set_cached_vector(const vector<string> &);
   CachedData& set_cached_vectors(std::initializer_list<vector<string>> vecs, 
@@ -0,0 +1,170 @@
+    //=========================================================================//
+   //            Author: Laurent R. Bergé, University of Bordeaux             //
+  //             Copyright (C) 2025-present, Laurent R. Bergé                //
+ //              MIT License (see project_root/LICENSE)                     //
+//=========================================================================//
+
+#include "commandlines.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+
+//
+// CommandLines ----------------------------------------------------------------
+//
+
+
+void CommandLines::locate(uint i, uint &block, uint &pos) const {
+  // the block containing the line i, and the position of the line in it
+  // NOTA: i == n_lines is valid: position after the last line
+  
+  if(i > n_lines){
+    util::error_msg("Internal error: CommandLines::locate: index out of bounds (", i,
+                    " > ", n_lines, ").");
+    i = n_lines;
+  }
+  
+  if(i == n_lines){
+    block = all_blocks.size() - 1;
+    pos = all_blocks[block].size();
+    return;
+  }
+  
+  auto it = std::upper_bound(block_start.begin(), block_start.end(), i);
+  block = std::distance(block_start.begin(), it) - 1;
+  pos = i - block_start[block];
+}
+
+void CommandLines::update_starts(uint from_block){
+  
+  const uint n_blocks = all_blocks.size();
+  block_start.resize(n_blocks);
+  
+  uint start = from_block == 0 ? 0 : block_start[from_block - 1] + all_blocks[from_block - 1].size();
+  for(uint b = from_block ; b < n_blocks ; ++b){
+    block_start[b] = start;
+    start += all_blocks[b].size();
+  }
+  
+  n_lines = start;
+}
+
+void CommandLines::split_block(uint block){
+  // the block is split in blocks of BLOCK_SIZE lines
+  
+  vector<CommandLine> &lines = all_blocks[block];
+  if(lines.size() <= 2 * BLOCK_SIZE){
+    return;
+  }
+  
+  vector<vector<CommandLine>> all_new_blocks;
+  for(uint i = BLOCK_SIZE ; i < lines.size() ; i += BLOCK_SIZE){
+    const uint i_end = std::min<uint>(i + BLOCK_SIZE, lines.size());
+    all_new_blocks.emplace_back(std::make_move_iterator(lines.begin() + i),
+                                std::make_move_iterator(lines.begin() + i_end));
+  }
+  lines.resize(BLOCK_SIZE);
+  
+  all_blocks.insert(all_blocks.begin() + block + 1, std::make_move_iterator(all_new_blocks.begin()),
+                    std::make_move_iterator(all_new_blocks.end()));
+}
+
+CommandLine& CommandLines::at(uint i){
+  uint block = 0, pos = 0;
+  locate(i, block, pos);
+  return all_blocks[block][pos];
+}
+
+const CommandLine& CommandLines::at(uint i) const {
+  uint block = 0, pos = 0;
+  locate(i, block, pos);
+  return all_blocks[block][pos];
+}
+
+void CommandLines::reset(){
+  all_blocks.clear();
+  all_blocks.emplace_back(1);
+  block_start = {0};
+  n_lines = 1;
+}
+
+void CommandLines::push_back(CommandLine &&x){
+  insert(n_lines, std::move(x));
+}
+
+void CommandLines::insert(uint i, CommandLine &&x){
+  uint block = 0, pos = 0;
+  locate(i, block, pos);
+  
+  vector<CommandLine> &lines = all_blocks[block];
+  lines.insert(lines.begin() + pos, std::move(x));
+  
+  split_block(block);
+  update_starts(block);
+}
+
+void CommandLines::insert(uint i, vector<CommandLine> &&all_x){
+  // bulk insertion: the lines are shifted only once
+  
+  if(all_x.empty()){
+    return;
+  }
+  
+  uint block = 0, pos = 0;
+  locate(i, block, pos);
+  
+  vector<CommandLine> &lines = all_blocks[block];
+  lines.insert(lines.begin() + pos, std::make_move_iterator(all_x.begin()),
+               std::make_move_iterator(all_x.end()));
+  
+  split_block(block);
+  update_starts(block);
+}
+
+void CommandLines::erase(uint i){
+  
+  if(i >= n_lines){
+    util::error_msg("Internal error: CommandLines::erase: index out of bounds (", i,
+                    " >= ", n_lines, ").");
+    return;
+  }
+  
+  uint block = 0, pos = 0;
+  locate(i, block, pos);
+  
+  vector<CommandLine> &lines = all_blocks[block];
+  lines.erase(lines.begin() + pos);
+  
+  if(lines.empty() && all_blocks.size() > 1){
+    all_blocks.erase(all_blocks.begin() + block);
+    block = block == 0 ? 0 : block - 1;
+  }
+  
+  update_starts(block);
+}
+
+void CommandLines::assign(const vector<stringtools::string_utf8> &all_text, const vector<string> &all_fmt,
+                          const vector<char> &all_ending_quotes){
+  
+  const uint n = all_text.size();
+  if(n == 0 || all_fmt.size() != n || all_ending_quotes.size() != n){
+    util::error_msg("Internal error: CommandLines::assign: the vectors must be of the same, non null, length.");
+    reset();
+    return;
+  }
+  
+  all_blocks.clear();
+  for(uint i = 0 ; i < n ; i += BLOCK_SIZE){
+    const uint i_end = std::min(i + BLOCK_SIZE, n);
+    vector<CommandLine> lines;
+    lines.reserve(i_end - i);
+    for(uint j = i ; j < i_end ; ++j){
+      lines.push_back({all_text[j], all_fmt[j], all_ending_quotes[j]});
+    }
+    all_blocks.push_back(std::move(lines));
+  }
+  
+  update_starts(0);
+}
+
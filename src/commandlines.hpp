@@ -0,0 +1,120 @@
+    //=========================================================================//
+   //            Author: Laurent R. Bergé, University of Bordeaux             //
+  //             Copyright (C) 2025-present, Laurent R. Bergé                //
+ //              MIT License (see project_root/LICENSE)                     //
+//=========================================================================//
+
+#pragma once
+
+#include "stringtools.hpp"
+#include "constants.hpp"
+#include "util.hpp"
+
+#include <string>
+#include <vector>
+
+using std::vector;
+using std::string;
+
+using uint = unsigned int;
+
+// Implementation notes:
+// - CommandLines stores the lines of the command being edited, with their
+//   formatted version and their ending quote (the three were parallel vectors)
+// - the lines are stored in blocks of at most 2 * BLOCK_SIZE lines, and we keep
+//   the index of the first line of each block:
+//   * line lookup: binary search on the block starts
+//   * insertion/deletion of a line: only the lines of one block are shifted,
+//     then the starts of the next blocks are updated (integers only)
+//   => pasting a script of several thousand lines is not quadratic anymore
+// - the addresses of the lines are NOT stable: any insertion/deletion may move
+//   them, like with a vector (ConsoleCommand::pline must be reset afterwards)
+// - the existing code accesses the lines with the views all_lines, all_lines_fmt
+//   and all_ending_quotes, which behave like the former vectors
+//
+
+
+//
+// CommandLines ----------------------------------------------------------------
+//
+
+
+struct CommandLine {
+  stringtools::string_utf8 text;
+  string fmt = UNSET::STRING;
+  char ending_quote = NOT_A_QUOTE;
+};
+
+class CommandLines {
+  static const uint BLOCK_SIZE = 64;
+  
+  vector<vector<CommandLine>> all_blocks;
+  // index of the first line of each block
+  vector<uint> block_start;
+  uint n_lines = 0;
+  
+  void locate(uint i, uint &block, uint &pos) const;
+  void split_block(uint block);
+  void update_starts(uint from_block);
+
+public:
+  // always at least one line
+  CommandLines(){ reset(); }
+  
+  uint size() const { return n_lines; }
+  
+  CommandLine& at(uint i);
+  const CommandLine& at(uint i) const;
+  
+  // a single empty line
+  void reset();
+  
+  void push_back(CommandLine &&x);
+  void insert(uint i, CommandLine &&x);
+  void insert(uint i, vector<CommandLine> &&all_x);
+  void erase(uint i);
+  
+  void assign(const vector<stringtools::string_utf8> &all_text, const vector<string> &all_fmt,
+              const vector<char> &all_ending_quotes);
+};
+
+
+//
+// CommandLinesView ------------------------------------------------------------
+//
+
+
+// access to one field of the lines, as if it were a vector
+template<typename T, T CommandLine::*field>
+class CommandLinesView {
+  CommandLines *plines = nullptr;
+
+public:
+  CommandLinesView(CommandLines *plines): plines(plines) {}
+  
+  // a view is bound to its lines for life
+  CommandLinesView(const CommandLinesView&) = delete;
+  CommandLinesView& operator=(const CommandLinesView&) = delete;
+  
+  uint size() const { return plines->size(); }
+  
+  T& operator[](uint i){ return plines->at(i).*field; }
+  const T& operator[](uint i) const { return plines->at(i).*field; }
+  
+  T& back(){ return plines->at(plines->size() - 1).*field; }
+  const T& back() const { return plines->at(plines->size() - 1).*field; }
+  
+  vector<T> to_vector() const {
+    vector<T> res;
+    res.reserve(plines->size());
+    for(uint i = 0 ; i < plines->size() ; ++i){
+      res.push_back(plines->at(i).*field);
+    }
+    return res;
+  }
+};
+
+using CommandTextView = CommandLinesView<stringtools::string_utf8, &CommandLine::text>;
+using CommandFmtView = CommandLinesView<string, &CommandLine::fmt>;
+using CommandQuoteView = CommandLinesView<char, &CommandLine::ending_quote>;
+
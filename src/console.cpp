@@ -869,19 +869,15 @@ void ConsoleCommand::join_lines(int side){
   
   std::cout << VTS::delete_lines(n_lines_to_del);
   
-  str::string_utf8 line_above = all_lines[cursor_str_y];
-  const str::string_utf8 line_below = all_lines[cursor_str_y + 1];
+  const str::string_utf8 line_below = std::move(all_lines[cursor_str_y + 1]);
   
   // we delete the existing data on the line below
-  all_lines.erase(all_lines.begin() + cursor_str_y + 1);
-  all_lines_fmt.erase(all_lines_fmt.begin() + cursor_str_y + 1);
-  all_ending_quotes.erase(all_ending_quotes.begin() + cursor_str_y + 1);
+  lines.erase(cursor_str_y + 1);
+  pline = &all_lines[cursor_str_y];
   
   // we place the cursor at the right x-position
-  cursors_set_str_x(line_above.size());
-  line_above.push_back(line_below.str());
-  all_lines[cursor_str_y] = line_above;
-  pline = &all_lines[cursor_str_y];
+  cursors_set_str_x(pline->size());
+  pline->push_back(line_below.str());
   
   
   colorize();
@@ -1100,7 +1096,7 @@ void ConsoleCommand::move_x(int side, bool is_ctrl, bool is_shift, bool is_alt){
       
       if(is_alt){
         // jump to paren
-        new_pos = str::go_to_next_inner_paren(pline->str(), cursor_str_x, side == SIDE::LEFT);
+        new_pos = str::go_to_next_inner_paren(*pline, cursor_str_x, side == SIDE::LEFT);
         
       } else {
         
@@ -1352,7 +1348,7 @@ void ConsoleCommand::add_char(const string &val, bool is_sequence){
       cursor_str_x = 1;
       
     } else if(str::is_closing_paren(c) && pline->size() > cursor_str_x && 
-       (*pline)[cursor_str_x] == c && str::is_open_paren_left(pline->str(), narrow_cursor_str_x, c)){
+       (*pline)[cursor_str_x] == c && str::is_open_paren_left(pline->paren_index(), narrow_cursor_str_x, c)){
       // val    = ')'
       // line   = hello(|)
       // cursor =       |
@@ -1378,7 +1374,7 @@ void ConsoleCommand::add_char(const string &val, bool is_sequence){
         pline->insert(cursor_str_x, val);
         ++cursor_str_x;
         
-      } else if(str::is_paren(c) && pline->size() > cursor_str_x && c == str::pair_quote_paren_char((*pline)[cursor_str_x]) && !str::any_open_paren_before(pline->str(), c, cursor_str_x - 1)){
+      } else if(str::is_paren(c) && pline->size() > cursor_str_x && c == str::pair_quote_paren_char((*pline)[cursor_str_x]) && !str::any_open_paren_before(*pline, c, cursor_str_x)){
         // we don't automatch when there's the closing paren and it's appropriate not to automatch
         // bon(jour|) => bon(jour(|))
         // jour|) => jour(|)
@@ -1506,12 +1502,9 @@ void ConsoleCommand::add_line(){
     empty_line.insert(0, tab);
   }
   
-  all_lines.push_back(empty_line);
+  lines.push_back({empty_line, tab, NOT_A_QUOTE});
   pline = &all_lines.back();
   
-  all_lines_fmt.push_back(tab);
-  all_ending_quotes.push_back(NOT_A_QUOTE);
-  
   // we move y down
   
   cursors_increment_str_y();
@@ -1521,6 +1514,43 @@ void ConsoleCommand::add_line(){
   
 }
 
+void ConsoleCommand::add_lines(const vector<string> &all_text){
+  // bulk version of add_char + add_line, used for the sequences (paste):
+  // - the first line is inserted at the cursor, the next ones are appended
+  //   to the command in one insertion
+  // - the command is colorized, printed and saved once, not once per line
+  
+  if(all_text.empty()){
+    return;
+  }
+  
+  quit_autocomp();
+  clear_selection();
+  last_action = CON_ACTIONS::INSERT;
+  
+  pline->insert(cursor_str_x, all_text[0]);
+  cursor_str_x += str::utf8::count_wide_chars(all_text[0]);
+  
+  vector<CommandLine> new_lines;
+  new_lines.reserve(all_text.size() - 1);
+  for(uint i = 1 ; i < all_text.size() ; ++i){
+    new_lines.push_back({str::string_utf8{all_text[i]}, UNSET::STRING, NOT_A_QUOTE});
+  }
+  lines.insert(all_lines.size(), std::move(new_lines));
+  
+  // colorization from the current line: the new lines are unset => all are processed
+  pline = &all_lines[cursor_str_y];
+  colorize();
+  
+  // we end up at the end of the last line
+  cursor_str_y = all_lines.size() - 1;
+  pline = &all_lines[cursor_str_y];
+  cursor_str_x = pline->size();
+  
+  print_command(true);
+  
+}
+
 void ConsoleCommand::insert_newline(){
   // this is different from add_line => here we insert the newline
   // at the current cursor position
@@ -1549,10 +1579,7 @@ void ConsoleCommand::insert_newline(){
   }
   
   all_lines[cursor_str_y] = line_top;
-  all_lines.insert(all_lines.begin() + cursor_str_y + 1, line_below);
-  
-  all_lines_fmt.insert(all_lines_fmt.begin() + cursor_str_y + 1, UNSET::STRING);
-  all_ending_quotes.insert(all_ending_quotes.begin() + cursor_str_y + 1, NOT_A_QUOTE);
+  lines.insert(cursor_str_y + 1, {line_below, UNSET::STRING, NOT_A_QUOTE});
   
   cursor_str_x = tab_size;
   pline = &all_lines.back();
@@ -1580,10 +1607,8 @@ void ConsoleCommand::reset_all_lines(){
   cursor_term_x = 0;
   cursor_term_y = 0;
   
-  all_lines = vector<str::string_utf8>{str::string_utf8()};
+  lines.reset();
   pline = &all_lines[0];
-  all_lines_fmt = vector<string>{UNSET::STRING};
-  all_ending_quotes = vector<char>{NOT_A_QUOTE};
   
   any_long_line = false;
 }
@@ -1598,7 +1623,7 @@ void ConsoleCommand::flush_cmd(bool save, bool is_tmp){
   }
   
   // we save to the history
-  if(save && !phist->is_ignored_cmd(all_lines)){
+  if(save && !phist->is_ignored_cmd(all_lines.to_vector())){
     phist->add_command(is_tmp);
     if(!is_tmp){
       phist->append_history_line();
@@ -1780,9 +1805,9 @@ void ConsoleCommand::run_autocomp(){
       
       // we need to keep track of the ID the entry refers to
       const int n = past_commands.size();
-      vector<string> hist_id(n);
+      vector<int> hist_id(n);
       for(int i = 0 ; i < n ; ++i){
-        hist_id[i] = std::to_string((n - 1) - i);
+        hist_id[i] = (n - 1) - i;
       }
       
       str::MetaStringVec past_commands_msv(past_commands);
@@ -2444,7 +2469,7 @@ size_t ConsoleCommand::colorize(bool paren_highlight){
   //
   
   if(paren_highlight && !is_sel && sequence.empty()){
-    str::ParenMatcher info_paren(pline->str(), cursor_str_x);
+    str::ParenMatcher info_paren(*pline, cursor_str_x);
     if(info_paren.pair_found){
       
       // paren is found, we need to convert into VTS
@@ -2599,7 +2624,7 @@ void ConsoleCommand::print_command(bool full, bool paren_highlight, uint str_y_e
       any_long_line = true;
       
       const uint w = get_line_max_width(str_y);
-      vector<string> line_split = str::str_split_at_width(line, w);
+      vector<std::string_view> line_split = str::str_split_at_width(line, w);
       
       if(line_split.size() != h){
         util::error_msg("Internal error in print_command:\n",
@@ -2687,7 +2712,7 @@ void ConsoleCommand::print_command_grey(){
     } else {
       
       const uint w = get_line_max_width(str_y);
-      vector<string> line_split = str::str_split_at_width(line, w);
+      vector<std::string_view> line_split = str::str_split_at_width(line, w);
       
       if(line_split.size() != h){
         util::error_msg("Internal error in print_command:\n",
@@ -2823,9 +2848,7 @@ string ConsoleCommand::collect_fmt(){
 
 void ConsoleCommand::copy_cmd(const ConsoleCommandSummary &new_cmd){
   
-  all_lines = new_cmd.all_lines;
-  all_lines_fmt = new_cmd.all_lines_fmt;
-  all_ending_quotes = new_cmd.all_ending_quotes;
+  lines.assign(new_cmd.all_lines, new_cmd.all_lines_fmt, new_cmd.all_ending_quotes);
   
   cursor_str_x = new_cmd.cursor_str_x;
   cursor_str_y = new_cmd.cursor_str_y;
@@ -3657,7 +3680,16 @@ CommandToEvaluate ConsoleCommand::read_command(bool is_command, string hist_name
       command_front = false;
       
       // we get the first command
+      // NOTA:
+      // - once a command is continued (enter() added a line), its next lines
+      //   are only parsed: they are inserted in bulk, and the command printed
+      //   once, when it is complete or when the sequence ends
+      // - each line still requires a parse of the command: the first complete
+      //   command must be sent right away
       in_sequence = true;
+      bool is_continued = false;
+      vector<string> next_lines;
+      string next_cmd;
       while(!sequence.empty()){
         string str = sequence.pop_front();
         
@@ -3665,15 +3697,38 @@ CommandToEvaluate ConsoleCommand::read_command(bool is_command, string hist_name
           str.erase(str.begin(), str.begin() + trim_front.size());
         }
         
-        add_char(str, true);
+        if(is_continued){
+          // the first line goes into the empty line added by enter()
+          next_cmd += next_lines.empty() ? str : "\n" + str;
+          next_lines.push_back(str);
+          if(sequence.is_enter() && plgsrv->parse_command(next_cmd).is_continuation){
+            continue;
+          }
+          
+          add_lines(next_lines);
+          next_lines.clear();
+          is_continued = false;
+          
+        } else {
+          add_char(str, true);
+        }
+        
         if(sequence.is_enter()){
           // cout << "ENTER -- size = " << sequence.size();
+          const uint n_lines_before = all_lines.size();
           CommandToEvaluate res = enter();
             
           if(res.is_complete){
             past_command_from_sequence = true;
             return res;
           }
+          
+          if(all_lines.size() == n_lines_before + 1 && !in_autocomp && !is_special_command() && 
+             program_opts.get_option("shortcut.enter").get_shortcut().empty()){
+            // the command continues on the new line
+            is_continued = true;
+            next_cmd = collect();
+          }
         }
       }
       in_sequence = false;
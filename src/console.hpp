@@ -20,6 +20,7 @@
 #include "specialfunctions.hpp"
 #include "history.hpp"
 #include "console_util.hpp"
+#include "commandlines.hpp"
 
 #include <windows.h>
 #ifdef TRUE
@@ -316,10 +317,12 @@ private:
   void (*Run_While_Reading_fun)() = nullptr;           // function to run at some interval
   
   // lines composing the command
-  vector<stringtools::string_utf8> all_lines{stringtools::string_utf8()};
+  // NOTA: all_lines, all_lines_fmt and all_ending_quotes are views on the lines
+  CommandLines lines;
+  CommandTextView all_lines{&lines};
   stringtools::string_utf8 *pline;
-  vector<string> all_lines_fmt{UNSET::STRING};
-  vector<char> all_ending_quotes{NOT_A_QUOTE};
+  CommandFmtView all_lines_fmt{&lines};
+  CommandQuoteView all_ending_quotes{&lines};
   string inline_comment;
   
   vector<string> io_backup;
@@ -429,6 +432,7 @@ private:
   void move_y(int, bool);
   void add_char(const string&, bool is_sequence = false);
   void add_line();
+  void add_lines(const vector<string> &all_text);
   void delete_all_left();
   void delete_all_right();
   void delete_current_line();
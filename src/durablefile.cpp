@@ -0,0 +1,241 @@
+    //=========================================================================//
+   //            Author: Laurent R. Bergé, University of Bordeaux             //
+  //             Copyright (C) 2025-present, Laurent R. Bergé                //
+ //              MIT License (see project_root/LICENSE)                     //
+//=========================================================================//
+
+#include "durablefile.hpp"
+
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+
+// NOTA: the file layer is also built headlessly on Linux (see test_durablefile)
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/file.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+int report_error(const util::DoCheck &opt, const string &err){
+  
+  if(opt.is_check()){
+    if(opt.is_set_error()){
+      opt.set_error(err);
+    } else {
+      util::error_msg(err);
+    }
+  }
+  
+  return 1;
+}
+
+#ifdef _WIN32
+
+string process_id(){
+  return std::to_string(GetCurrentProcessId());
+}
+
+// writes the full content and flushes it to the disk
+bool write_and_sync(const fs::path &path, const string &content, bool append){
+  
+  HANDLE h_file = CreateFileW(path.wstring().c_str(), append ? FILE_APPEND_DATA : GENERIC_WRITE,
+                              FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+                              append ? OPEN_ALWAYS : CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if(h_file == INVALID_HANDLE_VALUE){
+    return false;
+  }
+  
+  bool is_ok = true;
+  size_t n_written = 0;
+  while(is_ok && n_written < content.size()){
+    const DWORD n_chunk = static_cast<DWORD>(std::min<size_t>(content.size() - n_written, 1 << 30));
+    DWORD n_done = 0;
+    is_ok = WriteFile(h_file, content.data() + n_written, n_chunk, &n_done, nullptr) && n_done > 0;
+    n_written += n_done;
+  }
+  
+  is_ok = is_ok && FlushFileBuffers(h_file);
+  CloseHandle(h_file);
+  
+  return is_ok;
+}
+
+bool replace_file(const fs::path &from, const fs::path &to){
+  
+  // NOTA: about half a second in total
+  for(int attempt = 1 ; attempt <= 10 ; ++attempt){
+    if(MoveFileExW(from.wstring().c_str(), to.wstring().c_str(),
+                   MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)){
+      return true;
+    }
+    
+    std::this_thread::sleep_for(std::chrono::milliseconds(10 * attempt));
+  }
+  
+  return false;
+}
+
+#else
+
+string process_id(){
+  return std::to_string(getpid());
+}
+
+bool write_and_sync(const fs::path &path, const string &content, bool append){
+  
+  const int flags = O_WRONLY | O_CREAT | (append ? O_APPEND : O_TRUNC);
+  const int fd = ::open(path.c_str(), flags, 0644);
+  if(fd == -1){
+    return false;
+  }
+  
+  bool is_ok = true;
+  size_t n_written = 0;
+  while(is_ok && n_written < content.size()){
+    const ssize_t n_done = ::write(fd, content.data() + n_written, content.size() - n_written);
+    is_ok = n_done > 0;
+    n_written += is_ok ? n_done : 0;
+  }
+  
+  is_ok = is_ok && fsync(fd) == 0;
+  ::close(fd);
+  
+  return is_ok;
+}
+
+bool replace_file(const fs::path &from, const fs::path &to){
+  
+  if(std::rename(from.c_str(), to.c_str()) != 0){
+    return false;
+  }
+  
+  // the rename itself is made durable
+  const int fd_dir = ::open(to.parent_path().empty() ? "." : to.parent_path().c_str(), O_RDONLY);
+  if(fd_dir != -1){
+    fsync(fd_dir);
+    ::close(fd_dir);
+  }
+  
+  return true;
+}
+
+#endif
+
+} // end anonymous namespace
+
+//
+// FileLock --------------------------------------------------------------------
+//
+
+#ifdef _WIN32
+
+FileLock::FileLock(const fs::path &target){
+  
+  fs::path lock_path = target;
+  lock_path += ".lock";
+  
+  HANDLE h_file = CreateFileW(lock_path.wstring().c_str(), GENERIC_READ | GENERIC_WRITE,
+                              FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+                              OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if(h_file == INVALID_HANDLE_VALUE){
+    return;
+  }
+  
+  OVERLAPPED overlapped = {};
+  if(!LockFileEx(h_file, LOCKFILE_EXCLUSIVE_LOCK, 0, MAXDWORD, MAXDWORD, &overlapped)){
+    CloseHandle(h_file);
+    return;
+  }
+  
+  handle = h_file;
+}
+
+FileLock::~FileLock(){
+  if(handle){
+    OVERLAPPED overlapped = {};
+    UnlockFileEx(handle, 0, MAXDWORD, MAXDWORD, &overlapped);
+    CloseHandle(handle);
+  }
+}
+
+bool FileLock::is_locked() const {
+  return handle != nullptr;
+}
+
+#else
+
+FileLock::FileLock(const fs::path &target){
+  
+  fs::path lock_path = target;
+  lock_path += ".lock";
+  
+  fd = ::open(lock_path.c_str(), O_RDWR | O_CREAT, 0644);
+  if(fd == -1){
+    return;
+  }
+  
+  if(flock(fd, LOCK_EX) != 0){
+    ::close(fd);
+    fd = -1;
+  }
+}
+
+FileLock::~FileLock(){
+  if(fd != -1){
+    flock(fd, LOCK_UN);
+    ::close(fd);
+  }
+}
+
+bool FileLock::is_locked() const {
+  return fd != -1;
+}
+
+#endif
+
+//
+// writers ---------------------------------------------------------------------
+//
+
+int write_file_atomic(const fs::path &path, const string &content, util::DoCheck opt){
+  
+  // the temporary file is unique to the process and to the call
+  static std::atomic<uint32_t> n_tmp{0};
+  fs::path tmp_path = path;
+  tmp_path += ".tmp" + process_id() + "_" + std::to_string(n_tmp++);
+  
+  std::error_code ec;
+  
+  if(!write_and_sync(tmp_path, content, false)){
+    fs::remove(tmp_path, ec);
+    return report_error(opt, util::txt("Could not write the temporary file:\n'", tmp_path.string(), "'"));
+  }
+  
+  if(!replace_file(tmp_path, path)){
+    fs::remove(tmp_path, ec);
+    return report_error(opt, util::txt("Could not replace the file:\n'", path.string(), "'"));
+  }
+  
+  return 0;
+}
+
+int append_file_locked(const fs::path &path, const string &content, util::DoCheck opt){
+  
+  FileLock lock(path);
+  if(!lock.is_locked()){
+    return report_error(opt, util::txt("Could not lock the file:\n'", path.string(), "'"));
+  }
+  
+  if(!write_and_sync(path, content, true)){
+    return report_error(opt, util::txt("Could not append to the file:\n'", path.string(), "'"));
+  }
+  
+  return 0;
+}
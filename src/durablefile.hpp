@@ -0,0 +1,59 @@
+    //=========================================================================//
+   //            Author: Laurent R. Bergé, University of Bordeaux             //
+  //             Copyright (C) 2025-present, Laurent R. Bergé                //
+ //              MIT License (see project_root/LICENSE)                     //
+//=========================================================================//
+
+#pragma once
+
+#include "util.hpp"
+
+#include <string>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+using std::string;
+
+// Implementation notes:
+// - several instances of the program write the same files (history, caches)
+// - write_file_atomic: the content is written in a temporary file in the same
+//   folder, flushed to the disk, then renamed over the target
+//   => the readers see the old or the new file, never a partial one, and a
+//   crash during the write keeps the old file
+// - FileLock: blocking advisory lock on "<target>.lock", released at destruction.
+//   The lock is not taken on the target itself since the target is replaced
+//   by the renames
+// - append_file_locked: the appends take the lock => they do not interleave
+//   with the appends or the read-modify-rewrites of the other instances
+//   (which must also hold the lock)
+// - on Windows, the rename is retried a few times: the target can be briefly
+//   opened without FILE_SHARE_DELETE by another program (antivirus, indexer)
+// - windows.h is only included in the .cpp (TRUE/FALSE would clash with R)
+//
+
+class FileLock {
+#ifdef _WIN32
+  void *handle = nullptr;
+#else
+  int fd = -1;
+#endif
+
+public:
+  FileLock() = delete;
+  FileLock(const FileLock&) = delete;
+  FileLock& operator=(const FileLock&) = delete;
+  
+  // blocks until the lock is acquired
+  explicit FileLock(const fs::path &target);
+  ~FileLock();
+  
+  // false if the lock file could not be created or locked
+  bool is_locked() const;
+};
+
+// 0 on success, like util::create_parent_path
+int write_file_atomic(const fs::path &path, const string &content,
+                      util::DoCheck opt = util::DoCheck(false));
+
+int append_file_locked(const fs::path &path, const string &content,
+                       util::DoCheck opt = util::DoCheck(false));
@@ -6,6 +6,7 @@
 
 #include "history.hpp"
 #include "console.hpp"
+#include "durablefile.hpp"
 
 
 //
@@ -16,10 +17,10 @@
 ConsoleCommandSummary::ConsoleCommandSummary(ConsoleCommand *pconcom): type(TYPE::SET) {
   
   // we trim WS for one liners
-  all_lines = pconcom->all_lines;
-  all_lines_fmt = pconcom->all_lines_fmt;
+  all_lines = pconcom->all_lines.to_vector();
+  all_lines_fmt = pconcom->all_lines_fmt.to_vector();
   
-  all_ending_quotes = pconcom->all_ending_quotes;
+  all_ending_quotes = pconcom->all_ending_quotes.to_vector();
   cursor_str_x = pconcom->cursor_str_x;
   cursor_str_y = pconcom->cursor_str_y;
   hash = pconcom->hash();
@@ -90,6 +91,10 @@ ConsoleHistory::ConsoleHistory(ConsoleCommand *pcon, const string program_name){
     return;
   }
   
+  // NOTA: the lock is held until the history is rewritten (step 3)
+  // => the other instances cannot append in between
+  FileLock lock(hist_path);
+  
   // we read the file
   std::ifstream hist_file(hist_path);
   if(!hist_file.is_open()){
@@ -104,7 +109,8 @@ ConsoleHistory::ConsoleHistory(ConsoleCommand *pcon, const string program_name){
   std::string line;
   std::vector<std::string> all_cmd;
   vector<ConsoleCommandSummary> all_past_commands;
-  vector<size_t> all_hash;
+  // the lines of each command, to find the duplicates
+  vector<vector<string>> all_cmd_lines;
   while(std::getline(hist_file, line)){
     if(line.empty()){
       // nothing
@@ -116,9 +122,8 @@ ConsoleHistory::ConsoleHistory(ConsoleCommand *pcon, const string program_name){
       all_cmd.push_back(line);
       ConsoleCommandSummary cmd_sum(all_cmd);
       
-      all_hash.push_back(cmd_sum.hash);
-      
       all_past_commands.push_back(cmd_sum);
+      all_cmd_lines.push_back(std::move(all_cmd));
       all_cmd.clear();
     }
   }
@@ -136,9 +141,10 @@ ConsoleHistory::ConsoleHistory(ConsoleCommand *pcon, const string program_name){
   // fact the oldest ones => we respect that here (we start from the end)
   // 
   const uint MAX_HIST_ENTRIES = 800;
-  IndexInfo index = to_index(all_hash, to_indexOpts().reverse());
+  // NOTA: the commands are compared, not their hashes => no collision
+  IndexInfo index = to_index(all_cmd_lines, to_indexOpts().reverse());
   
-  const vector<size_t> first_obs = index.get_first_obs();
+  const vector<size_t> &first_obs = index.get_first_obs();
   const uint start = min(first_obs.size() - 1, MAX_HIST_ENTRIES - 1);
   uint j = 0;
   for(int i=start ; i>=0 ; --i){
@@ -163,24 +169,26 @@ void ConsoleHistory::write_history(){
     return;
   }
   
-  std::ofstream hist_file_out(hist_path);
-  if(!hist_file_out.is_open()){
-    std::cerr << "Could not write into the existing history located at:\n'" << hist_path << "'\n";
-    return;
-  }
+  // NOTA:
+  // - the file is replaced in one step: a crash never loses the history
+  // - the caller holds the lock of the history
   
+  string content;
   const uint n = past_commands.size();
   for(uint i=0 ; i<n ; ++i){
     vector<str::string_utf8> cmd_utf8(past_commands[i].all_lines);
     const uint nlines = cmd_utf8.size();
     for(uint j=0 ; j+1<nlines ; ++j){
-      hist_file_out << cmd_utf8[j].str() << "\\\n";
+      content += cmd_utf8[j].str() + "\\\n";
     }
-    hist_file_out << cmd_utf8[nlines - 1].str() << "\n";
+    content += cmd_utf8[nlines - 1].str() + "\n";
   }
-  hist_file_out << "\n";
+  content += "\n";
   
-  hist_file_out.close();
+  string err;
+  if(write_file_atomic(hist_path, content, util::DoCheck(err)) != 0){
+    std::cerr << "Could not write into the existing history located at:\n'" << hist_path << "'\n" << err << "\n";
+  }
 }
 
 void ConsoleHistory::append_history_line(){
@@ -209,18 +217,17 @@ void ConsoleHistory::append_history_line(){
     return;
   }
   
-  std::ofstream hist_file_out(hist_path, std::ios::app);
-  if(!hist_file_out.is_open()){
-    std::cerr << "Could not write into the existing history located at:\n'" << hist_path << "'\n";
-    return;
-  }
-  
+  string content;
   for(uint j=0 ; j+1<nlines ; ++j){
-    hist_file_out << cmd_utf8[j].str() << "\\\n";
+    content += cmd_utf8[j].str() + "\\\n";
   }
-  hist_file_out << cmd_utf8[nlines - 1].str() << "\n";
+  content += cmd_utf8[nlines - 1].str() + "\n";
   
-  hist_file_out.close();
+  // NOTA: the appends of the other instances are not interleaved (lock)
+  string err;
+  if(append_file_locked(hist_path, content, util::DoCheck(err)) != 0){
+    std::cerr << "Could not write into the existing history located at:\n'" << hist_path << "'\n" << err << "\n";
+  }
 }
 
 void ConsoleHistory::navigate(int direction, bool &any_update, bool any_action){
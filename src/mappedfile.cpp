@@ -0,0 +1,102 @@
+    //=========================================================================//
+   //            Author: Laurent R. Bergé, University of Bordeaux             //
+  //             Copyright (C) 2025-present, Laurent R. Bergé                //
+ //              MIT License (see project_root/LICENSE)                     //
+//=========================================================================//
+
+#include "mappedfile.hpp"
+
+// NOTA: the file layer is also built headlessly on Linux (see test_cache)
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+bool MappedFile::open(const fs::path &path){
+  
+  close();
+  
+  HANDLE h_file = CreateFileW(path.wstring().c_str(), GENERIC_READ,
+                              FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if(h_file == INVALID_HANDLE_VALUE){
+    return false;
+  }
+  
+  LARGE_INTEGER file_size;
+  if(!GetFileSizeEx(h_file, &file_size) || file_size.QuadPart == 0){
+    // NOTA: an empty file cannot be mapped
+    CloseHandle(h_file);
+    return false;
+  }
+  
+  HANDLE h_map = CreateFileMappingW(h_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  CloseHandle(h_file);
+  if(h_map == nullptr){
+    return false;
+  }
+  
+  void *pview = MapViewOfFile(h_map, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(h_map);
+  if(pview == nullptr){
+    return false;
+  }
+  
+  pdata = static_cast<const char*>(pview);
+  n_bytes = static_cast<size_t>(file_size.QuadPart);
+  
+  return true;
+}
+
+void MappedFile::close(){
+  if(pdata){
+    UnmapViewOfFile(pdata);
+    pdata = nullptr;
+    n_bytes = 0;
+  }
+}
+
+#else
+
+bool MappedFile::open(const fs::path &path){
+  
+  close();
+  
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if(fd == -1){
+    return false;
+  }
+  
+  struct stat file_stat;
+  if(fstat(fd, &file_stat) != 0 || file_stat.st_size == 0){
+    ::close(fd);
+    return false;
+  }
+  
+  void *pview = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if(pview == MAP_FAILED){
+    return false;
+  }
+  
+  pdata = static_cast<const char*>(pview);
+  n_bytes = static_cast<size_t>(file_stat.st_size);
+  
+  return true;
+}
+
+void MappedFile::close(){
+  if(pdata){
+    munmap(const_cast<char*>(pdata), n_bytes);
+    pdata = nullptr;
+    n_bytes = 0;
+  }
+}
+
+#endif
@@ -0,0 +1,41 @@
+    //=========================================================================//
+   //            Author: Laurent R. Bergé, University of Bordeaux             //
+  //             Copyright (C) 2025-present, Laurent R. Bergé                //
+ //              MIT License (see project_root/LICENSE)                     //
+//=========================================================================//
+
+#pragma once
+
+#include <filesystem>
+#include <cstddef>
+
+namespace fs = std::filesystem;
+
+// Implementation notes:
+// - a read only view on the full content of a file, mapped in memory
+// - the handles are closed once the view is created: only the view is kept
+// - on Windows a file cannot be deleted or replaced (renamed over) while it
+//   has a mapped view, whatever the share flags => keep the view only briefly
+//   when other processes may write the file (see CachedData::read_binary).
+//   On POSIX systems, the view stays valid and keeps the old content
+// - windows.h is only included in the .cpp (TRUE/FALSE would clash with R)
+//
+
+class MappedFile {
+  const char *pdata = nullptr;
+  size_t n_bytes = 0;
+
+public:
+  MappedFile() = default;
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  ~MappedFile(){ close(); }
+  
+  // false if the file does not exist, is empty or cannot be mapped
+  bool open(const fs::path &path);
+  void close();
+  
+  bool is_open() const { return pdata != nullptr; }
+  const char* data() const { return pdata; }
+  size_t size() const { return n_bytes; }
+};
@@ -0,0 +1,451 @@
+    //=========================================================================//
+   //            Author: Laurent R. Bergé, University of Bordeaux             //
+  //             Copyright (C) 2025-present, Laurent R. Bergé                //
+ //              MIT License (see project_root/LICENSE)                     //
+//=========================================================================//
+
+#include "matchindex.hpp"
+
+#include <algorithm>
+#include <list>
+
+namespace stringtools {
+
+size_t MatchIndex::min_size = 2000;
+
+namespace {
+
+// number of indexes we keep in memory
+// => one for each large set of choices: functions, packages, CRAN, data sets
+const size_t CACHE_SIZE = 4;
+
+// most recently used first
+std::list<std::shared_ptr<const MatchIndex>> index_cache;
+
+inline int popcount(uint64_t x){
+  int res = 0;
+  while(x){
+    x &= x - 1;
+    ++res;
+  }
+  return res;
+}
+
+inline vector<uint32_t> unique_trigrams(std::string_view x){
+  vector<uint32_t> res;
+  const size_t n = x.size();
+  if(n < 3){
+    return res;
+  }
+  
+  res.reserve(n - 2);
+  for(size_t i = 0 ; i + 2 < n ; ++i){
+    res.push_back(trigram_key(x[i], x[i + 1], x[i + 2]));
+  }
+  
+  std::sort(res.begin(), res.end());
+  res.erase(std::unique(res.begin(), res.end()), res.end());
+  
+  return res;
+}
+
+} // end anonymous namespace
+
+vector<uint32_t> intersect_sorted(const vector<uint32_t> &x, const vector<uint32_t> &y){
+  vector<uint32_t> res;
+  res.reserve(std::min(x.size(), y.size()));
+  std::set_intersection(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(res));
+  return res;
+}
+
+MatchIndex::MatchIndex(const vec_id &ids): all_ids(ids){
+  
+  n = ids.size();
+  fingerprint = content_fingerprint(ids);
+  
+  //
+  // lower case + masks
+  //
+  
+  const StringPool &pool = get_string_pool();
+  pool_generation = pool.get_generation();
+  
+  size_t total_bytes = 0;
+  for(const auto &id : ids){
+    total_bytes += pool.view(id).size();
+  }
+  
+  lowered_data.reserve(total_bytes);
+  lowered_start.resize(n + 1);
+  all_masks.resize(n);
+  for(size_t i = 0 ; i < n ; ++i){
+    lowered_start[i] = lowered_data.size();
+    uint64_t mask = 0;
+    for(const auto &c : pool.view(ids[i])){
+      const char c_low = fold_ascii(c);
+      lowered_data.push_back(c_low);
+      mask |= char_bit(c_low);
+    }
+    all_masks[i] = mask;
+  }
+  lowered_start[n] = lowered_data.size();
+  
+  //
+  // first letters
+  //
+  
+  // counting sort => ids are in increasing order within each bucket
+  bucket_start.assign(257, 0);
+  for(size_t i = 0 ; i < n ; ++i){
+    const std::string_view low = lowered_at(i);
+    if(!low.empty()){
+      ++bucket_start[static_cast<unsigned char>(low[0]) + 1];
+    }
+  }
+  
+  for(size_t c = 1 ; c < 257 ; ++c){
+    bucket_start[c] += bucket_start[c - 1];
+  }
+  
+  bucket_ids.resize(bucket_start[256]);
+  vector<uint32_t> bucket_pos(bucket_start.begin(), bucket_start.end() - 1);
+  for(size_t i = 0 ; i < n ; ++i){
+    const std::string_view low = lowered_at(i);
+    if(!low.empty()){
+      bucket_ids[bucket_pos[static_cast<unsigned char>(low[0])]++] = i;
+    }
+  }
+  
+  //
+  // trigrams
+  //
+  
+  // we stack (key, id) pairs and sort them: ids are increasing within each key
+  vector<uint64_t> all_pairs;
+  all_pairs.reserve(total_bytes);
+  for(size_t i = 0 ; i < n ; ++i){
+    for(const auto &key : unique_trigrams(lowered_at(i))){
+      all_pairs.push_back((static_cast<uint64_t>(key) << 32) | i);
+    }
+  }
+  
+  std::sort(all_pairs.begin(), all_pairs.end());
+  
+  trigram_ids.resize(all_pairs.size());
+  uint32_t current_key = 0;
+  for(size_t k = 0 ; k < all_pairs.size() ; ++k){
+    const uint32_t key = all_pairs[k] >> 32;
+    if(k == 0 || key != current_key){
+      current_key = key;
+      trigram_keys.push_back(key);
+      trigram_start.push_back(k);
+    }
+    trigram_ids[k] = static_cast<uint32_t>(all_pairs[k]);
+  }
+  trigram_start.push_back(all_pairs.size());
+
+}
+
+void MatchIndex::first_letter_bucket(const unsigned char c, const uint32_t *&first,
+                                     const uint32_t *&last) const {
+  const unsigned char c_low = fold_ascii(c);
+  first = bucket_ids.data() + bucket_start[c_low];
+  last = bucket_ids.data() + bucket_start[c_low + 1];
+}
+
+bool MatchIndex::find_trigram(const uint32_t key, const uint32_t *&first, const uint32_t *&last) const {
+  auto it = std::lower_bound(trigram_keys.begin(), trigram_keys.end(), key);
+  if(it == trigram_keys.end() || *it != key){
+    return false;
+  }
+  
+  const size_t k = it - trigram_keys.begin();
+  first = trigram_ids.data() + trigram_start[k];
+  last = trigram_ids.data() + trigram_start[k + 1];
+  
+  return true;
+}
+
+vector<uint32_t> MatchIndex::inclusion_candidates(const string &x) const {
+  // x is included in y => all the characters of x are in y
+  //                    => all the trigrams of x are in y
+  
+  vector<uint32_t> res;
+  const uint64_t x_mask = char_mask(x);
+  
+  if(x.size() < 3){
+    for(size_t i = 0 ; i < n ; ++i){
+      if((x_mask & ~all_masks[i]) == 0){
+        res.push_back(i);
+      }
+    }
+    
+    return res;
+  }
+  
+  // we start from the shortest posting
+  vector<uint32_t> all_keys = unique_trigrams(x);
+  vector<const uint32_t*> all_first, all_last;
+  for(const auto &key : all_keys){
+    const uint32_t *first = nullptr, *last = nullptr;
+    if(!find_trigram(key, first, last)){
+      // a trigram of x is found nowhere
+      return res;
+    }
+    all_first.push_back(first);
+    all_last.push_back(last);
+  }
+  
+  size_t k_min = 0;
+  for(size_t k = 1 ; k < all_keys.size() ; ++k){
+    if(all_last[k] - all_first[k] < all_last[k_min] - all_first[k_min]){
+      k_min = k;
+    }
+  }
+  
+  res.assign(all_first[k_min], all_last[k_min]);
+  
+  for(size_t k = 0 ; k < all_keys.size() && !res.empty() ; ++k){
+    if(k == k_min){
+      continue;
+    }
+    
+    vector<uint32_t> tmp;
+    tmp.reserve(res.size());
+    std::set_intersection(res.begin(), res.end(), all_first[k], all_last[k], std::back_inserter(tmp));
+    res = std::move(tmp);
+  }
+  
+  return res;
+}
+
+void MatchIndex::build_tokens() const {
+  
+  // we stack (token id, choice id) pairs and sort them, as for the trigrams
+  vector<uint64_t> all_pairs;
+  all_pairs.reserve(2 * n);
+  
+  for(size_t i = 0 ; i < n ; ++i){
+    const std::string_view low = lowered_at(i);
+    const size_t n_low = low.size();
+    size_t j = 0;
+    while(j < n_low){
+      if(!is_token_char(low[j])){
+        ++j;
+        continue;
+      }
+      
+      const size_t j_start = j;
+      while(j < n_low && is_token_char(low[j])){
+        ++j;
+      }
+      
+      auto res = token_to_id.try_emplace(low.substr(j_start, j - j_start), static_cast<uint32_t>(token_dict.size()));
+      if(res.second){
+        token_dict.push_back(res.first->first);
+      }
+      all_pairs.push_back((static_cast<uint64_t>(res.first->second) << 32) | i);
+    }
+  }
+  
+  std::sort(all_pairs.begin(), all_pairs.end());
+  all_pairs.erase(std::unique(all_pairs.begin(), all_pairs.end()), all_pairs.end());
+  
+  token_start.assign(token_dict.size() + 1, 0);
+  token_ids.resize(all_pairs.size());
+  for(size_t k = 0 ; k < all_pairs.size() ; ++k){
+    ++token_start[(all_pairs[k] >> 32) + 1];
+    token_ids[k] = static_cast<uint32_t>(all_pairs[k]);
+  }
+  
+  for(size_t k = 1 ; k < token_start.size() ; ++k){
+    token_start[k] += token_start[k - 1];
+  }
+}
+
+vector<uint32_t> MatchIndex::word_candidates(const string &x) const {
+  
+  // 3+ letters: the trigram postings are small and almost exact
+  if(x.empty() || x.size() >= 3 || 
+     !std::all_of(x.begin(), x.end(), [](const char c){ return is_token_char(c); })){
+    return inclusion_candidates(x);
+  }
+  
+  std::call_once(token_flag, [this]{ build_tokens(); });
+  
+  string x_low = x;
+  for(auto &c : x_low){
+    c = fold_ascii(c);
+  }
+  
+  // the distinct tokens are much fewer than the choices: we scan them
+  vector<char> is_in(n, 0);
+  bool any_in = false;
+  const size_t n_tokens = token_dict.size();
+  for(size_t k = 0 ; k < n_tokens ; ++k){
+    const std::string_view token = token_dict[k];
+    if(token.size() < x_low.size() || simd::find(x_low, token, true) == std::string_view::npos){
+      continue;
+    }
+    
+    any_in = true;
+    for(uint32_t p = token_start[k] ; p < token_start[k + 1] ; ++p){
+      is_in[token_ids[p]] = 1;
+    }
+  }
+  
+  vector<uint32_t> res;
+  if(!any_in){
+    return res;
+  }
+  
+  for(size_t i = 0 ; i < n ; ++i){
+    if(is_in[i]){
+      res.push_back(i);
+    }
+  }
+  
+  return res;
+}
+
+vector<uint32_t> MatchIndex::token_candidates(const vector<string> &all_tokens) const {
+  
+  std::call_once(token_flag, [this]{ build_tokens(); });
+  
+  vector<uint32_t> res;
+  for(const auto &token : all_tokens){
+    auto it = token_to_id.find(token);
+    if(it != token_to_id.end()){
+      res.insert(res.end(), token_ids.begin() + token_start[it->second], 
+                 token_ids.begin() + token_start[it->second + 1]);
+    }
+  }
+  
+  if(all_tokens.size() > 1){
+    std::sort(res.begin(), res.end());
+    res.erase(std::unique(res.begin(), res.end()), res.end());
+  }
+  
+  return res;
+}
+
+vector<uint32_t> MatchIndex::misspell_candidates(const string &x, const int max_edits) const {
+  /* MisspellMatcher matches x in y with at most k edits, the first letter of x
+  *  always matching. Hence:
+  *  - the first letter of x must be in y
+  *  - at most k letters of x can be absent from y (each edit removes at most one)
+  *
+  *  Regarding trigrams, an edit destroys at most 4 trigrams of x (a transposition).
+  *  Hence, with nx letters, at least nx - 2 - 4k trigrams of x must be in y.
+  *
+  * */
+  
+  vector<uint32_t> res;
+  if(x.empty()){
+    return res;
+  }
+  
+  const uint64_t x_mask = char_mask(x);
+  const uint64_t first_bit = char_bit(x[0]);
+  
+  for(size_t i = 0 ; i < n ; ++i){
+    const uint64_t mask = all_masks[i];
+    if((first_bit & mask) != 0 && popcount(x_mask & ~mask) <= max_edits){
+      res.push_back(i);
+    }
+  }
+  
+  const int nx = x.size();
+  const int min_count = nx - 2 - 4 * max_edits;
+  if(min_count <= 0 || res.empty()){
+    return res;
+  }
+  
+  // we count the trigrams of x (with multiplicity) found in each choice
+  vector<uint32_t> all_keys;
+  for(int i = 0 ; i + 2 < nx ; ++i){
+    all_keys.push_back(trigram_key(x[i], x[i + 1], x[i + 2]));
+  }
+  std::sort(all_keys.begin(), all_keys.end());
+  
+  vector<uint16_t> all_counts(n, 0);
+  size_t k = 0;
+  while(k < all_keys.size()){
+    const uint32_t key = all_keys[k];
+    uint16_t weight = 0;
+    while(k < all_keys.size() && all_keys[k] == key){
+      ++weight;
+      ++k;
+    }
+    
+    const uint32_t *first = nullptr, *last = nullptr;
+    if(find_trigram(key, first, last)){
+      for(const uint32_t *p = first ; p != last ; ++p){
+        all_counts[*p] += weight;
+      }
+    }
+  }
+  
+  vector<uint32_t> res_trigram;
+  for(const auto &i : res){
+    if(all_counts[i] >= min_count){
+      res_trigram.push_back(i);
+    }
+  }
+  
+  return res_trigram;
+}
+
+uint64_t MatchIndex::content_fingerprint(const vec_id &ids){
+  // FNV-1a over the ids: the strings are interned => same ids <=> same strings
+  
+  uint64_t h = 14695981039346656037ULL;
+  const uint64_t prime = 1099511628211ULL;
+  
+  for(const auto &id : ids){
+    h = (h ^ id) * prime;
+  }
+  
+  return h;
+}
+
+bool MatchIndex::is_same_content(const vec_id &ids, const uint64_t ids_fingerprint) const {
+  return ids.size() == n && ids_fingerprint == fingerprint &&
+         pool_generation == get_string_pool().get_generation() && ids == all_ids;
+}
+
+std::shared_ptr<const MatchIndex> MatchIndex::get(const vec_id &ids){
+  
+  if(ids.size() < min_size || ids.empty()){
+    return nullptr;
+  }
+  
+  const uint64_t ids_fingerprint = content_fingerprint(ids);
+  
+  // the indexes of a previous generation of the pool are dropped
+  const uint64_t generation = get_string_pool().get_generation();
+  index_cache.remove_if([generation](const std::shared_ptr<const MatchIndex> &x){
+    return x->pool_generation != generation;
+  });
+  
+  for(auto it = index_cache.begin() ; it != index_cache.end() ; ++it){
+    if((*it)->is_same_content(ids, ids_fingerprint)){
+      // we put it in front
+      std::shared_ptr<const MatchIndex> res = *it;
+      index_cache.erase(it);
+      index_cache.push_front(res);
+      return res;
+    }
+  }
+  
+  std::shared_ptr<const MatchIndex> res = std::make_shared<const MatchIndex>(ids);
+  index_cache.push_front(res);
+  if(index_cache.size() > CACHE_SIZE){
+    index_cache.pop_back();
+  }
+  
+  return res;
+}
+
+
+} // namespace stringtools
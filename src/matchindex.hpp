@@ -0,0 +1,157 @@
+    //=========================================================================//
+   //            Author: Laurent R. Bergé, University of Bordeaux             //
+  //             Copyright (C) 2025-present, Laurent R. Bergé                //
+ //              MIT License (see project_root/LICENSE)                     //
+//=========================================================================//
+
+#pragma once
+
+#include "metastringvec.hpp"
+#include "simd.hpp"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <cstdint>
+
+using std::string;
+using std::vector;
+
+namespace stringtools {
+
+// Implementation notes:
+// - the MatchIndex is a pre-computed structure on a set of choices, it is used
+//   by string_match to avoid rescanning all the choices for every tier
+// - it only gives *candidates*: every choice that may match is in the candidate
+//   list (the index never misses a match), but the candidates still need to be
+//   checked with the regular matching functions
+// - everything is case insensitive (ASCII only, as in to_lower)
+// - the index is cached on the content of the choices: identical choices
+//   across TABs reuse the same index (the choices are ids in the string pool,
+//   identical ids <=> identical strings, within a generation of the pool)
+// - the token index (for multi-word queries) is built on first use and shares
+//   the lifetime of the MatchIndex
+//
+
+using simd::fold_ascii;
+
+// a bit for each (folded) byte, modulo 64
+inline uint64_t char_bit(const unsigned char c){
+  return uint64_t{1} << (fold_ascii(c) & 63);
+}
+
+inline uint64_t char_mask(std::string_view x){
+  uint64_t res = 0;
+  for(const auto &c : x){
+    res |= char_bit(c);
+  }
+  return res;
+}
+
+// tokens are maximal runs of letters and digits (non ASCII bytes included)
+// => '.', '_', ':', etc are separators
+inline bool is_token_char(const unsigned char c){
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c >= 0x80;
+}
+
+inline uint32_t trigram_key(const unsigned char a, const unsigned char b, const unsigned char c){
+  return (static_cast<uint32_t>(fold_ascii(a)) << 16) | (static_cast<uint32_t>(fold_ascii(b)) << 8) | fold_ascii(c);
+}
+
+class MatchIndex {
+  // number of choices
+  size_t n = 0;
+  
+  // the choices, as ids in the string pool
+  vec_id all_ids;
+  
+  // the choices in lower case, contiguously: the choice i is
+  // lowered_data[lowered_start[i], lowered_start[i + 1])
+  string lowered_data;
+  vector<uint32_t> lowered_start;
+  
+  // for each choice: the bits of the characters it contains
+  vector<uint64_t> all_masks;
+  
+  // first letter buckets (lower case)
+  // the choices whose first letter is c are:
+  // bucket_ids[bucket_start[c]] to bucket_ids[bucket_start[c + 1] - 1]
+  vector<uint32_t> bucket_start;
+  vector<uint32_t> bucket_ids;
+  
+  // trigram postings: same logic as for the buckets
+  // trigram_keys is sorted, the choices containing trigram_keys[k] are:
+  // trigram_ids[trigram_start[k]] to trigram_ids[trigram_start[k + 1] - 1]
+  vector<uint32_t> trigram_keys;
+  vector<uint32_t> trigram_start;
+  vector<uint32_t> trigram_ids;
+  
+  // token postings: same logic as for the buckets
+  // token_dict contains the distinct tokens (lower case), the choices containing
+  // token_dict[k] are: token_ids[token_start[k]] to token_ids[token_start[k + 1] - 1]
+  // NOTA: built on first use only (see build_tokens), the tokens are views on lowered_data
+  mutable std::once_flag token_flag;
+  mutable vector<std::string_view> token_dict;
+  mutable std::unordered_map<std::string_view, uint32_t> token_to_id;
+  mutable vector<uint32_t> token_start;
+  mutable vector<uint32_t> token_ids;
+  
+  // to check the cache: the ids are only comparable within a generation of the pool
+  uint64_t fingerprint = 0;
+  uint64_t pool_generation = 0;
+  
+  bool find_trigram(const uint32_t key, const uint32_t *&first, const uint32_t *&last) const;
+  void build_tokens() const;
+
+public:
+  
+  // below this number of choices, string_match does not use the index
+  static size_t min_size;
+  
+  MatchIndex() = delete;
+  MatchIndex(const vec_id &ids);
+  
+  size_t size() const { return n; }
+  
+  std::string_view lowered_at(size_t i) const { 
+    return std::string_view(lowered_data).substr(lowered_start[i], lowered_start[i + 1] - lowered_start[i]);
+  }
+  
+  uint64_t mask_at(size_t i) const { return all_masks[i]; }
+  
+  // the choices starting with the letter c (case insensitive), in increasing order
+  void first_letter_bucket(const unsigned char c, const uint32_t *&first, const uint32_t *&last) const;
+  
+  // choices that may include x (case insensitive), in increasing order
+  vector<uint32_t> inclusion_candidates(const string &x) const;
+  
+  // choices that may include the word x (case insensitive), in increasing order
+  // - if x is a short word (1 or 2 letters) made of token characters only: 
+  //   the result is exact, it is the union of the postings of the tokens 
+  //   containing x (x cannot overlap two tokens)
+  // - otherwise: same as inclusion_candidates
+  vector<uint32_t> word_candidates(const string &x) const;
+  
+  // choices having one of the tokens (lower case) in all_tokens, in increasing order
+  vector<uint32_t> token_candidates(const vector<string> &all_tokens) const;
+  
+  // choices that may include x with at most max_edits misspells, in increasing order
+  // (see MisspellMatcher)
+  vector<uint32_t> misspell_candidates(const string &x, const int max_edits) const;
+  
+  bool is_same_content(const vec_id &ids, const uint64_t ids_fingerprint) const;
+  
+  static uint64_t content_fingerprint(const vec_id &ids);
+  
+  // returns the (cached) index for the choices ids, or nullptr if they are too few to be indexed
+  static std::shared_ptr<const MatchIndex> get(const vec_id &ids);
+
+};
+
+vector<uint32_t> intersect_sorted(const vector<uint32_t> &x, const vector<uint32_t> &y);
+
+
+} // namespace stringtools
@@ -7,12 +7,14 @@
 #pragma once
 
 #include "util.hpp"
+#include "stringpool.hpp"
 
 #include <string>
 #include <vector>
 #include <chrono>
 #include <iostream>
 #include <memory>
+#include <string_view>
 
 using std::string;
 using std::vector;
@@ -22,6 +24,8 @@ namespace stringtools {
 using vec_str = vector<string>;
 using ptr_vec_str = std::shared_ptr<vec_str>;
 using vec_vec_str = vector<vec_str>;
+using vec_id = vector<uint32_t>;
+using ptr_vec_id = std::shared_ptr<vec_id>;
 
 template<typename T>
 inline size_t find_pos_first_match(const vector<T> &vec, const T value){
@@ -65,6 +69,222 @@ inline bool any_false(const vector<bool> &x, const bool on_empty = false){
   return false;
 }
 
+//
+// MetaColumn ------------------------------------------------------------------ 
+//
+
+// Implementation notes:
+// - Meta stores one column per key, a column is typed:
+//   * STRING: ids in the string pool
+//   * BOOL: a bitset
+//   * INT: 32 bit integers
+// - a flex column holds a single value, shared by all the observations
+// - the string API is kept: the values of the BOOL and INT columns are
+//   formatted when read ("true"/"false", std::to_string)
+// - select and bind work on the raw columns: gathers and range insertions of
+//   integers, no string is copied
+// - the keys are resolved once per operation: get_key_pos gives the position of
+//   a column, to be used with the positional getters within loops
+// - missing values (key absent on one side of a bind) are "", false and 0
+// - binding two columns of different types converts both to STRING
+//
+
+enum class META_TYPE {
+  STRING,
+  BOOL,
+  INT,
+};
+
+struct MetaColumn {
+  META_TYPE type = META_TYPE::STRING;
+  bool is_flex = false;
+  bool is_inherit = false;
+  
+  // only the vector of the current type is used
+  vec_id ids;
+  vector<bool> bits;
+  vector<int32_t> ints;
+  
+  // the ids stay valid as long as the column lives
+  StringPool::User pool_user = get_string_pool().get_user();
+  
+  MetaColumn() = default;
+  
+  MetaColumn(const string &x, const bool inherit): is_flex(true), is_inherit(inherit){
+    ids.push_back(intern_string(x));
+  }
+  
+  MetaColumn(const bool x, const bool inherit): 
+    type(META_TYPE::BOOL), is_flex(true), is_inherit(inherit){
+    bits.push_back(x);
+  }
+  
+  MetaColumn(const int x, const bool inherit): 
+    type(META_TYPE::INT), is_flex(true), is_inherit(inherit){
+    ints.push_back(x);
+  }
+  
+  MetaColumn(const vec_str &x): ids(intern_strings(x)) {}
+  
+  MetaColumn(const vector<bool> &x): type(META_TYPE::BOOL), bits(x) {}
+  
+  MetaColumn(const vector<int> &x): type(META_TYPE::INT), ints(x.begin(), x.end()) {}
+  
+  size_t size() const {
+    switch(type){
+      case META_TYPE::BOOL: return bits.size();
+      case META_TYPE::INT: return ints.size();
+      default: return ids.size();
+    }
+  }
+  
+  void reserve(const size_t n){
+    switch(type){
+      case META_TYPE::BOOL: bits.reserve(n); break;
+      case META_TYPE::INT: ints.reserve(n); break;
+      default: ids.reserve(n);
+    }
+  }
+  
+  string value_at(const size_t i) const {
+    switch(type){
+      case META_TYPE::BOOL: return bits[i] ? "true" : "false";
+      case META_TYPE::INT: return std::to_string(ints[i]);
+      default: return string{string_from_id(ids[i])};
+    }
+  }
+  
+  vec_str values() const {
+    const size_t n = size();
+    vec_str res;
+    res.reserve(n);
+    for(size_t i = 0 ; i < n ; ++i){
+      res.push_back(value_at(i));
+    }
+    
+    return res;
+  }
+  
+  // flex column of the value i
+  MetaColumn scalar_at(const size_t i) const {
+    MetaColumn res;
+    res.type = type;
+    res.is_flex = true;
+    res.is_inherit = true;
+    switch(type){
+      case META_TYPE::BOOL: res.bits.push_back(bits[i]); break;
+      case META_TYPE::INT: res.ints.push_back(ints[i]); break;
+      default: res.ids.push_back(ids[i]);
+    }
+    
+    return res;
+  }
+  
+  bool same_scalar(const MetaColumn &x) const {
+    if(type != x.type){
+      return false;
+    }
+    
+    switch(type){
+      case META_TYPE::BOOL: return bits[0] == x.bits[0];
+      case META_TYPE::INT: return ints[0] == x.ints[0];
+      default: return ids[0] == x.ids[0];
+    }
+  }
+  
+  void to_string_type(){
+    if(type == META_TYPE::STRING){
+      return;
+    }
+    
+    const size_t n = size();
+    vec_id new_ids;
+    new_ids.reserve(n);
+    for(size_t i = 0 ; i < n ; ++i){
+      new_ids.push_back(intern_string(value_at(i)));
+    }
+    
+    ids = std::move(new_ids);
+    bits.clear();
+    ints.clear();
+    type = META_TYPE::STRING;
+  }
+  
+  // a flex column becomes a regular column of length n
+  void expand(const size_t n){
+    switch(type){
+      case META_TYPE::BOOL: bits.assign(n, bits.at(0)); break;
+      case META_TYPE::INT: ints.assign(n, ints.at(0)); break;
+      default: ids.assign(n, ids.at(0));
+    }
+    is_flex = false;
+    is_inherit = false;
+  }
+  
+  void append_missing(const size_t n){
+    switch(type){
+      case META_TYPE::BOOL: bits.insert(bits.end(), n, false); break;
+      case META_TYPE::INT: ints.insert(ints.end(), n, 0); break;
+      default: ids.insert(ids.end(), n, 0);
+    }
+  }
+  
+  // x is of the same type, n_x: number of observations of x
+  void append(const MetaColumn &x, const size_t n_x){
+    switch(type){
+      case META_TYPE::BOOL: 
+        if(x.is_flex){
+          bits.insert(bits.end(), n_x, x.bits[0]);
+        } else {
+          bits.insert(bits.end(), x.bits.begin(), x.bits.end());
+        }
+        break;
+      case META_TYPE::INT: 
+        if(x.is_flex){
+          ints.insert(ints.end(), n_x, x.ints[0]);
+        } else {
+          ints.insert(ints.end(), x.ints.begin(), x.ints.end());
+        }
+        break;
+      default: 
+        if(x.is_flex){
+          ids.insert(ids.end(), n_x, x.ids[0]);
+        } else {
+          ids.insert(ids.end(), x.ids.begin(), x.ids.end());
+        }
+    }
+  }
+  
+  // the elements sel, the selection must be valid
+  template<typename T>
+  MetaColumn subset(const vector<T> &sel) const {
+    if(is_flex){
+      return *this;
+    }
+    
+    MetaColumn res;
+    res.type = type;
+    switch(type){
+      case META_TYPE::BOOL: res.bits = gather(bits, sel); break;
+      case META_TYPE::INT: res.ints = gather(ints, sel); break;
+      default: res.ids = gather(ids, sel);
+    }
+    
+    return res;
+  }
+  
+  template<typename V, typename T>
+  static V gather(const V &x, const vector<T> &sel){
+    const size_t n = sel.size();
+    V res(n);
+    for(size_t j = 0 ; j < n ; ++j){
+      res[j] = x[sel[j]];
+    }
+    
+    return res;
+  }
+};
+
 //
 // Meta ------------------------------------------------------------------------ 
 //
@@ -72,12 +292,9 @@ inline bool any_false(const vector<bool> &x, const bool on_empty = false){
 // NOTA: initialization with a single string => value for all the elements
 // with a vector => 1-to-1 match between vector value and element id
 class Meta {
-  vec_vec_str all_vecs;
+  vector<MetaColumn> all_cols;
   size_t n = 0;
   vec_str all_keys;
-  vector<size_t> selection;
-  vector<bool> is_flex;
-  vector<bool> is_inherit;
   
   void error_empty(const vec_str &x){
     if(x.empty()){
@@ -86,13 +303,69 @@ class Meta {
   }
   
   void error_position(const size_t obs) const {
-    if(obs >= n && any_false(is_flex, true)){
+    if(obs >= n && !all_flex()){
       throw util::bad_type("The position of the observation requested (",
                        obs, ") is larger than the number of observations (",
                        n, ").");
     }
   }
   
+  const MetaColumn& get_column(const size_t k) const {
+    if(k >= all_cols.size()){
+      throw std::range_error(util::txt("The position ",  k, 
+                                       " does not fit the number of elements (",
+                                       all_cols.size(), ")."));
+    }
+    
+    return all_cols[k];
+  }
+  
+  size_t get_key_pos_checked(const string &key) const {
+    const size_t k = get_key_pos(key);
+    if(k >= all_keys.size()){
+      throw std::range_error(util::txt("The key `", key, "`does not exist."));
+    }
+    
+    return k;
+  }
+  
+  Meta& set_scalar(const string &key, MetaColumn &&col){
+    
+    size_t pos = get_key_pos(key);
+    if(pos < all_cols.size()){
+      // found
+      all_cols[pos] = std::move(col);
+    } else {
+      all_cols.push_back(std::move(col));
+      all_keys.push_back(key);
+    }
+    
+    return *this;
+  }
+  
+  Meta& set_column(const string &key, MetaColumn &&col){
+    
+    const size_t n_x = col.size();
+    if(n == 0){
+      n = n_x;
+    } else if(n != n_x){
+      throw util::index_pblm("Size of the vector to be set (",
+                             n_x, ") differs from the existing size (",
+                             n, "). This is not possible for non inherited scalars.");
+    }
+    
+    const size_t pos = get_key_pos(key);
+    if(pos < all_keys.size()){
+      // found
+      all_cols[pos] = std::move(col);
+    } else {
+      all_cols.push_back(std::move(col));
+      all_keys.push_back(key);
+    }
+    
+    return *this;
+  }
+  
 public:
   
   enum class SCALAR_TYPE {
@@ -111,37 +384,29 @@ public:
   
   // string initialization
   Meta(const string x, SCALAR_TYPE stype = SCALAR_TYPE::INHERIT, size_t n_ = 1): n(n_){
-    all_vecs.push_back(vec_str{n, x});
+    all_cols.emplace_back(x, stype == SCALAR_TYPE::INHERIT);
     all_keys.push_back("");
-    is_flex.push_back(true);
-    is_inherit.push_back(stype == SCALAR_TYPE::INHERIT);
   }
   
   Meta(const string key, const string x, SCALAR_TYPE stype = SCALAR_TYPE::INHERIT, 
        size_t n_ = 1): n(n_){
-    all_vecs.push_back(vec_str{n, x});
+    all_cols.emplace_back(x, stype == SCALAR_TYPE::INHERIT);
     all_keys.push_back(key);
-    is_flex.push_back(true);
-    is_inherit.push_back(stype == SCALAR_TYPE::INHERIT);
   }
   
   // string vector initialization
   Meta(const vec_str &x){
     error_empty(x);
     n = x.size();
-    all_vecs.push_back(x);
+    all_cols.emplace_back(x);
     all_keys.push_back("");
-    is_flex.push_back(false);
-    is_inherit.push_back(false);
   }
   
   Meta(const string key, const vec_str &x){
     error_empty(x);
     n = x.size();
-    all_vecs.push_back(x);
+    all_cols.emplace_back(x);
     all_keys.push_back(key);
-    is_flex.push_back(false);
-    is_inherit.push_back(false);
   }
   
   
@@ -156,7 +421,7 @@ public:
       n = n_new;
     } else if(n_new == n){
       // nothing
-    } else if(all_true(is_flex)){
+    } else if(all_flex()){
       n = n_new;
     } else {
       throw util::index_pblm("The current resize is invalid: old size = ", n, 
@@ -167,23 +432,29 @@ public:
     return *this;
   }
   
+  // for the columns with one value per observation
+  Meta& reserve(size_t n_new){
+    for(auto &col : all_cols){
+      if(!col.is_flex){
+        col.reserve(n_new);
+      }
+    }
+    
+    return *this;
+  }
+  
   Meta& clear(){
-    selection.clear();
     n = 0;
-    all_vecs.clear();
+    all_cols.clear();
     all_keys.clear();
-    is_flex.clear();
-    is_inherit.clear();
     
     return *this;
   }
   
   Meta& push_back(const string x, SCALAR_TYPE stype = SCALAR_TYPE::INHERIT){
     
-    all_vecs.push_back(vec_str{1, x});
+    all_cols.emplace_back(x, stype == SCALAR_TYPE::INHERIT);
     all_keys.push_back("");
-    is_flex.push_back(true);
-    is_inherit.push_back(stype == SCALAR_TYPE::INHERIT);
     
     return *this;
   }
@@ -200,71 +471,49 @@ public:
       resize(n_x);
     }
     
-    all_vecs.push_back(x);
+    all_cols.emplace_back(x);
     all_keys.push_back("");
-    is_flex.push_back(false);
-    is_inherit.push_back(false);
 
     return *this;
   }
   
   // we cannot push back with names
   Meta& set(const string key, const string x, SCALAR_TYPE stype = SCALAR_TYPE::INHERIT){
+    return set_scalar(key, MetaColumn(x, stype == SCALAR_TYPE::INHERIT));
+  }
     
-    size_t pos = find_pos_first_match(all_keys, key);
-    if(pos < all_vecs.size()){
-      // found
-      all_vecs[pos] = vec_str{1, x};
-      all_keys[pos] = key;
-      is_flex[pos] = true;
-      is_inherit[pos] = stype == SCALAR_TYPE::INHERIT;
-    } else {
-      all_vecs.push_back(vec_str{1, x});
-      all_keys.push_back(key);
-      is_flex.push_back(true);
-      is_inherit.push_back(stype == SCALAR_TYPE::INHERIT);
-    }
+  // NOTA: without it, string literals would be converted to bool
+  Meta& set(const string key, const char *px, SCALAR_TYPE stype = SCALAR_TYPE::INHERIT){
+    return set_scalar(key, MetaColumn(string{px}, stype == SCALAR_TYPE::INHERIT));
+  }
     
-    return *this;
+  Meta& set(const string key, const bool x, SCALAR_TYPE stype = SCALAR_TYPE::INHERIT){
+    return set_scalar(key, MetaColumn(x, stype == SCALAR_TYPE::INHERIT));
+  }
+  
+  Meta& set(const string key, const int x, SCALAR_TYPE stype = SCALAR_TYPE::INHERIT){
+    return set_scalar(key, MetaColumn(x, stype == SCALAR_TYPE::INHERIT));
   }
   
   Meta& set(const string key, const vec_str &x){
+    return set_column(key, MetaColumn(x));
+  }
     
-    const size_t n_x = x.size();
-    if(n == 0){
-      n = n_x;
-    } else if(n != n_x){
-      throw util::index_pblm("Size of the vector to be set (",
-                             n_x, ") differs from the existing size (",
-                             n, "). This is not possible for non inherited scalars.");
-    }
-    
-    const size_t pos = find_pos_first_match(all_keys, key);
-    if(pos < all_keys.size()){
-      // found
-      all_vecs[pos] = x;
-      all_keys[pos] = key;
-      is_flex[pos] = false;
-      is_inherit[pos] = false;
-    } else {
-      all_vecs.push_back(x);
-      all_keys.push_back(key);
-      is_flex.push_back(false);
-      is_inherit.push_back(false);
-    }
+  Meta& set(const string key, const vector<bool> &x){
+    return set_column(key, MetaColumn(x));
+  }
     
-    return *this;
+  Meta& set(const string key, const vector<int> &x){
+    return set_column(key, MetaColumn(x));
   }
   
   Meta& rm_key(const string key, const bool check = false){
     
-    size_t pos = find_pos_first_match(all_keys, key);
-    if(pos < all_vecs.size()){
+    size_t pos = get_key_pos(key);
+    if(pos < all_cols.size()){
       // found
-      all_vecs.erase(all_vecs.begin() + pos);
+      all_cols.erase(all_cols.begin() + pos);
       all_keys.erase(all_keys.begin() + pos);
-      is_flex.erase(is_flex.begin() + pos);
-      is_inherit.erase(is_inherit.begin() + pos);
       
     } else if(check){
       throw std::out_of_range(util::txt("The key `", key, "` does not exist among ", 
@@ -275,10 +524,10 @@ public:
   }
   
   Meta& set_names(const vec_str key){
-    if(key.size() != all_vecs.size()){
+    if(key.size() != all_cols.size()){
       throw std::range_error(util::txt("The length of the keys (", key.size(), 
                                        ") does not match the number of existing vectors (", 
-                                       all_vecs.size(), ")."));
+                                       all_cols.size(), ")."));
     }
     
     all_keys = key;
@@ -292,7 +541,7 @@ public:
   
   Meta at(const size_t i) const {
     
-    if(i >= n && any_false(is_flex)){
+    if(i >= n && !all_flex()){
       throw std::out_of_range(util::txt("The index to select (",
                                         i, ") is larger than the number of observations (",
                                         n, ")."));
@@ -300,98 +549,63 @@ public:
     
     Meta res;
     
-    int k = 0;
-    for(auto &v : all_vecs){
-      if(is_flex[k]){
-        res.set(all_keys.at(k++), v[0]);
-      } else {
-        res.set(all_keys.at(k++), v[i]);
-      }
+    const size_t K = all_cols.size();
+    for(size_t k = 0 ; k < K ; ++k){
+      const MetaColumn &col = all_cols[k];
+      res.set_scalar(all_keys[k], col.scalar_at(col.is_flex ? 0 : i));
     }
     
     return res;
   }
   
-  const vec_str& get_vector(const string key) const {
-    const size_t k = find_pos_first_match(all_keys, key);
-    if(k >= all_keys.size()){
-      throw std::range_error(util::txt("The key `", key, "`does not exist."));
-    }
-    
-    return all_vecs.at(k);
+  // position of the column of the key, get_n_vectors() if not found
+  size_t get_key_pos(const string &key) const {
+    return find_pos_first_match(all_keys, key);
   }
   
-  vec_str& get_vector(const string key){
-    const size_t k = find_pos_first_match(all_keys, key);
-    if(k >= all_keys.size()){
-      throw std::range_error(util::txt("The key `", key, "`does not exist."));
-    }
-    
-    return all_vecs.at(k);
+  META_TYPE get_type(const size_t k) const {
+    return get_column(k).type;
   }
   
-  const vec_str& get_vector(const size_t k) const {
-    if(k >= all_vecs.size()){
-      throw std::range_error(util::txt("The position ",  k, 
-                                       " does not fit the number of elements (",
-                                       all_vecs.size(), ")."));
-    }
-    
-    return all_vecs[k];
+  // NOTA: the values are copied
+  vec_str get_vector(const string key) const {
+    return get_column(get_key_pos_checked(key)).values();
   }
   
-  vec_str& get_vector(const size_t k){
-    if(k >= all_vecs.size()){
-      throw std::range_error(util::txt("The position ", k, 
-                                       " does not fit the number of elements (",
-                                       all_vecs.size(), ")."));
-    }
-    
-    return all_vecs[k];
+  vec_str get_vector(const size_t k) const {
+    return get_column(k).values();
   }
   
   vec_str get_vector_copy(string key) const {
-    vec_str res = get_vector(key);
-    return res;
+    return get_vector(key);
   }
   
   vec_str get_vector_copy(size_t k) const {
-    vec_str res = get_vector(k);
-    return res;
+    return get_vector(k);
   }
   
   string get_vector_at(const string key, const size_t obs = 0) const {
-    error_position(obs);
-    const vec_str &vec = get_vector(key);
-    
-    // inheritance
-    if(vec.size() == 1){
-      return vec[0];
-    }
-    
-    return vec[obs];
+    return get_vector_at(get_key_pos_checked(key), obs);
   }
   
   string get_vector_at(const size_t k, const size_t obs = 0) const {
     error_position(obs);
-    const vec_str &vec = get_vector(k);
+    const MetaColumn &col = get_column(k);
     
-    if(vec.size() == 1){
-      return vec[0];
+    // inheritance
+    if(col.size() == 1){
+      return col.value_at(0);
     }
     
-    return vec[obs];
+    return col.value_at(obs);
   }
   
   vec_str get_row(const size_t obs) const {
     error_position(obs);
     vec_str res;
-    for(auto &vec : all_vecs){
-      if(vec.size() == 1){
-        res.push_back(vec[0]);
-      } else {
-        res.push_back(vec[obs]);
-      }
+    res.reserve(all_cols.size());
+    for(auto &col : all_cols){
+      res.push_back(col.value_at(col.size() == 1 ? 0 : obs));
     }
     
     return res;
@@ -406,7 +620,7 @@ public:
   }
   
   size_t get_n_vectors() const {
-    return all_vecs.size();
+    return all_cols.size();
   }
   
   bool empty() const {
@@ -414,11 +628,17 @@ public:
   }
   
   bool unset() const {
-    return n == 0 && all_vecs.empty();
+    return n == 0 && all_cols.empty();
   }
   
   bool all_flex() const {
-    return all_true(is_flex, true);
+    for(auto &col : all_cols){
+      if(!col.is_flex){
+        return false;
+      }
+    }
+    
+    return true;
   }
   
   
@@ -427,46 +647,67 @@ public:
   //
   
   
+  // the observations sel, the current object is not modified
   template<typename T>
-  Meta& select(const vector<T> &sel){
-    // should I allow empty selections?
-    // yes, it's more robust
+  Meta subset(const vector<T> &sel) const {
     
     static_assert(std::is_convertible_v<T, size_t>, 
       "In `select`, values for selection must be represented by unsigned integers.");
     
-    int k = 0;
-    for(auto &vec : all_vecs){
-      if(is_flex[k++]) {
-        // nothing => remains flex
-      } else {
-        
-        if(n != vec.size()){
-          throw util::bad_type("Internal error: the length of the internal vector, ", vec.size(), 
-                               ",  and that of the internal size, ", n, ",  differ.");
-        }
-        
-        vec_str new_vec;
-        for(const auto &i: sel){
-          
-          if(i >= n || i < 0){
-            throw util::index_pblm("When processing the selection, the selection ID (",
-                                   i, ") is invalid given the number of observations ", 
-                                   n, ".");
-          }
-          
-          new_vec.push_back(vec[i]);
+    if(!all_flex()){
+      // the selection is checked once for all the columns
+      for(const auto &i: sel){
+        if(static_cast<size_t>(i) >= n){
+          throw util::index_pblm("When processing the selection, the selection ID (",
+                                 i, ") is invalid given the number of observations ", 
+                                 n, ".");
         }
-        vec = std::move(new_vec);
       }
     }
     
-    n = sel.size();
-    selection.clear();
+    Meta res;
+    res.all_keys = all_keys;
+    res.all_cols.reserve(all_cols.size());
+    for(auto &col : all_cols){
+      if(!col.is_flex && n != col.size()){
+        throw util::bad_type("Internal error: the length of the internal vector, ", col.size(), 
+                             ",  and that of the internal size, ", n, ",  differ.");
+      }
+        
+      // flex columns remain flex
+      res.all_cols.push_back(col.subset(sel));
+    }
+    
+    res.n = unset() ? 0 : sel.size();
     
+    return res;
+  }
+  
+  template<typename T>
+  Meta& select(const vector<T> &sel){
+    // should I allow empty selections?
+    // yes, it's more robust
+    *this = subset(sel);
     return *this;
   }
   
+  // the values of the observations sel (a flex column gives a single value)
+  vec_str get_vector(const size_t k, const vec_id &sel) const {
+    const MetaColumn &col = get_column(k);
+    if(col.is_flex){
+      return col.values();
+    }
+    
+    vec_str res;
+    res.reserve(sel.size());
+    for(const auto &i : sel){
+      error_position(i);
+      res.push_back(col.value_at(i));
+    }
+    
+    return res;
+  }
+  
   //
   // binding 
   //
@@ -485,49 +726,50 @@ public:
     }
     
     // general information
-    size_t K_left = all_vecs.size(), K_right = x.all_vecs.size();
+    // NOTA: x may be *this, we copy its size before growing the columns
+    size_t K_left = all_cols.size(), K_right = x.all_cols.size();
     size_t n_left = n, n_right = x.n;
     vector<bool> done_right(K_right);
+    const vector<MetaColumn> cols_self = this == &x ? all_cols : vector<MetaColumn>{};
+    const vector<MetaColumn> &all_cols_right = this == &x ? cols_self : x.all_cols;
     
     for(size_t k = 0 ; k < K_left ; ++k){
-      const size_t pos_right = find_pos_first_match(x.all_keys, all_keys[k]);
-      vec_str &vec_left = all_vecs[k];
+      const size_t pos_right = x.get_key_pos(all_keys[k]);
+      MetaColumn &col_left = all_cols[k];
       
       if(pos_right >= K_right){
         // no match found
-        if(is_flex[k]){
-          if(is_inherit[k]){
+        if(col_left.is_flex){
+          if(col_left.is_inherit){
             // we inherit the flex status => we do nothing
           } else {
             // we need to resize
-            vec_left = vec_str(n_left, vec_left.at(0)); 
-            //         rep(vec_left, n_left)
-            is_flex[k] = false;
-            vec_left.insert(vec_left.end(), n_right, ""); 
-            //       .push_back(vec_right)
+            col_left.expand(n_left);
+            col_left.append_missing(n_right);
           }
         } else {
-          vec_left.insert(vec_left.end(), n_right, "");
+          col_left.append_missing(n_right);
         }
       } else {
         // found
         done_right[pos_right] = true;
-        const vec_str &vec_right = x.all_vecs.at(pos_right);
-        const bool flex_left = is_flex[k], flex_right = x.is_flex[pos_right];
-        if(flex_left && flex_right && vec_left[0] == vec_right[0]){
+        const MetaColumn &col_right = all_cols_right[pos_right];
+        if(col_left.is_flex && col_right.is_flex && col_left.same_scalar(col_right)){
           // nothing to do, that's fine!
           //
         } else {
-          is_flex[k] = false;
           
-          if(flex_left){
-            vec_left = vec_str(n_left, vec_left.at(0));
+          if(col_left.is_flex){
+            col_left.expand(n_left);
           }
           
-          if(flex_right){
-            vec_left.insert(vec_left.end(), n_right, vec_right[0]);
+          if(col_left.type != col_right.type){
+            MetaColumn col_right_str = col_right;
+            col_right_str.to_string_type();
+            col_left.to_string_type();
+            col_left.append(col_right_str, n_right);
           } else {
-            vec_left.insert(vec_left.end(), vec_right.begin(), vec_right.end());
+            col_left.append(col_right, n_right);
           }
         }
         
@@ -541,48 +783,35 @@ public:
         continue;
       }
       
-      const vec_str &vec_right = x.all_vecs.at(k);
+      const MetaColumn &col_right = all_cols_right[k];
       
-      if(x.is_flex[k] && x.is_inherit[k]){
-        all_vecs.push_back(vec_right);
-        all_keys.push_back(x.all_keys[k]);
-        is_flex.push_back(true);
-        is_inherit.push_back(true);
+      if(col_right.is_flex && col_right.is_inherit){
+        all_cols.push_back(col_right);
         
       } else {
-        vec_str vec(n_left, "");
-        if(x.is_flex[k]){
-          vec_str new_vec(n_right, vec_right[0]);
-          vec.insert(vec.end(), new_vec.begin(), new_vec.end());
-        } else {
-          vec.insert(vec.end(), vec_right.begin(), vec_right.end());
-        }
-        
-        all_vecs.push_back(std::move(vec));
-        
-        all_keys.push_back(x.all_keys[k]);
-        is_flex.push_back(false);
-        is_inherit.push_back(false);
+        MetaColumn col;
+        col.type = col_right.type;
+        col.append_missing(n_left);
+        col.append(col_right, n_right);
         
+        all_cols.push_back(std::move(col));
       }
       
+      all_keys.push_back(x.all_keys[k]);
     }
     
     n = n_left + n_right;
-    selection.clear();
     
     return *this;
     
   }
   
   bool is_key(const string &key) const {
-    size_t pos = find_pos_first_match(all_keys, key);
-    return pos < all_keys.size();
+    return get_key_pos(key) < all_keys.size();
   }
   
   bool is_key(const string &&key) const {
-    size_t pos = find_pos_first_match(all_keys, key);
-    return pos < all_keys.size();
+    return get_key_pos(key) < all_keys.size();
   }
   
   
@@ -593,26 +822,82 @@ public:
 //
 
 
+// NOTA: the strings are ids in the string pool (see stringpool.hpp)
+// => selecting, binding or copying the strings only moves 32 bit integers
+//
+// Implementation notes:
+// - the ids and the meta information are shared between the copies: they are
+//   copied on write (own_ids, own_meta), a copy is never modified by another
+// - select does not copy anything: the object becomes a view, the elements psel
+//   of the shared storage, and successive selections compose their indexes
+// - the view is materialized (the selected elements are copied) only when a
+//   contiguous vector is requested (get_ids, get_meta) or before a modification
+//   NOTA: materializing is not thread safe, it must be done by the main thread
+//
 class MetaStringVec {
   
   using MSV = MetaStringVec;
   
-  ptr_vec_str psvec = std::make_shared<vec_str>();
-  std::shared_ptr<Meta> pmeta = std::make_shared<Meta>();
+  mutable ptr_vec_id pids = std::make_shared<vec_id>();
+  mutable std::shared_ptr<Meta> pmeta = std::make_shared<Meta>();
+  // the selection: elements of *pids and *pmeta, nullptr if none
+  mutable std::shared_ptr<const vec_id> psel;
+  
+  // the ids stay valid as long as the object lives
+  StringPool::User pool_user = get_string_pool().get_user();
   
   string cause_empty;
-  vector<size_t> selection;
+  
+  size_t base_index(const size_t i) const {
+    return psel ? (*psel)[i] : i;
+  }
+  
+  void materialize() const {
+    if(!psel){
+      return;
+    }
+    
+    ptr_vec_id pids_new = std::make_shared<vec_id>();
+    pids_new->reserve(psel->size());
+    for(const auto &i : *psel){
+      pids_new->push_back((*pids)[i]);
+    }
+    
+    pmeta = std::make_shared<Meta>(pmeta->subset(*psel));
+    pids = pids_new;
+    psel.reset();
+  }
+  
+  // the storage is copied if shared with another object
+  vec_id& own_ids(){
+    materialize();
+    if(pids.use_count() > 1){
+      pids = std::make_shared<vec_id>(*pids);
+    }
+    
+    return *pids;
+  }
+  
+  Meta& own_meta(){
+    materialize();
+    if(pmeta.use_count() > 1){
+      pmeta = std::make_shared<Meta>(*pmeta);
+    }
+    
+    return *pmeta;
+  }
   
   // a few functions (mostly internal versions of templated functions)
-  void set_meta_internal(const string &key, const vec_str &x){
+  template<typename V>
+  void set_meta_internal(const string &key, const V &x){
     const size_t n = x.size();
-    if(n != psvec->size()){
+    if(n != size()){
       throw util::index_pblm("The number of elements in to be set in meta (",
                              n, ") is different from the current number ",
                              "of observations in the string vector (", 
-                             psvec->size(), ").");
+                             size(), ").");
     }
-    pmeta->set(key, x);
+    own_meta().set(key, x);
   }
   
 public:
@@ -620,26 +905,31 @@ public:
   MetaStringVec() = default;
   
   MetaStringVec(const vec_str &x){
-    psvec = std::make_shared<vec_str>(x);
+    pids = std::make_shared<vec_id>(intern_strings(x));
+  }
+  
+  MetaStringVec(vec_id &&ids){
+    pids = std::make_shared<vec_id>(std::move(ids));
   }
   
   MSV& set_meta(Meta &&m){
     
     const size_t meta_obs = m.get_n_obs();
     
-    if(psvec->empty()){
+    if(empty()){
       if(meta_obs != 0){
         throw util::index_pblm("The number of observations of the meta information (",
                                meta_obs, ") cannot be greater than 0 ",
                                "when the string vector is empty.");
       }
       
-    } else if(meta_obs != 0 && meta_obs != psvec->size()){
+    } else if(meta_obs != 0 && meta_obs != size()){
       throw util::index_pblm("The number of observations of the meta information (",
                              meta_obs, ") does not match the number of observations of the vector (", 
-                             psvec->size(), ").");
+                             size(), ").");
     }
     
+    materialize();
     pmeta = std::make_shared<Meta>(m);
     
     return *this;
@@ -651,7 +941,7 @@ public:
   }
   
   MetaStringVec(vec_str &x, Meta &m){
-    psvec = std::make_shared<vec_str>(x);
+    pids = std::make_shared<vec_id>(intern_strings(x));
     set_meta(m);
   }
   
@@ -661,98 +951,172 @@ public:
   
   MSV& set_string_vector(const vec_str &x){
     
-    if(x.size() != psvec->size() && !pmeta->empty()){
+    if(x.size() != size() && !pmeta->empty()){
       throw util::index_pblm(
         "The length of the new vector, ", x.size(), 
-        ", does not match the length of the existing vector (", psvec->size(), ").",
+        ", does not match the length of the existing vector (", size(), ").",
         "\nThis is only possible when Meta is not set or contains only inherited scalars.");
     }
     
-    psvec = std::make_shared<vec_str>(x);
+    materialize();
+    pids = std::make_shared<vec_id>(intern_strings(x));
+    return *this;
+  }
+  
+  // NOTA: the strings are interned (copied only if new to the pool), x is released
+  MSV& set_string_vector(vec_str &&x){
+    set_string_vector(static_cast<const vec_str&>(x));
+    vec_str().swap(x);
     return *this;
   }
   
-  MSV& set_string_vector(const vec_str &&x){
+  MSV& set_string_ids(vec_id &&ids){
     
-    if(x.size() != psvec->size() && !pmeta->empty()){
+    if(ids.size() != size() && !pmeta->empty()){
       throw util::index_pblm(
-        "The length of the new vector, ", x.size(), 
-        ", does not match the length of the existing vector (", psvec->size(), ").",
+        "The length of the new vector, ", ids.size(), 
+        ", does not match the length of the existing vector (", size(), ").",
         "\nThis is only possible when Meta is not set or contains only inherited scalars.");
     }
     
-    psvec = std::make_shared<vec_str>(x);
+    materialize();
+    pids = std::make_shared<vec_id>(std::move(ids));
     return *this;
   }
   
-  MSV& push_back(MSV& x){
+  // appends the suffix to all the strings
+  MSV& add_suffix(const string &suffix){
+    
+    materialize();
+    
+    StringPool &pool = get_string_pool();
+    ptr_vec_id pids_new = std::make_shared<vec_id>();
+    pids_new->reserve(pids->size());
+    
+    string tmp;
+    for(const auto &id : *pids){
+      tmp = pool.view(id);
+      tmp += suffix;
+      pids_new->push_back(pool.intern(tmp));
+    }
     
-    // is x == this?
-    bool is_same = this == &x;
+    pids = pids_new;
+    return *this;
+  }
+  
+  // appends the elements of all the vectors, in order
+  // the string ids are allocated once, the vectors are never modified
+  MSV& concat(const vector<const MSV*> &all_x){
     
     // 1) the cause of emptyness, we keep the last one only
-    if(!is_same && !x.cause_empty.empty()){
-      cause_empty = x.cause_empty;
+    // 2) the storage of the non empty vectors, kept alive (x may be this)
+    vector<std::pair<ptr_vec_id, std::shared_ptr<Meta>>> all_parts;
+    size_t n_total = size();
+    for(const MSV *px : all_x){
+      if(px != this && !px->cause_empty.empty()){
+        cause_empty = px->cause_empty;
+      }
+      
+      if(!px->empty()){
+        px->materialize();
+        all_parts.emplace_back(px->pids, px->pmeta);
+        n_total += px->pids->size();
+      }
+    }
+    
+    if(all_parts.empty()){
+      return *this;
     }
     
-    // 2) dealing with empty elements
+    size_t k_start = 0;
     if(empty()){
-      if(x.empty()){
+      // we avoid the default copy constructor (bc of cause_empty)
+      // NOTA: the storage is shared, it is copied on write
+      pids = all_parts[0].first;
+      pmeta = all_parts[0].second;
+      psel.reset();
+      
+      if(all_parts.size() == 1){
         return *this;
       }
       
-      // we avoid the default copy constructor (bc of cause_empty)
-      psvec = x.psvec;
-      pmeta = x.pmeta;
-      
-      return *this;
+      k_start = 1;
     }
     
-    // 3) we resize the meta information
-    if(!empty()){
-      pmeta->resize(psvec->size());
-    }
+    materialize();
     
-    if(!is_same && !x.empty()){
-      x.pmeta->resize(x.psvec->size());
+    // 3) we grow the string vectors
+    ptr_vec_id pids_new = std::make_shared<vec_id>();
+    pids_new->reserve(n_total);
+    pids_new->insert(pids_new->end(), pids->begin(), pids->end());
+    for(size_t k = k_start ; k < all_parts.size() ; ++k){
+      const vec_id &ids_x = *all_parts[k].first;
+      pids_new->insert(pids_new->end(), ids_x.begin(), ids_x.end());
     }
     
-    // 4) we grow the string vectors
-    psvec->insert(psvec->end(), x.psvec->begin(), x.psvec->end());
+    // 4) we grow the meta information, resized to the number of observations
+    Meta &meta = own_meta();
+    meta.resize(pids->size());
+    meta.reserve(n_total);
+    
+    for(size_t k = k_start ; k < all_parts.size() ; ++k){
+      const size_t n_x = all_parts[k].first->size();
+      const Meta &meta_x = *all_parts[k].second;
+      if(meta_x.get_n_obs() == n_x){
+        meta.bind(meta_x);
+      } else {
+        Meta meta_x_resized = meta_x;
+        meta_x_resized.resize(n_x);
+        meta.bind(meta_x_resized);
+      }
+    }
     
-    // 5) we grow the meta information
-    pmeta->bind(*x.pmeta);
+    pids = pids_new;
     
     return *this;
   }
   
+  MSV& push_back(const MSV& x){
+    return concat({&x});
+  }
+  
   MSV& set_meta(const string &key, const vec_str &x){
     set_meta_internal(key, x);
     return *this;
   }
   
+  MSV& set_meta(const string &key, const vector<bool> &x){
+    set_meta_internal(key, x);
+    return *this;
+  }
+  
+  MSV& set_meta(const string &key, const vector<int> &x){
+    set_meta_internal(key, x);
+    return *this;
+  }
+  
   MSV& set_meta(const string &key, const string &x, const Meta::SCALAR_TYPE stype = Meta::SCALAR_TYPE::INHERIT){
-    pmeta->set(key, x, stype);
+    own_meta().set(key, x, stype);
     return *this;
   }
   
   MSV& set_meta(const string &key, const char *px, const Meta::SCALAR_TYPE stype = Meta::SCALAR_TYPE::INHERIT){
-    pmeta->set(key, string{px}, stype);
+    own_meta().set(key, string{px}, stype);
     return *this;
   }
   
   MSV& set_meta(const string &key, const bool &x, const Meta::SCALAR_TYPE stype = Meta::SCALAR_TYPE::INHERIT){
-    pmeta->set(key, x ? "true" : "false", stype);
+    own_meta().set(key, x, stype);
     return *this;
   }
   
   MSV& set_meta(const string &key, const int &x, const Meta::SCALAR_TYPE stype = Meta::SCALAR_TYPE::INHERIT){
-    pmeta->set(key, std::to_string(x), stype);
+    own_meta().set(key, x, stype);
     return *this;
   }
   
   MSV& rm_meta_key(const string &key, const bool check = false){
-    pmeta->rm_key(key, check);
+    own_meta().rm_key(key, check);
     return *this;
   }
   
@@ -771,10 +1135,10 @@ public:
   }
   
   MSV& clear(){
-    psvec = std::make_shared<vec_str>();
+    pids = std::make_shared<vec_id>();
     pmeta = std::make_shared<Meta>();
+    psel.reset();
     cause_empty.clear();
-    selection.clear();
     
     return *this;
   }
@@ -789,32 +1153,57 @@ public:
   //
   
   size_t size() const {
-    return psvec->size();
+    return psel ? psel->size() : pids->size();
   }
   
   bool empty() const {
-    return psvec->empty();
+    return size() == 0;
   }
   
-  ptr_vec_str get_string_vec_ptr() const {
-    return psvec;
+  bool is_view() const {
+    return psel != nullptr;
   }
   
-  const vec_str& get_string_vec() const {
-    return *psvec;
+  // NOTA: a view is materialized
+  const vec_id& get_ids() const {
+    materialize();
+    return *pids;
   }
   
-  const string string_at(size_t i) const {
-    if(i >= psvec->size()){
+  uint32_t id_at(size_t i) const {
+    if(i >= size()){
       throw util::index_pblm("The index selected (", 
                              i, ") is larger than the number of observations (", 
-                             psvec->size(), ").");
+                             size(), ").");
+    }
+    
+    return (*pids)[base_index(i)];
+  }
+  
+  // NOTA: the strings are copied, prefer view_at
+  vec_str get_string_vec() const {
+    const StringPool &pool = get_string_pool();
+    const size_t n = size();
+    vec_str res;
+    res.reserve(n);
+    for(size_t i = 0 ; i < n ; ++i){
+      res.emplace_back(pool.view((*pids)[base_index(i)]));
     }
     
-    return psvec->at(i);
+    return res;
+  }
+  
+  std::string_view view_at(size_t i) const {
+    return string_from_id(id_at(i));
+  }
+  
+  const string string_at(size_t i) const {
+    return string(view_at(i));
   }
   
+  // NOTA: a view is materialized
   const std::shared_ptr<Meta> get_meta_ptr() const {
+    materialize();
     return pmeta;
   }
   
@@ -828,6 +1217,7 @@ public:
   }
   
   Meta& get_meta() const {
+    materialize();
     return *pmeta;
   }
   
@@ -835,7 +1225,7 @@ public:
     if(!pmeta){
       pmeta = std::make_shared<Meta>();
     }
-    return *pmeta;
+    return own_meta();
   }
   
   bool is_meta_key(const string &key) const {
@@ -846,25 +1236,31 @@ public:
     return pmeta->is_key(key);
   }
   
-  vec_str meta(const string key) const {
+  // position of the column of the key, to be used with meta_at_pos
+  size_t meta_key_pos(const string &key) const {
     if(!is_meta_key(key)){
       throw util::index_pblm("The key `", key, "` is invalid.");
     }
     
-    return pmeta->get_vector(key);
+    return pmeta->get_key_pos(key);
   }
   
-  string meta_at(const string key, const size_t i) const {
-    if(!is_meta_key(key)){
-      throw util::index_pblm("The key `", key, "` is invalid.");
-    }
-    
-    if(i >= psvec->size()){
+  vec_str meta(const string key) const {
+    const size_t k = meta_key_pos(key);
+    return psel ? pmeta->get_vector(k, *psel) : pmeta->get_vector(k);
+  }
+  
+  string meta_at_pos(const size_t k, const size_t i) const {
+    if(i >= size()){
       throw util::index_pblm("The position ", i, " is larger ",
-                             "than the number of observations ", psvec->size(), ".");
+                             "than the number of observations ", size(), ".");
     }
     
-    return pmeta->get_vector_at(key, i);
+    return pmeta->get_vector_at(k, base_index(i));
+  }
+  
+  string meta_at(const string key, const size_t i) const {
+    return meta_at_pos(meta_key_pos(key), i);
   }
   
   string meta_at(const string key, const size_t i, const char* the_default) const {
@@ -872,12 +1268,7 @@ public:
       return string{the_default};
     }
     
-    if(i >= psvec->size()){
-      throw util::index_pblm("The position ", i, " is larger ",
-                             "than the number of observations ", psvec->size(), ".");
-    }
-    
-    return pmeta->get_vector_at(key, i);
+    return meta_at_pos(pmeta->get_key_pos(key), i);
   }
   
   template<typename T>
@@ -886,27 +1277,21 @@ public:
       return the_default;
     }
     
-    if(i >= psvec->size()){
-      throw util::index_pblm("The position ", i, " is larger ",
-                             "than the number of observations ", psvec->size(), ".");
-    }
-    
-    return static_cast<T>(pmeta->get_vector_at(key, i));
+    return static_cast<T>(meta_at_pos(pmeta->get_key_pos(key), i));
   }
   
   MSV at(const size_t i) const {
     
-    const size_t n = psvec->size();
+    const size_t n = size();
     if(i >= n){
       throw util::index_pblm("The selection ID (", i, ") is larger than ",
                              "the number of observations (", n, ").");
     }
     
     MSV res;
-    ptr_vec_str psvec_new = std::make_shared<vec_str>(1, psvec->at(i));
-    res.psvec = psvec_new;
+    res.pids = std::make_shared<vec_id>(1, id_at(i));
     
-    res.set_meta(pmeta->at(i));
+    res.set_meta(pmeta->at(base_index(i)));
     
     return res;
   }
@@ -915,6 +1300,7 @@ public:
   // selection 
   //
   
+  // NOTA: nothing is copied, the object becomes a view on the current storage
   template<typename T>
   MSV& select(const vector<T>& sel){
     
@@ -926,24 +1312,21 @@ public:
     static_assert(std::is_convertible_v<T, size_t>, 
                   "In `select`, values for selection must be represented by unsigned integers.");
     
-    // meta side
-    pmeta->select(sel);
-    
-    // string vector side
-    ptr_vec_str pvec_new = std::make_shared<vec_str>();
-    const size_t n = psvec->size();
+    std::shared_ptr<vec_id> psel_new = std::make_shared<vec_id>();
+    psel_new->reserve(sel.size());
+    const size_t n = size();
     
     for(auto &i : sel){
-      if(i >= n || i < 0){
+      if(static_cast<size_t>(i) >= n){
         throw util::index_pblm("When processing the selection, the selection ID (",
                                i, ") is invalid given the number of observations ", n, ".");
       }
       
-      pvec_new->push_back(psvec->at(i));
+      // successive selections are composed
+      psel_new->push_back(base_index(i));
     }
     
-    selection.clear();
-    psvec = pvec_new;
+    psel = psel_new;
     
     return *this;
   }
@@ -953,14 +1336,12 @@ public:
   // copy 
   //
   
+  // deep copy, a view is materialized
   MetaStringVec copy() const {
-    MetaStringVec new_obj;
-    
-    *new_obj.psvec = *psvec;
-    *new_obj.pmeta = *pmeta;
-    
-    new_obj.cause_empty = cause_empty;
-    new_obj.selection = selection;
+    MetaStringVec new_obj = *this;
+    new_obj.materialize();
+    new_obj.own_ids();
+    new_obj.own_meta();
     
     return new_obj;
   }
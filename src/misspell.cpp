@@ -0,0 +1,205 @@
+    //=========================================================================//
+   //            Author: Laurent R. Bergé, University of Bordeaux             //
+  //             Copyright (C) 2025-present, Laurent R. Bergé                //
+ //              MIT License (see project_root/LICENSE)                     //
+//=========================================================================//
+
+#include "misspell.hpp"
+#include "simd.hpp"
+
+#include <algorithm>
+
+namespace stringtools {
+
+namespace {
+
+int misspell_max_edits = 1;
+
+// short queries get at most one edit: 2 edits on 'abcd' would match almost anything
+const uint32_t MIN_SIZE_TWO_EDITS = 6;
+
+const uint32_t MAX_BITS = 64;
+
+inline bool is_same_letter(const char c1, const char c2){
+  return simd::fold_ascii(c1) == simd::fold_ascii(c2);
+}
+
+} // end anonymous namespace
+
+void set_misspell_max_edits(int k){
+  misspell_max_edits = std::clamp(k, 0, 2);
+}
+
+int get_misspell_max_edits(){
+  return misspell_max_edits;
+}
+
+MisspellMatcher::MisspellMatcher(const string &x, int max_edits): x(x){
+  
+  m = x.size();
+  k = std::clamp(max_edits, 0, 2);
+  if(m < MIN_SIZE_TWO_EDITS){
+    k = std::min(k, 1);
+  }
+  
+  if(m == 0 || m > MAX_BITS){
+    return;
+  }
+  
+  all_masks.assign(256, 0);
+  for(uint32_t i = 0 ; i < m ; ++i){
+    const unsigned char c = x[i];
+    const uint64_t bit = uint64_t{1} << i;
+    all_masks[c] |= bit;
+    
+    // the case insensitive counterpart
+    if(c >= 'a' && c <= 'z'){
+      all_masks[c - 32] |= bit;
+    } else if(c >= 'A' && c <= 'Z'){
+      all_masks[c + 32] |= bit;
+    }
+  }
+
+}
+
+bool MisspellMatcher::match(std::string_view y, uint32_t &start, uint32_t &end) const {
+  /* Algorithm:
+  *
+  * R[d] has its bit i set when x[0..i] matches a part of y ending at the
+  * current character with at most d edits. With c the current character and
+  * B[c] its mask:
+  *
+  * R'[0] = ((R[0] << 1) | 1) & B[c]
+  * R'[d] = ((R[d] << 1) | 1) & B[c]    match
+  *       | R[d - 1]                    insertion (c is not in x)
+  *       | R[d - 1] << 1               substitution
+  *       | R'[d - 1] << 1              deletion (a letter of x is skipped)
+  *       | (R2[d - 1] << 2) & B[c_prev] & (B[c] << 1)    transposition
+  *
+  * with R2 the state two characters before. Only the match term injects the
+  * bit 0: the first letter of x always matches.
+  *
+  * */
+  
+  if(m == 0){
+    return false;
+  }
+  
+  if(m > MAX_BITS){
+    return match_dp(y, start, end);
+  }
+  
+  const uint32_t n = y.size();
+  const uint64_t last_bit = uint64_t{1} << (m - 1);
+  
+  uint64_t R[3] = {0, 0, 0};
+  uint64_t R_prev[3] = {0, 0, 0};
+  uint64_t mask_prev = 0;
+  
+  for(uint32_t j = 0 ; j < n ; ++j){
+    const uint64_t mask = all_masks[static_cast<unsigned char>(y[j])];
+    
+    uint64_t R_new[3];
+    R_new[0] = ((R[0] << 1) | 1) & mask;
+    for(int d = 1 ; d <= k ; ++d){
+      R_new[d] = (((R[d] << 1) | 1) & mask) | R[d - 1] | (R[d - 1] << 1) | (R_new[d - 1] << 1) |
+                 ((R_prev[d - 1] << 2) & mask_prev & (mask << 1));
+    }
+    
+    for(int d = 0 ; d <= k ; ++d){
+      R_prev[d] = R[d];
+      R[d] = R_new[d];
+    }
+    mask_prev = mask;
+    
+    if(R[k] & last_bit){
+      // we find the start of the span
+      end = j + 1;
+      
+      // the span is of length m - k to m + k
+      const uint32_t s_min = end >= m + k ? end - m - k : 0;
+      const uint32_t s_max = end + k >= m ? end + k - m : 0;
+      
+      int best_dist = k + 1;
+      uint32_t best_gap = 0;
+      for(uint32_t s = s_min ; s <= std::min(s_max, end - 1) ; ++s){
+        if(!is_same_letter(y[s], x[0])){
+          continue;
+        }
+        
+        const int dist = anchored_distance(y, s, end);
+        const uint32_t span = end - s;
+        const uint32_t gap = span > m ? span - m : m - span;
+        if(dist < best_dist || (dist == best_dist && gap < best_gap)){
+          best_dist = dist;
+          best_gap = gap;
+          start = s;
+        }
+      }
+      
+      if(best_dist <= k){
+        return true;
+      }
+    }
+  }
+  
+  return false;
+}
+
+int MisspellMatcher::anchored_distance(std::string_view y, const uint32_t start, const uint32_t end) const {
+  // restricted Damerau-Levenshtein distance between x[1..] and y[start + 1, end)
+  // x[0] and y[start] are assumed to match
+  
+  const uint32_t nx = m - 1;
+  const uint32_t ny = end - start - 1;
+  const char *px = x.data() + 1;
+  const char *py = y.data() + start + 1;
+  
+  vector<int> row_prev2(ny + 1), row_prev(ny + 1), row(ny + 1);
+  for(uint32_t j = 0 ; j <= ny ; ++j){
+    row_prev[j] = j;
+  }
+  
+  for(uint32_t i = 1 ; i <= nx ; ++i){
+    row[0] = i;
+    for(uint32_t j = 1 ; j <= ny ; ++j){
+      const int cost = is_same_letter(px[i - 1], py[j - 1]) ? 0 : 1;
+      row[j] = std::min({row_prev[j] + 1, row[j - 1] + 1, row_prev[j - 1] + cost});
+      if(i > 1 && j > 1 && is_same_letter(px[i - 1], py[j - 2]) && is_same_letter(px[i - 2], py[j - 1])){
+        row[j] = std::min(row[j], row_prev2[j - 2] + 1);
+      }
+    }
+    
+    std::swap(row_prev2, row_prev);
+    std::swap(row_prev, row);
+  }
+  
+  return row_prev[ny];
+}
+
+bool MisspellMatcher::match_dp(std::string_view y, uint32_t &start, uint32_t &end) const {
+  // only for very long queries: we try all the starting points
+  
+  const uint32_t n = y.size();
+  for(uint32_t s = 0 ; s < n ; ++s){
+    if(!is_same_letter(y[s], x[0])){
+      continue;
+    }
+    
+    // the span is of length m - k to m + k
+    const uint32_t e_min = s + std::max<uint32_t>(1, m - k);
+    const uint32_t e_max = std::min(n, s + m + k);
+    for(uint32_t e = e_min ; e <= e_max ; ++e){
+      if(anchored_distance(y, s, e) <= k){
+        start = s;
+        end = e;
+        return true;
+      }
+    }
+  }
+  
+  return false;
+}
+
+
+} // namespace stringtools
@@ -0,0 +1,57 @@
+    //=========================================================================//
+   //            Author: Laurent R. Bergé, University of Bordeaux             //
+  //             Copyright (C) 2025-present, Laurent R. Bergé                //
+ //              MIT License (see project_root/LICENSE)                     //
+//=========================================================================//
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+using std::string;
+using std::vector;
+
+namespace stringtools {
+
+// Implementation notes:
+// - MisspellMatcher looks for the query x within y, allowing up to k edits:
+//   deletion, insertion, substitution and transposition of two adjacent letters
+// - the first letter of x must always match (case insensitive), as was the
+//   case in the previous hand coded algorithm: this avoids too much noise
+// - the matching is bit-parallel (Wu-Manber extension of shift-and, with the
+//   transpositions): one pass over y, O(k) word operations per character
+// - the matcher is built once per query and then applied to every choice
+// - queries longer than 64 bytes fall back to a dynamic programming algorithm
+//
+
+// maximum number of edits allowed in the misspell tiers of string_match (0 to 2)
+void set_misspell_max_edits(int k);
+int get_misspell_max_edits();
+
+class MisspellMatcher {
+  string x;
+  uint32_t m = 0;
+  int k = 1;
+  
+  // for each byte: the bits of the positions in x where it appears (case insensitive)
+  vector<uint64_t> all_masks;
+  
+  bool match_dp(std::string_view y, uint32_t &start, uint32_t &end) const;
+  int anchored_distance(std::string_view y, const uint32_t start, const uint32_t end) const;
+
+public:
+  MisspellMatcher() = delete;
+  MisspellMatcher(const string &x, int max_edits);
+  
+  int max_edits() const { return k; }
+  
+  // is x in y with at most k edits?
+  // if so, [start, end) is the span of y that matches (in bytes)
+  bool match(std::string_view y, uint32_t &start, uint32_t &end) const;
+};
+
+
+} // namespace stringtools
@@ -0,0 +1,216 @@
+    //=========================================================================//
+   //            Author: Laurent R. Bergé, University of Bordeaux             //
+  //             Copyright (C) 2025-present, Laurent R. Bergé                //
+ //              MIT License (see project_root/LICENSE)                     //
+//=========================================================================//
+
+#include "parenindex.hpp"
+#include "stringtools.hpp"
+
+#include <algorithm>
+
+namespace stringtools {
+
+//
+// Pairs -----------------------------------------------------------------------
+//
+
+int ParenIndex::Pairs::top_before(size_t m) const {
+  // the top of the stack of open parens after the first m parens
+  
+  if(m == 0){
+    return -1;
+  }
+  
+  const size_t k = m - 1;
+  return is_opening_paren(all_paren[k]) ? static_cast<int>(k) : all_link[k];
+}
+
+int ParenIndex::Pairs::truncate(uint cut){
+  // we drop the parens from the position cut, the top of the stack is returned
+  
+  const size_t m = std::lower_bound(all_pos.begin(), all_pos.end(), cut) - all_pos.begin();
+  const int top = top_before(m);
+  
+  // the open parens in the stack may have been closed after cut
+  int k = top;
+  while(k != -1){
+    all_pair[k] = -1;
+    k = all_link[k];
+  }
+  
+  all_pos.resize(m);
+  all_paren.resize(m);
+  all_pair.resize(m);
+  all_link.resize(m);
+  
+  return top;
+}
+
+void ParenIndex::Pairs::push(uint pos, char paren, int &top){
+  
+  const int k = all_pos.size();
+  all_pos.push_back(pos);
+  all_paren.push_back(paren);
+  
+  if(is_opening_paren(paren)){
+    all_pair.push_back(-1);
+    all_link.push_back(top);
+    top = k;
+    
+  } else {
+    if(top != -1 && all_paren[top] == pair_quote_paren_char(paren)){
+      all_pair[top] = k;
+      all_pair.push_back(top);
+      top = all_link[top];
+    } else {
+      // syntax error or multi line: ignored
+      all_pair.push_back(-1);
+    }
+    
+    all_link.push_back(top);
+  }
+}
+
+//
+// ParenIndex ------------------------------------------------------------------
+//
+
+int ParenIndex::type_index(const char paren){
+  switch(paren){
+    case '(': case ')': return 0;
+    case '[': case ']': return 1;
+  }
+  
+  return 2;
+}
+
+void ParenIndex::update(const string &x){
+  
+  const uint n = x.size();
+  if(pdata && n_valid == n_scanned && n_scanned == n){
+    return;
+  }
+  
+  if(!pdata){
+    pdata = std::make_unique<Data>();
+    n_valid = 0;
+  }
+  
+  Data &data = *pdata;
+  
+  //
+  // step 1: we keep the structure before the edit
+  //
+  
+  uint cut = std::min(n_valid, n);
+  
+  // if the edit is within a quote, we restart from the quote
+  vector<uint> &quote_start = data.quote_start;
+  vector<uint> &quote_end = data.quote_end;
+  size_t q = std::lower_bound(quote_end.begin(), quote_end.end(), cut) - quote_end.begin();
+  if(q < quote_start.size() && quote_start[q] < cut){
+    cut = quote_start[q];
+  }
+  quote_start.resize(q);
+  quote_end.resize(q);
+  
+  int top_nested = data.nested.truncate(cut);
+  int top_by_type[3];
+  for(int t = 0 ; t < 3 ; ++t){
+    top_by_type[t] = data.by_type[t].truncate(cut);
+  }
+  
+  //
+  // step 2: we scan the rest of the line
+  //
+  
+  uint i = cut;
+  while(i < n){
+    const char c = x[i];
+    
+    if(is_quote(c)){
+      const char quote = c;
+      quote_start.push_back(i);
+      ++i;
+      
+      while( i < n && !( x[i] == quote && !is_escaped(x, i) ) ){
+        ++i;
+      }
+      
+      quote_end.push_back(i);
+      
+    } else if(is_paren(c)){
+      data.nested.push(i, c, top_nested);
+      const int t = type_index(c);
+      data.by_type[t].push(i, c, top_by_type[t]);
+    }
+    
+    ++i;
+  }
+  
+  n_valid = n;
+  n_scanned = n;
+}
+
+uint ParenIndex::matching_paren(const uint i) const {
+  
+  const vector<uint> &all_pos = pdata->nested.all_pos;
+  auto it = std::lower_bound(all_pos.begin(), all_pos.end(), i);
+  if(it == all_pos.end() || *it != i){
+    return UNSET::UINT;
+  }
+  
+  const Pairs &pairs = pdata->by_type[type_index(pdata->nested.all_paren[it - all_pos.begin()])];
+  const size_t k = std::lower_bound(pairs.all_pos.begin(), pairs.all_pos.end(), i) - pairs.all_pos.begin();
+  
+  return pairs.all_pair[k] == -1 ? UNSET::UINT : pairs.all_pos[pairs.all_pair[k]];
+}
+
+uint ParenIndex::enclosing_paren(const uint i) const {
+  const Pairs &pairs = pdata->nested;
+  const size_t m = std::lower_bound(pairs.all_pos.begin(), pairs.all_pos.end(), i) - pairs.all_pos.begin();
+  const int top = pairs.top_before(m);
+  
+  return top == -1 ? UNSET::UINT : pairs.all_pos[top];
+}
+
+uint ParenIndex::enclosing_paren(const uint i, const char open_paren) const {
+  const Pairs &pairs = pdata->by_type[type_index(open_paren)];
+  const size_t m = std::lower_bound(pairs.all_pos.begin(), pairs.all_pos.end(), i) - pairs.all_pos.begin();
+  const int top = pairs.top_before(m);
+  
+  return top == -1 ? UNSET::UINT : pairs.all_pos[top];
+}
+
+uint ParenIndex::closing_paren(const uint i_open) const {
+  const Pairs &pairs = pdata->nested;
+  auto it = std::lower_bound(pairs.all_pos.begin(), pairs.all_pos.end(), i_open);
+  if(it == pairs.all_pos.end() || *it != i_open){
+    return UNSET::UINT;
+  }
+  
+  const int pair = pairs.all_pair[it - pairs.all_pos.begin()];
+  return pair == -1 ? UNSET::UINT : pairs.all_pos[pair];
+}
+
+bool ParenIndex::quote_containing(const uint i, uint &start, uint &end) const {
+  // the first quote ending at or after i
+  
+  const vector<uint> &quote_end = pdata->quote_end;
+  const size_t q = std::lower_bound(quote_end.begin(), quote_end.end(), i) - quote_end.begin();
+  if(q < quote_end.size() && pdata->quote_start[q] < i){
+    start = pdata->quote_start[q];
+    end = quote_end[q];
+    return true;
+  }
+  
+  return false;
+}
+
+const vector<uint>& ParenIndex::paren_positions() const {
+  return pdata->nested.all_pos;
+}
+
+
+} // namespace stringtools
@@ -0,0 +1,113 @@
+    //=========================================================================//
+   //            Author: Laurent R. Bergé, University of Bordeaux             //
+  //             Copyright (C) 2025-present, Laurent R. Bergé                //
+ //              MIT License (see project_root/LICENSE)                     //
+//=========================================================================//
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+using std::string;
+using std::vector;
+
+using uint = unsigned int;
+
+namespace stringtools {
+
+// Implementation notes:
+// - ParenIndex stores the structure of a line: the quoted spans and the parens
+//   outside of them, with their matching paren
+// - the parens are paired in two ways:
+//   * nested: a closing paren closes the last open paren if of the same type,
+//     else it is ignored (used for the selections and the enclosing parens)
+//   * by type: each type of paren is paired independently of the others
+//     (used for the paren highlighting)
+// - for each paren we keep the link to the stack of open parens: for an open
+//   paren, the open paren below it ; for a closing paren, the top of the stack
+//   after it => the enclosing paren at any position is found with one binary search
+// - the index is updated lazily: an edit at position i only marks the index as
+//   invalid from i, the next query keeps the structure before i (or before the
+//   quote containing i) and rescans the rest of the line
+// - all the positions are narrow (bytes)
+//
+
+class ParenIndex {
+  
+  struct Pairs {
+    vector<uint> all_pos;
+    vector<char> all_paren;
+    // index of the matching paren (-1 if none)
+    vector<int> all_pair;
+    // link to the stack of open parens (-1 if empty), see the notes
+    vector<int> all_link;
+    
+    int top_before(size_t m) const;
+    int truncate(uint cut);
+    void push(uint pos, char paren, int &top);
+  };
+  
+  struct Data {
+    Pairs nested;
+    Pairs by_type[3];
+    
+    // the quote at quote_start[k] closes at quote_end[k], or is not closed
+    // if quote_end[k] is the size of the line
+    vector<uint> quote_start;
+    vector<uint> quote_end;
+  };
+  
+  std::unique_ptr<Data> pdata;
+  // number of bytes described by the index
+  uint n_valid = 0;
+  uint n_scanned = 0;
+  
+  static int type_index(const char paren);
+
+public:
+  ParenIndex() = default;
+  
+  // the copies are recomputed on first use
+  ParenIndex(const ParenIndex&){}
+  ParenIndex& operator=(const ParenIndex&){
+    invalidate_from(0);
+    return *this;
+  }
+  ParenIndex(ParenIndex&&) = default;
+  ParenIndex& operator=(ParenIndex&&) = default;
+  
+  // to be called at each edit of the line
+  void invalidate_from(const uint i){
+    if(i < n_valid){
+      n_valid = i;
+    }
+  }
+  
+  // brings the index up to date with x, the line last edited
+  void update(const string &x);
+  
+  // position of the paren matching the one at i (same type), UNSET::UINT if none
+  // (also when there is no paren at i or when it is within quotes)
+  uint matching_paren(const uint i) const;
+  
+  // position of the innermost open paren before i and not closed before i,
+  // nested pairing, UNSET::UINT if none
+  uint enclosing_paren(const uint i) const;
+  // same, restricted to one type of paren: open_paren in "([{"
+  uint enclosing_paren(const uint i, const char open_paren) const;
+  
+  // position of the paren closing the open paren at i, nested pairing, UNSET::UINT if none
+  uint closing_paren(const uint i_open) const;
+  
+  // whether i is within a quote: after the opening quote, up to the closing quote
+  bool quote_containing(const uint i, uint &start, uint &end) const;
+  
+  // positions of the parens outside the quotes, in increasing order
+  const vector<uint>& paren_positions() const;
+};
+
+
+} // namespace stringtools
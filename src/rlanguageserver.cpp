@@ -40,6 +40,12 @@ void input_hook(){
   if(R::GA_peekevent()){
     R::R_ProcessEvents();
   }
+  
+  // the user is idle: we refresh the outdated caches
+  CachedData::run_pending_refreshes();
+  
+  // and release the candidates of the past autocompletions, if numerous
+  str::trim_string_pool();
 }
 
 
@@ -72,9 +72,9 @@ static AutocompChoices gen_shortcut_command_suggestions(bool already_closed){
   vector<string> all_cmd = util::map_names(shortcut_commands);
             
   const size_t n = all_cmd.size();
-  vector<string> cursor_shift(n);
+  vector<int> cursor_shift(n);
   vector<string> append_right(n);
-  vector<string> do_continue(n);
+  vector<bool> do_continue(n);
   
   int i = -1;
   for(auto &cmd : all_cmd){
@@ -84,7 +84,7 @@ static AutocompChoices gen_shortcut_command_suggestions(bool already_closed){
       const string &type = shortcut_values_with_freeform.at(cmd);
       if(type == "string"){
         cmd += ": \"\"";
-        cursor_shift[i] = already_closed ? "-1" : "-2";
+        cursor_shift[i] = already_closed ? -1 : -2;
       } else {
         cmd += ": ";
       }
@@ -100,7 +100,7 @@ static AutocompChoices gen_shortcut_command_suggestions(bool already_closed){
       
     } else {
       cmd += ": ";
-      do_continue[i] = "true";
+      do_continue[i] = true;
     }
   }
   
@@ -133,7 +133,7 @@ AutocompChoices gen_shortcut_condition_suggestions(bool already_closed, bool is_
   }
   
   const size_t n = all_conditions.size();
-  vector<string> cursor_shift(n);
+  vector<int> cursor_shift(n);
   vector<string> append_right(n);
   
   int i = -1;
@@ -146,19 +146,19 @@ AutocompChoices gen_shortcut_condition_suggestions(bool already_closed, bool is_
       
       if(opening_if){
         append_right[i] = ">  <endif>";
-        cursor_shift[i] = "-11";
+        cursor_shift[i] = -11;
         
       } else if(!already_closed){
         append_right[i] = ">";
-        cursor_shift[i] = "-2";
+        cursor_shift[i] = -2;
       } else {
-        cursor_shift[i] = "-1";
+        cursor_shift[i] = -1;
       }
       
     } else {
       if(opening_if){
         append_right[i] = ">  <endif>";
-        cursor_shift[i] = "-8";
+        cursor_shift[i] = -8;
         
       } else if(!already_closed){
         append_right[i] = ">";
@@ -0,0 +1,315 @@
+    //=========================================================================//
+   //            Author: Laurent R. Bergé, University of Bordeaux             //
+  //             Copyright (C) 2025-present, Laurent R. Bergé                //
+ //              MIT License (see project_root/LICENSE)                     //
+//=========================================================================//
+
+#pragma once
+
+#include <string_view>
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX2__)
+  #include <immintrin.h>
+  #define SIMD_AVX2
+#elif defined(__SSE2__) || defined(_M_X64)
+  #include <emmintrin.h>
+  #define SIMD_SSE2
+#endif
+
+// Implementation notes:
+// - case insensitive comparisons only fold ASCII letters (as is_same_letter and to_lower)
+// - the vector width is chosen at compile time: AVX2 (when compiled with -mavx2),
+//   else SSE2 (always available on x86-64), else a scalar fallback
+// - the substring search compares the first and last characters of the
+//   pattern on a full block of positions, candidates are then checked in full
+// - the UTF-8 characters are counted as the bytes that are not continuation
+//   bytes (10xxxxxx), a block at a time
+//
+
+namespace simd {
+
+using std::string_view;
+
+inline unsigned char fold_ascii(const unsigned char c){
+  return (c >= 'A' && c <= 'Z') ? c + 32 : c;
+}
+
+//
+// vector primitives -----------------------------------------------------------
+//
+
+#if defined(SIMD_AVX2)
+
+const size_t BLOCK = 32;
+using block_t = __m256i;
+
+inline block_t load(const char *x){
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x));
+}
+
+inline block_t broadcast(const char c){
+  return _mm256_set1_epi8(c);
+}
+
+inline block_t fold(const block_t &v){
+  // NOTA: the comparisons are signed => non ASCII bytes are never upper case
+  const block_t is_ge_A = _mm256_cmpgt_epi8(v, _mm256_set1_epi8('A' - 1));
+  const block_t is_le_Z = _mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), v);
+  const block_t is_upper = _mm256_and_si256(is_ge_A, is_le_Z);
+  return _mm256_or_si256(v, _mm256_and_si256(is_upper, _mm256_set1_epi8(0x20)));
+}
+
+inline uint32_t eq_mask(const block_t &x, const block_t &y){
+  return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y)));
+}
+
+inline uint32_t both_eq_mask(const block_t &x1, const block_t &y1, const block_t &x2, const block_t &y2){
+  const block_t eq = _mm256_and_si256(_mm256_cmpeq_epi8(x1, y1), _mm256_cmpeq_epi8(x2, y2));
+  return static_cast<uint32_t>(_mm256_movemask_epi8(eq));
+}
+
+// bytes >= 128
+inline uint32_t non_ascii_mask(const block_t &x){
+  return static_cast<uint32_t>(_mm256_movemask_epi8(x));
+}
+
+// UTF-8 continuation bytes: 128-191, ie -128 to -65 when signed
+inline uint32_t continuation_mask(const block_t &x){
+  return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpgt_epi8(_mm256_set1_epi8(-64), x)));
+}
+
+const uint32_t FULL_MASK = 0xFFFFFFFF;
+
+#elif defined(SIMD_SSE2)
+
+const size_t BLOCK = 16;
+using block_t = __m128i;
+
+inline block_t load(const char *x){
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(x));
+}
+
+inline block_t broadcast(const char c){
+  return _mm_set1_epi8(c);
+}
+
+inline block_t fold(const block_t &v){
+  // NOTA: the comparisons are signed => non ASCII bytes are never upper case
+  const block_t is_ge_A = _mm_cmpgt_epi8(v, _mm_set1_epi8('A' - 1));
+  const block_t is_le_Z = _mm_cmplt_epi8(v, _mm_set1_epi8('Z' + 1));
+  const block_t is_upper = _mm_and_si128(is_ge_A, is_le_Z);
+  return _mm_or_si128(v, _mm_and_si128(is_upper, _mm_set1_epi8(0x20)));
+}
+
+inline uint32_t eq_mask(const block_t &x, const block_t &y){
+  return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)));
+}
+
+inline uint32_t both_eq_mask(const block_t &x1, const block_t &y1, const block_t &x2, const block_t &y2){
+  const block_t eq = _mm_and_si128(_mm_cmpeq_epi8(x1, y1), _mm_cmpeq_epi8(x2, y2));
+  return static_cast<uint32_t>(_mm_movemask_epi8(eq));
+}
+
+// bytes >= 128
+inline uint32_t non_ascii_mask(const block_t &x){
+  return static_cast<uint32_t>(_mm_movemask_epi8(x));
+}
+
+// UTF-8 continuation bytes: 128-191, ie -128 to -65 when signed
+inline uint32_t continuation_mask(const block_t &x){
+  return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmplt_epi8(x, _mm_set1_epi8(-64))));
+}
+
+const uint32_t FULL_MASK = 0xFFFF;
+
+#endif
+
+inline int first_bit(const uint32_t x){
+  #if defined(__GNUC__)
+    return __builtin_ctz(x);
+  #else
+    int res = 0;
+    while(!((x >> res) & 1)){
+      ++res;
+    }
+    return res;
+  #endif
+}
+
+inline int count_bits(uint32_t x){
+  #if defined(__GNUC__)
+    return __builtin_popcount(x);
+  #else
+    int res = 0;
+    while(x != 0){
+      x &= x - 1;
+      ++res;
+    }
+    return res;
+  #endif
+}
+
+//
+// UTF-8 and VTS scanning ------------------------------------------------------
+//
+
+inline bool is_utf8_continuation(const unsigned char c){
+  return c >= 128 && c <= 191;
+}
+
+// number of UTF-8 characters in the first n bytes of x (= bytes that are not continuations)
+inline size_t count_utf8_chars(const char *x, const size_t n){
+  size_t n_cont = 0;
+  size_t i = 0;
+  
+  #if defined(SIMD_AVX2) || defined(SIMD_SSE2)
+    for( ; i + BLOCK <= n ; i += BLOCK){
+      n_cont += count_bits(continuation_mask(load(x + i)));
+    }
+  #endif
+  
+  for( ; i < n ; ++i){
+    if(is_utf8_continuation(x[i])){
+      ++n_cont;
+    }
+  }
+  
+  return n - n_cont;
+}
+
+// number of leading bytes of x that are plain ASCII: neither ESC (27) nor >= 128
+inline size_t plain_ascii_prefix(const char *x, const size_t n){
+  size_t i = 0;
+  
+  #if defined(SIMD_AVX2) || defined(SIMD_SSE2)
+    const block_t v_esc = broadcast(27);
+    for( ; i + BLOCK <= n ; i += BLOCK){
+      const block_t v = load(x + i);
+      const uint32_t mask = non_ascii_mask(v) | eq_mask(v, v_esc);
+      if(mask != 0){
+        return i + first_bit(mask);
+      }
+    }
+  #endif
+  
+  for( ; i < n ; ++i){
+    const unsigned char c = x[i];
+    if(c == 27 || c >= 128){
+      return i;
+    }
+  }
+  
+  return n;
+}
+
+//
+// equality --------------------------------------------------------------------
+//
+
+// are the first n bytes of x and y equal (case insensitive)
+inline bool equal_fold(const char *x, const char *y, const size_t n){
+  size_t i = 0;
+  
+  #if defined(SIMD_AVX2) || defined(SIMD_SSE2)
+    for( ; i + BLOCK <= n ; i += BLOCK){
+      if(eq_mask(fold(load(x + i)), fold(load(y + i))) != FULL_MASK){
+        return false;
+      }
+    }
+  #endif
+  
+  for( ; i < n ; ++i){
+    if(fold_ascii(x[i]) != fold_ascii(y[i])){
+      return false;
+    }
+  }
+  
+  return true;
+}
+
+inline bool equal(const char *x, const char *y, const size_t n, const bool strict_case){
+  return strict_case ? std::memcmp(x, y, n) == 0 : equal_fold(x, y, n);
+}
+
+// is x a prefix of y
+inline bool starts_with(string_view x, string_view y, const bool strict_case){
+  if(y.size() < x.size()){
+    return false;
+  }
+  
+  return equal(x.data(), y.data(), x.size(), strict_case);
+}
+
+//
+// substring search ------------------------------------------------------------
+//
+
+// position of the first occurrence of x in y, or string_view::npos
+template<bool STRICT_CASE>
+inline size_t find_impl(string_view x, string_view y){
+  const size_t nx = x.size();
+  const size_t ny = y.size();
+  
+  if(nx == 0){
+    return 0;
+  }
+  
+  if(nx > ny){
+    return string_view::npos;
+  }
+  
+  const char *px = x.data();
+  const char *py = y.data();
+  const char first = STRICT_CASE ? px[0] : fold_ascii(px[0]);
+  const char last = STRICT_CASE ? px[nx - 1] : fold_ascii(px[nx - 1]);
+  
+  // the last position at which x can start
+  const size_t j_max = ny - nx;
+  size_t j = 0;
+  
+  #if defined(SIMD_AVX2) || defined(SIMD_SSE2)
+    const block_t v_first = broadcast(first);
+    const block_t v_last = broadcast(last);
+    
+    // the block of last characters must be within y
+    for( ; j + BLOCK <= j_max + 1 ; j += BLOCK){
+      block_t block_first = load(py + j);
+      block_t block_last = load(py + j + nx - 1);
+      if(!STRICT_CASE){
+        block_first = fold(block_first);
+        block_last = fold(block_last);
+      }
+      
+      uint32_t mask = both_eq_mask(block_first, v_first, block_last, v_last);
+      while(mask != 0){
+        const int k = first_bit(mask);
+        if(nx <= 2 || equal(px + 1, py + j + k + 1, nx - 2, STRICT_CASE)){
+          return j + k;
+        }
+        mask &= mask - 1;
+      }
+    }
+  #endif
+  
+  for( ; j <= j_max ; ++j){
+    const char c_first = STRICT_CASE ? py[j] : fold_ascii(py[j]);
+    const char c_last = STRICT_CASE ? py[j + nx - 1] : fold_ascii(py[j + nx - 1]);
+    if(c_first == first && c_last == last){
+      if(nx <= 2 || equal(px + 1, py + j + 1, nx - 2, STRICT_CASE)){
+        return j;
+      }
+    }
+  }
+  
+  return string_view::npos;
+}
+
+inline size_t find(string_view x, string_view y, const bool strict_case){
+  return strict_case ? find_impl<true>(x, y) : find_impl<false>(x, y);
+}
+
+
+} // namespace simd
@@ -276,10 +276,10 @@ str::StringMatch ConsoleCommand::ac_suggestion_special_function(const string &be
     choices = fun_names;
     
     // we set continue ovnly for "options."
-    vector<string> cont(n, "false");
+    vector<bool> cont(n, false);
     size_t pos = util::which<string>(fun_names, "options.");
     if(pos < cont.size()){
-      cont[pos] = "true";
+      cont[pos] = true;
     }
     
     choices.set_meta("continue", cont);
@@ -460,7 +460,7 @@ str::StringMatch ConsoleCommand::ac_suggestion_options(const string &before_curs
             
             // we may suggest the freeform
             const size_t n = all_valid_values.size();
-            vector<string> cursor_shift(n);
+            vector<int> cursor_shift(n);
             vector<string> append_right(n);
             
             int i = -1;
@@ -476,7 +476,7 @@ str::StringMatch ConsoleCommand::ac_suggestion_options(const string &before_curs
                 const string &type = shortcut_values_with_freeform.at(value);
                 if(type == "string"){
                   value += ": \"\"";
-                  cursor_shift[i] = already_closed ? "-1" : "-2";
+                  cursor_shift[i] = already_closed ? -1 : -2;
                 } else {
                   value += ": ";
                 }
@@ -819,7 +819,7 @@ std::shared_ptr<AutocompChoices> suggest_reprex_last(ConsoleCommand *pconcom){
   
   *pchoices = numbers;
   pchoices->set_labels(labels);
-  pchoices->set_meta("autocomp-bottom", "true");
+  pchoices->set_meta("autocomp-bottom", true);
   
   return pchoices;
 }
@@ -0,0 +1,320 @@
+    //=========================================================================//
+   //            Author: Laurent R. Bergé, University of Bordeaux             //
+  //             Copyright (C) 2025-present, Laurent R. Bergé                //
+ //              MIT License (see project_root/LICENSE)                     //
+//=========================================================================//
+
+#include "spelldict.hpp"
+#include "matchindex.hpp"
+#include "simd.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+namespace stringtools {
+
+namespace {
+
+std::shared_ptr<const SpellDictionary> spell_dictionary;
+
+// version of the format of the lines of the dictionary
+const string LINES_VERSION = "spelldict 1";
+
+inline uint64_t hash_string(const string &x){
+  // FNV-1a
+  uint64_t h = 14695981039346656037ULL;
+  for(const auto &c : x){
+    h = (h ^ static_cast<unsigned char>(c)) * 1099511628211ULL;
+  }
+  return h;
+}
+
+void add_deletions(const string &x, const int k, vector<string> &res){
+  // all the strings obtained by deleting up to k letters of x, x included
+  // NOTA: with duplicates
+  
+  res.push_back(x);
+  if(k == 0 || x.size() <= 1){
+    return;
+  }
+  
+  for(size_t i = 0 ; i < x.size() ; ++i){
+    string del = x.substr(0, i) + x.substr(i + 1);
+    add_deletions(del, k - 1, res);
+  }
+}
+
+vector<uint64_t> unique_deletion_keys(const string &x, const int k){
+  vector<string> all_del;
+  add_deletions(x.substr(0, SpellDictionary::PREFIX_SIZE), k, all_del);
+  
+  vector<uint64_t> res;
+  res.reserve(all_del.size());
+  for(const auto &del : all_del){
+    res.push_back(hash_string(del));
+  }
+  
+  std::sort(res.begin(), res.end());
+  res.erase(std::unique(res.begin(), res.end()), res.end());
+  
+  return res;
+}
+
+inline string to_lower_ascii(const string &x){
+  string res = x;
+  for(auto &c : res){
+    c = simd::fold_ascii(c);
+  }
+  return res;
+}
+
+} // end anonymous namespace
+
+//
+// tokens ----------------------------------------------------------------------
+//
+
+vector<string> split_tokens(const string &x){
+  vector<string> res;
+  
+  const size_t n = x.size();
+  size_t i = 0;
+  while(i < n){
+    if(!is_token_char(x[i])){
+      ++i;
+      continue;
+    }
+    
+    const size_t i_start = i;
+    while(i < n && is_token_char(x[i])){
+      ++i;
+    }
+    
+    res.push_back(to_lower_ascii(x.substr(i_start, i - i_start)));
+  }
+  
+  return res;
+}
+
+vector<string> identifier_tokens(const vector<string> &all_x, const uint32_t min_size){
+  vector<string> res;
+  for(const auto &x : all_x){
+    for(auto &token : split_tokens(x)){
+      if(token.size() >= min_size){
+        res.push_back(std::move(token));
+      }
+    }
+  }
+  
+  std::sort(res.begin(), res.end());
+  res.erase(std::unique(res.begin(), res.end()), res.end());
+  
+  return res;
+}
+
+int osa_distance(const string &x, const string &y, const int max_dist){
+  
+  const int nx = x.size();
+  const int ny = y.size();
+  if(std::abs(nx - ny) > max_dist){
+    return max_dist + 1;
+  }
+  
+  vector<int> row_prev2(ny + 1), row_prev(ny + 1), row(ny + 1);
+  for(int j = 0 ; j <= ny ; ++j){
+    row_prev[j] = j;
+  }
+  
+  for(int i = 1 ; i <= nx ; ++i){
+    row[0] = i;
+    int row_min = row[0];
+    const char cx = simd::fold_ascii(x[i - 1]);
+    for(int j = 1 ; j <= ny ; ++j){
+      const char cy = simd::fold_ascii(y[j - 1]);
+      const int cost = cx == cy ? 0 : 1;
+      row[j] = std::min({row_prev[j] + 1, row[j - 1] + 1, row_prev[j - 1] + cost});
+      if(i > 1 && j > 1 && cx == simd::fold_ascii(y[j - 2]) && simd::fold_ascii(x[i - 2]) == cy){
+        row[j] = std::min(row[j], row_prev2[j - 2] + 1);
+      }
+      row_min = std::min(row_min, row[j]);
+    }
+    
+    if(row_min > max_dist){
+      return max_dist + 1;
+    }
+    
+    std::swap(row_prev2, row_prev);
+    std::swap(row_prev, row);
+  }
+  
+  return row_prev[ny];
+}
+
+//
+// SpellDictionary -------------------------------------------------------------
+//
+
+SpellDictionary::SpellDictionary(const vector<string> &words, int max_edits){
+  
+  k = std::clamp(max_edits, 1, 2);
+  
+  all_words.reserve(words.size());
+  for(const auto &w : words){
+    if(!w.empty()){
+      all_words.push_back(to_lower_ascii(w));
+    }
+  }
+  
+  std::sort(all_words.begin(), all_words.end());
+  all_words.erase(std::unique(all_words.begin(), all_words.end()), all_words.end());
+  
+  build();
+}
+
+void SpellDictionary::build(){
+  
+  // we stack (key, word id) pairs and sort them, as in MatchIndex
+  vector<std::pair<uint64_t, uint32_t>> all_pairs;
+  all_pairs.reserve(all_words.size() * (1 + PREFIX_SIZE));
+  
+  const uint32_t n = all_words.size();
+  for(uint32_t i = 0 ; i < n ; ++i){
+    for(const auto &key : unique_deletion_keys(all_words[i], k)){
+      all_pairs.push_back({key, i});
+    }
+  }
+  
+  std::sort(all_pairs.begin(), all_pairs.end());
+  
+  delete_keys.clear();
+  delete_start.clear();
+  delete_word_ids.resize(all_pairs.size());
+  for(size_t j = 0 ; j < all_pairs.size() ; ++j){
+    const uint64_t key = all_pairs[j].first;
+    if(j == 0 || key != delete_keys.back()){
+      delete_keys.push_back(key);
+      delete_start.push_back(j);
+    }
+    delete_word_ids[j] = all_pairs[j].second;
+  }
+  delete_start.push_back(all_pairs.size());
+}
+
+vector<uint32_t> SpellDictionary::lookup(const string &x, int max_edits) const {
+  
+  vector<uint32_t> res;
+  max_edits = std::min(max_edits, k);
+  if(x.empty() || max_edits <= 0){
+    return res;
+  }
+  
+  const string x_low = to_lower_ascii(x);
+  
+  for(const auto &key : unique_deletion_keys(x_low, max_edits)){
+    auto it = std::lower_bound(delete_keys.begin(), delete_keys.end(), key);
+    if(it == delete_keys.end() || *it != key){
+      continue;
+    }
+    
+    const size_t j = it - delete_keys.begin();
+    res.insert(res.end(), delete_word_ids.begin() + delete_start[j],
+               delete_word_ids.begin() + delete_start[j + 1]);
+  }
+  
+  std::sort(res.begin(), res.end());
+  res.erase(std::unique(res.begin(), res.end()), res.end());
+  
+  // the candidates are checked (prefix deletions + hash collisions)
+  vector<uint32_t> res_checked;
+  for(const auto &i : res){
+    if(osa_distance(x_low, all_words[i], max_edits) <= max_edits){
+      res_checked.push_back(i);
+    }
+  }
+  
+  return res_checked;
+}
+
+vector<vector<string>> SpellDictionary::to_lines() const {
+  /* Format:
+  * - 1st vector: the version and the maximum number of edits
+  * - 2nd vector: the words
+  * - 3rd vector: one line per deletion key: the key (hex) followed by the ids of the words
+  *
+  * */
+  
+  vector<vector<string>> res(3);
+  res[0] = {LINES_VERSION, std::to_string(k)};
+  res[1] = all_words;
+  
+  res[2].reserve(delete_keys.size());
+  char buffer[32];
+  for(size_t j = 0 ; j < delete_keys.size() ; ++j){
+    std::snprintf(buffer, sizeof(buffer), "%llx", static_cast<unsigned long long>(delete_keys[j]));
+    string line = buffer;
+    for(uint32_t p = delete_start[j] ; p < delete_start[j + 1] ; ++p){
+      line += ' ';
+      line += std::to_string(delete_word_ids[p]);
+    }
+    res[2].push_back(std::move(line));
+  }
+  
+  return res;
+}
+
+std::shared_ptr<const SpellDictionary> SpellDictionary::from_lines(const vector<vector<string>> &lines){
+  
+  if(lines.size() != 3 || lines[0].size() != 2 || lines[0][0] != LINES_VERSION){
+    return nullptr;
+  }
+  
+  std::shared_ptr<SpellDictionary> res(new SpellDictionary());
+  res->k = std::clamp(std::atoi(lines[0][1].c_str()), 1, 2);
+  res->all_words = lines[1];
+  
+  const uint32_t n_words = res->all_words.size();
+  for(const auto &line : lines[2]){
+    const char *p = line.c_str();
+    char *p_end = nullptr;
+    const uint64_t key = std::strtoull(p, &p_end, 16);
+    if(p_end == p){
+      return nullptr;
+    }
+    
+    res->delete_keys.push_back(key);
+    res->delete_start.push_back(res->delete_word_ids.size());
+    
+    p = p_end;
+    while(*p == ' '){
+      const unsigned long id = std::strtoul(p + 1, &p_end, 10);
+      if(p_end == p + 1 || id >= n_words){
+        return nullptr;
+      }
+      res->delete_word_ids.push_back(id);
+      p = p_end;
+    }
+  }
+  res->delete_start.push_back(res->delete_word_ids.size());
+  
+  if(!std::is_sorted(res->delete_keys.begin(), res->delete_keys.end())){
+    return nullptr;
+  }
+  
+  return res;
+}
+
+//
+// global dictionary -----------------------------------------------------------
+//
+
+void set_spell_dictionary(std::shared_ptr<const SpellDictionary> pdict){
+  spell_dictionary = pdict;
+}
+
+std::shared_ptr<const SpellDictionary> get_spell_dictionary(){
+  return spell_dictionary;
+}
+
+
+} // namespace stringtools
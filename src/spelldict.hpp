@@ -0,0 +1,86 @@
+    //=========================================================================//
+   //            Author: Laurent R. Bergé, University of Bordeaux             //
+  //             Copyright (C) 2025-present, Laurent R. Bergé                //
+ //              MIT License (see project_root/LICENSE)                     //
+//=========================================================================//
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+using std::string;
+using std::vector;
+
+namespace stringtools {
+
+// Implementation notes:
+// - SpellDictionary is a deletion dictionary (SymSpell): the words known are
+//   stored with all the strings obtained by deleting up to k of their letters
+// - a misspelled word x is corrected by generating the deletions of x and
+//   looking them up: if the distance between x and a word w is at most k, one
+//   deletion of x is also a deletion of w => the lookups are hash lookups,
+//   their number only depends on the length of x, not on the number of words
+// - only the first PREFIX_SIZE letters of the words are used for the deletions,
+//   to bound the memory, the candidates are then checked with the full distance
+//   (restricted Damerau-Levenshtein: insertion, deletion, substitution, transposition)
+// - the words are the tokens of R identifiers (see split_tokens), in lower case
+// - the dictionary can be saved to/restored from a vector of lines (to be cached)
+//
+
+class SpellDictionary {
+  int k = 1;
+  
+  // the words, in lower case and distinct
+  vector<string> all_words;
+  
+  // deletions: the hashes are sorted, the words with the deletion delete_keys[j]
+  // are delete_word_ids[delete_start[j]] to delete_word_ids[delete_start[j + 1] - 1]
+  vector<uint64_t> delete_keys;
+  vector<uint32_t> delete_start;
+  vector<uint32_t> delete_word_ids;
+  
+  SpellDictionary() = default;
+  
+  void build();
+
+public:
+  
+  static const uint32_t PREFIX_SIZE = 7;
+  
+  // words: any strings, they are lowered and made unique
+  // max_edits: the maximum number of edits that lookup will be able to correct (1 or 2)
+  SpellDictionary(const vector<string> &words, int max_edits);
+  
+  int max_edits() const { return k; }
+  size_t size() const { return all_words.size(); }
+  const string& word_at(size_t i) const { return all_words[i]; }
+  
+  // the words at a distance of at most max_edits from x, in increasing order
+  // max_edits is bounded by the one of the dictionary
+  vector<uint32_t> lookup(const string &x, int max_edits) const;
+  
+  // to save the dictionary, and restore it (nullptr if the lines are invalid)
+  vector<vector<string>> to_lines() const;
+  static std::shared_ptr<const SpellDictionary> from_lines(const vector<vector<string>> &lines);
+};
+
+// the tokens of x: maximal runs of letters and digits, in lower case
+// ex: "read.csv" => "read" "csv" ; "base::requireNamespace" => "base" "requirenamespace"
+vector<string> split_tokens(const string &x);
+
+// the tokens, of at least min_size letters, of a set of identifiers (distinct)
+vector<string> identifier_tokens(const vector<string> &all_x, const uint32_t min_size = 3);
+
+// restricted Damerau-Levenshtein distance, case insensitive
+// if the distance is greater than max_dist, any value greater than max_dist is returned
+int osa_distance(const string &x, const string &y, const int max_dist);
+
+// the dictionary used by the correction tier of string_match (none by default)
+void set_spell_dictionary(std::shared_ptr<const SpellDictionary> pdict);
+std::shared_ptr<const SpellDictionary> get_spell_dictionary();
+
+
+} // namespace stringtools
@@ -0,0 +1,123 @@
+    //=========================================================================//
+   //            Author: Laurent R. Bergé, University of Bordeaux             //
+  //             Copyright (C) 2025-present, Laurent R. Bergé                //
+ //              MIT License (see project_root/LICENSE)                     //
+//=========================================================================//
+
+#include "stringpool.hpp"
+
+#include <cstring>
+
+namespace stringtools {
+
+StringPool::StringPool(){
+  init();
+}
+
+void StringPool::init(){
+  all_views.reserve(1 << 14);
+  view_to_id.reserve(1 << 14);
+  
+  all_views.push_back(std::string_view());
+  view_to_id[std::string_view()] = 0;
+}
+
+StringPool::User StringPool::get_user(){
+  std::lock_guard<std::mutex> lock(user_mutex);
+  
+  User res = wuser.lock();
+  if(!res){
+    res = std::make_shared<const uint64_t>(generation);
+    wuser = res;
+  }
+  
+  return res;
+}
+
+bool StringPool::trim(size_t max_size){
+  
+  std::lock_guard<std::mutex> lock(user_mutex);
+  if(all_views.size() <= max_size || !wuser.expired()){
+    return false;
+  }
+  
+  // NOTA: swapping with empty containers releases their memory
+  vector<std::unique_ptr<char[]>>().swap(all_blocks);
+  vector<std::string_view>().swap(all_views);
+  std::unordered_map<std::string_view, uint32_t>().swap(view_to_id);
+  block_used = BLOCK_SIZE;
+  total_bytes = 0;
+  ++generation;
+  
+  init();
+  
+  return true;
+}
+
+std::string_view StringPool::store(std::string_view x){
+  // copies x in the blocks
+  
+  const size_t n = x.size();
+  total_bytes += n;
+  
+  if(n > BLOCK_SIZE / 4){
+    // own block, inserted before the current one so that the latter remains the last
+    std::unique_ptr<char[]> block(new char[n]);
+    std::memcpy(block.get(), x.data(), n);
+    std::string_view res(block.get(), n);
+    all_blocks.insert(all_blocks.end() - (all_blocks.empty() ? 0 : 1), std::move(block));
+    return res;
+  }
+  
+  if(block_used + n > BLOCK_SIZE){
+    all_blocks.emplace_back(new char[BLOCK_SIZE]);
+    block_used = 0;
+  }
+  
+  char *p = all_blocks.back().get() + block_used;
+  std::memcpy(p, x.data(), n);
+  block_used += n;
+  
+  return std::string_view(p, n);
+}
+
+uint32_t StringPool::intern(std::string_view x){
+  
+  auto it = view_to_id.find(x);
+  if(it != view_to_id.end()){
+    return it->second;
+  }
+  
+  // the key of the map is the stored view, not x
+  const std::string_view x_stored = store(x);
+  const uint32_t id = all_views.size();
+  all_views.push_back(x_stored);
+  view_to_id.emplace(x_stored, id);
+  
+  return id;
+}
+
+StringPool& get_string_pool(){
+  // NOTA: never destroyed, the views may be used until the very end
+  static StringPool *ppool = new StringPool();
+  return *ppool;
+}
+
+vector<uint32_t> intern_strings(const vector<string> &x){
+  StringPool &pool = get_string_pool();
+  
+  vector<uint32_t> res;
+  res.reserve(x.size());
+  for(const auto &s : x){
+    res.push_back(pool.intern(s));
+  }
+  
+  return res;
+}
+
+bool trim_string_pool(size_t max_size){
+  return get_string_pool().trim(max_size);
+}
+
+
+} // namespace stringtools
@@ -0,0 +1,109 @@
+    //=========================================================================//
+   //            Author: Laurent R. Bergé, University of Bordeaux             //
+  //             Copyright (C) 2025-present, Laurent R. Bergé                //
+ //              MIT License (see project_root/LICENSE)                     //
+//=========================================================================//
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <mutex>
+#include <cstdint>
+
+using std::string;
+using std::vector;
+
+namespace stringtools {
+
+// Implementation notes:
+// - the StringPool stores distinct strings, contiguously in large blocks, and
+//   gives each of them a 32 bit id => a set of autocomplete candidates is a
+//   vector of ids and the strings are read as string_views
+// - interning a string already in the pool does not allocate: the candidates
+//   are largely the same from TAB to TAB (functions, packages, arguments, files)
+// - the blocks are never reallocated => the string_views are valid as long as
+//   the pool lives
+// - the pool is shared by the whole program (see get_string_pool). It grows
+//   while in use and is cleared, at a safe point, when it is large and no
+//   object refers to it anymore (trim_string_pool):
+//   * the objects storing ids (MetaStringVec, MetaColumn) hold a User of the pool
+//   * clearing starts a new generation: ids (and views) of different
+//     generations are unrelated, the caches keyed on ids check the generation
+//   => one-shot candidates (eg the values of a large column in introspection)
+//      do not stay in memory for the whole session
+// - interning is not thread safe, reading is as long as no string is interned
+//   at the same time (string_match reads the pool from the worker threads while
+//   the main thread waits)
+//
+
+class StringPool {
+  // strings larger than a quarter of a block get their own block
+  static const size_t BLOCK_SIZE = 1 << 16;
+  
+  vector<std::unique_ptr<char[]>> all_blocks;
+  size_t block_used = BLOCK_SIZE;
+  size_t total_bytes = 0;
+  
+  // id => string
+  vector<std::string_view> all_views;
+  std::unordered_map<std::string_view, uint32_t> view_to_id;
+  
+  uint64_t generation = 0;
+  // the users of the current generation, see get_user
+  std::weak_ptr<const uint64_t> wuser;
+  std::mutex user_mutex;
+  
+  std::string_view store(std::string_view x);
+  void init();
+
+public:
+  // held by the objects storing ids: the pool is not cleared while one is alive
+  using User = std::shared_ptr<const uint64_t>;
+  
+  StringPool(const StringPool&) = delete;
+  StringPool& operator=(const StringPool&) = delete;
+  
+  // the id 0 is the empty string
+  StringPool();
+  
+  uint32_t intern(std::string_view x);
+  
+  std::string_view view(uint32_t id) const { return all_views[id]; }
+  
+  // number of distinct strings and their total size
+  size_t size() const { return all_views.size(); }
+  size_t n_bytes() const { return total_bytes; }
+  
+  // thread safe
+  User get_user();
+  bool has_users() const { return !wuser.expired(); }
+  uint64_t get_generation() const { return generation; }
+  
+  // clears the pool if it has more than max_size strings and no user
+  // NOTA: only at a safe point of the main thread (no id nor view in flight)
+  bool trim(size_t max_size);
+};
+
+// the pool shared by the whole program, created on first use
+StringPool& get_string_pool();
+
+inline uint32_t intern_string(std::string_view x){
+  return get_string_pool().intern(x);
+}
+
+inline std::string_view string_from_id(uint32_t id){
+  return get_string_pool().view(id);
+}
+
+vector<uint32_t> intern_strings(const vector<string> &x);
+
+// the pool is kept below 100,000 strings by default (the usual candidates:
+// functions, packages, arguments, etc, are far fewer)
+bool trim_string_pool(size_t max_size = 100000);
+
+
+} // namespace stringtools
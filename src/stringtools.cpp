@@ -5,12 +5,27 @@
 //=========================================================================//
 
 #include "stringtools.hpp"
+#include "matchindex.hpp"
+#include "simd.hpp"
+#include "misspell.hpp"
+#include "spelldict.hpp"
+#include "workerpool.hpp"
+
+#include <algorithm>
+#include <chrono>
 
 namespace stringtools {
 
 string valid_word_char = "._";
+CharClassTable char_class_table = CHAR_CLASS_TABLE_DEFAULT;
+
 void set_valid_word_char(string x){
+  if(x == valid_word_char){
+    return;
+  }
+  
   valid_word_char = x;
+  char_class_table = make_char_class_table(valid_word_char);
 }
 
 using namespace utf8;
@@ -25,29 +40,80 @@ void display_charvalue(string str, bool newline){
   std::cout << std::endl;
 }
 
+uint string_utf8::checkpoint_before(uint wide_i) const {
+  // the position of the last checkpoint at or before wide_i
+  auto it = std::upper_bound(checkpoint_wide.begin(), checkpoint_wide.end(), wide_i);
+  return (it - checkpoint_wide.begin()) - 1;
+}
+
+void string_utf8::build_checkpoints(){
+  checkpoint_wide.assign(1, 0);
+  checkpoint_narrow.assign(1, 0);
+  refine_checkpoints(0);
+}
+
+void string_utf8::refine_checkpoints(uint k){
+  // we add checkpoints between the k-th and the next one (or the end of the line)
+  // if they are too far apart
+  
+  const bool is_last = k + 1 == checkpoint_wide.size();
+  const uint wide_end = is_last ? wide_line_size : checkpoint_wide[k + 1];
+  if(wide_end - checkpoint_wide[k] <= 2 * CHECKPOINT_STEP){
+    return;
+  }
+  
+  vector<uint> new_wide, new_narrow;
+  uint wide_i = checkpoint_wide[k];
+  uint narrow_i = checkpoint_narrow[k];
+  while(wide_end - wide_i > CHECKPOINT_STEP){
+    for(uint j = 0 ; j < CHECKPOINT_STEP ; ++j){
+      ++narrow_i;
+      while(narrow_i < line.size() && is_continuation(line[narrow_i])){
+        ++narrow_i;
+      }
+    }
+    wide_i += CHECKPOINT_STEP;
+    
+    new_wide.push_back(wide_i);
+    new_narrow.push_back(narrow_i);
+  }
+  
+  checkpoint_wide.insert(checkpoint_wide.begin() + k + 1, new_wide.begin(), new_wide.end());
+  checkpoint_narrow.insert(checkpoint_narrow.begin() + k + 1, new_narrow.begin(), new_narrow.end());
+}
+
 void string_utf8::insert(uint wide_at, string str){
   // we can insert full strings and not just strings of size 1 wide char
   
-  uint narrow_n = str.size();
-  uint wide_n = count_wide_chars(str);
+  const uint narrow_n = str.size();
+  const uint wide_n = count_wide_chars(str);
   
-  if(is_wide || narrow_n > wide_n){
+  if(is_wide){
+    const uint narrow_at = wide_to_narrow_index(wide_at);
+    paren_idx.invalidate_from(narrow_at);
+    line.insert(narrow_at, str);
+    wide_line_size += wide_n;
     
-    uint narrow_at = wide_at;
-    if(!is_wide){
-      is_wide = true;
-    } else {
-      narrow_at = wide_to_narrow_index(wide_at);
+    // the checkpoints after wide_at are shifted, the one before is still valid
+    const uint k = checkpoint_before(wide_at);
+    for(uint j = k + 1 ; j < checkpoint_wide.size() ; ++j){
+      checkpoint_wide[j] += wide_n;
+      checkpoint_narrow[j] += narrow_n;
     }
     
-    line.insert(narrow_at, str);
+    refine_checkpoints(k);
     
   } else {
     // here wide and narrow representations are equivalent
+    paren_idx.invalidate_from(wide_at);
     line.insert(wide_at, str);
+    wide_line_size += wide_n;
+    
+    if(narrow_n > wide_n){
+      is_wide = true;
+      build_checkpoints();
+    }
   }
-  
-  wide_line_size += wide_n;
 }
 
 void string_utf8::push_back(string str){
@@ -60,14 +126,46 @@ void string_utf8::push_back(char c){
 
 void string_utf8::erase(uint wide_i, uint wide_n){
   if(is_wide){
-    uint narrow_i = wide_to_narrow_index(wide_i);
-    uint narrow_n = wide_to_narrow_count_at(narrow_i, wide_n);
+    if(wide_i >= wide_line_size){
+      return;
+    }
+    wide_n = std::min(wide_n, wide_line_size - wide_i);
+    
+    const uint narrow_i = wide_to_narrow_index(wide_i);
+    const uint narrow_n = wide_to_narrow_count_at(wide_i, narrow_i, wide_n);
     
+    paren_idx.invalidate_from(narrow_i);
     line.erase(narrow_i, narrow_n);
     wide_line_size -= wide_n;
     
+    if(line.size() == wide_line_size){
+      // back to ASCII
+      is_wide = false;
+      checkpoint_wide.clear();
+      checkpoint_narrow.clear();
+      return;
+    }
+    
+    // the checkpoints within the erased part are dropped, the next ones are shifted
+    const uint k = checkpoint_before(wide_i);
+    uint j_end = k + 1;
+    while(j_end < checkpoint_wide.size() && checkpoint_wide[j_end] <= wide_i + wide_n){
+      ++j_end;
+    }
+    checkpoint_wide.erase(checkpoint_wide.begin() + k + 1, checkpoint_wide.begin() + j_end);
+    checkpoint_narrow.erase(checkpoint_narrow.begin() + k + 1, checkpoint_narrow.begin() + j_end);
+    
+    for(uint j = k + 1 ; j < checkpoint_wide.size() ; ++j){
+      checkpoint_wide[j] -= wide_n;
+      checkpoint_narrow[j] -= narrow_n;
+    }
+    
+    // the gap may have been merged with the next one
+    refine_checkpoints(k);
+    
   } else {
     // narrow = wide
+    paren_idx.invalidate_from(wide_i);
     line.erase(wide_i, wide_n);
     wide_line_size = line.size();
   }
@@ -83,7 +181,7 @@ string string_utf8::substr(uint wide_pos, uint wide_n) const {
   
   if(is_wide){
     const uint narrow_pos = wide_to_narrow_index(wide_pos);
-    uint narrow_n = wide_to_narrow_count_at(narrow_pos, wide_n);
+    uint narrow_n = wide_to_narrow_count_at(wide_pos, narrow_pos, wide_n);
     
     res = line.substr(narrow_pos, narrow_n);
   } else {
@@ -107,27 +205,35 @@ vector<string_utf8> string_utf8::split(uint wide_i) const {
   return res;
 }
 
-inline uint string_utf8::wide_to_narrow_count_at(uint narrow_i, uint wide_n) const {
+inline uint string_utf8::wide_to_narrow_count_at(uint wide_i, uint narrow_i, uint wide_n) const {
+  // number of bytes of the wide_n characters starting at wide_i
   // narrow_i: the conversion to narrow must have been performed beforehand
   
-  if(is_wide){
-    uint narrow_n = 0;
-    uint n_done = 0;
-    while(n_done < wide_n){
-      ++n_done;
-      ++narrow_n;
-      while(narrow_i + narrow_n < line.size() && is_continuation(line[narrow_i + narrow_n])){
-        ++narrow_n;
-      }
-    }
-    
-    return narrow_n;
-    
-  } else {
+  if(!is_wide){
     // narrow = wide
     return wide_n;
   }
   
+  if(wide_n >= wide_line_size - wide_i){
+    return line.size() - narrow_i;
+  }
+  
+  if(wide_n > CHECKPOINT_STEP){
+    // we use the checkpoints
+    return wide_to_narrow_index(wide_i + wide_n) - narrow_i;
+  }
+  
+  uint narrow_n = 0;
+  uint n_done = 0;
+  while(n_done < wide_n){
+    ++n_done;
+    ++narrow_n;
+    while(narrow_i + narrow_n < line.size() && is_continuation(line[narrow_i + narrow_n])){
+      ++narrow_n;
+    }
+  }
+  
+  return narrow_n;
 }
 
 uint string_utf8::wide_to_narrow_index(uint wide_index) const{
@@ -138,26 +244,17 @@ uint string_utf8::wide_to_narrow_index(uint wide_index) const{
     return wide_index;
   }
   
-  if(wide_index == wide_line_size){
+  if(wide_index >= wide_line_size){
     return line.size();
   }
   
-  if(wide_index == 0){
-    return 0;
-  }
-  
-  // wide, not a special case
-  
-  uint narrow_index = 0;
-  for(uint wide_i = 0 ; wide_i < wide_index ; ++wide_i){
+  // we start from the closest checkpoint
+  const uint k = checkpoint_before(wide_index);
+  uint narrow_index = checkpoint_narrow[k];
+  for(uint wide_i = checkpoint_wide[k] ; wide_i < wide_index ; ++wide_i){
     // at each loop iteration, we go to the next starting byte
-    //
-    // start of this loop: we're at the starting byte of a character
-    narrow_index++;
-    // if we end up at starting byte: good
-    // else: we go to the next starting byte
     // we cannot reach the end of the string w/t it being a strating byte bc this case is handled before
-    
+    narrow_index++;
     while(!is_starting_byte(line[narrow_index])){
       narrow_index ++;
     }
@@ -174,23 +271,19 @@ uint string_utf8::narrow_to_wide_index(uint narrow_index) const{
     return narrow_index;
   }
   
-  if(narrow_index == line.size()){
+  if(narrow_index >= line.size()){
     return wide_line_size;
   }
   
-  if(wide_line_size == 0){
-    return 0;
-  }
-  
-  // wide, not a special case
+  // we start from the closest checkpoint and count the starting bytes
+  auto it = std::upper_bound(checkpoint_narrow.begin(), checkpoint_narrow.end(), narrow_index);
+  const uint k = (it - checkpoint_narrow.begin()) - 1;
   
-  uint wide_index = 0;
-  uint narrow_i = 0;
-  while(wide_index <= wide_line_size && narrow_i < narrow_index){
-    ++wide_index;
-    // NOTA: we always move narrow_i to the ending byte of the *next* utf8 char
-    // so that ++narrow_i is always the starting byte of a new char
-    move_i_to_end_of_next_utf8_char(line, narrow_i);
+  uint wide_index = checkpoint_wide[k];
+  for(uint narrow_i = checkpoint_narrow[k] ; narrow_i < narrow_index ; ++narrow_i){
+    if(is_starting_byte(line[narrow_i])){
+      ++wide_index;
+    }
   }
 
   return wide_index;
@@ -247,7 +340,7 @@ string string_utf8::at(uint wide_i) const {
   uint narrow_i = wide_to_narrow_index(wide_i);
   res += line[narrow_i];
   while(narrow_i + 1 < line.size() && is_continuation(line[narrow_i + 1])){
-    res += line[narrow_i + 1];
+    res += line[++narrow_i];
   }
   
   return res;
@@ -259,6 +352,7 @@ string string_utf8::at(uint wide_i) const {
 //
 
 // these functions rely on windows.h
+#ifdef _WIN32
 
 
 
@@ -327,6 +421,7 @@ wstring utf8_to_utf16(char utf8_char, bool &is_error){
 wstring utf8_to_utf16(string &str, bool &is_error){
   return utf8_to_utf16_internal(str.data(), str.size(), is_error);
 }
+#endif
 
 
 string_utf8 trim_WS(const string_utf8 &x){
@@ -344,147 +439,19 @@ string_utf8 trim_WS(const string_utf8 &x){
 //
 
 inline bool is_same_letter(const char c1, const char c2){
-  if(c1 == c2){
-    return true;
-    
-  } else if(c1 > c2){
-    if(c1 - c2 == 32){
-      return c1 >= 'a' && c1 <= 'z';
-    }
-    
-  } else {
-    if(c2 - c1 == 32){
-      return c2 >= 'a' && c2 <= 'z';
-    }
-  }
-  
-  return false;
+  return simd::fold_ascii(c1) == simd::fold_ascii(c2);
 }
 
-inline bool startmatch_misspell(const string x, const string y, const uint index_y = 0){
-  /*
-  *  Algorithm:
-  * 
-  * - deletion:  x = 'bon' y = 'bnjour'  => true
-  * 
-  * - insertion: x = 'bn'  y = 'bonjour' => true
-  * 
-  * - swap:      x = 'bon' y = 'bnojour' => true
-  *              x = 'bno' y = 'bonjour' => true
-  * 
-  * */
-  
-  const uint nx = x.size();
-  const uint ny = y.size();
-  
-  if(y.size() + 1 < x.size() + index_y){
-    return false;
-  }
-  
-  uint i = 0;
-  while(i < nx && i + index_y < ny && is_same_letter(x[i], y[index_y + i])){
-    ++i;
-  }
-  
-  if(i == nx || i + index_y == ny){
-    // we went all the way => fine
-    // note that the second condition corresponds to a deletion
-    return true;
-  }
-  
-  // i represents the index of the first unmatch
-  
-  //
-  // step 1: deletion 
-  //
-  
-  // x = 'bonjour' y = 'bojour_les_gens
-  //        |             |
-  // i = 2
-  
-  int i_save = i;
-  if(i + 1 < nx && is_same_letter(x[i + 1], y[index_y + i])){
-    ++i;
-    while(i + 1 < nx && i + index_y < ny && is_same_letter(x[i + 1], y[index_y + i])){
-      ++i;
-    }
-    
-    if(i + 1 == nx){
-      // this is the only way to match
-      return true;
-    }
-    
-    // we continue
-    i = i_save;
-  }
-  
-  //
-  // step 2: inclusion 
-  //
-  
-  // x = 'bojour' y = 'bonjour_les_gens
-  //        |            |
-  // i = 2
-  
-  
-  if(index_y + i + 1 < ny && is_same_letter(x[i], y[index_y + i + 1])){
-    ++i;
-    while(i + 1 < nx && i + index_y < ny && is_same_letter(x[i], y[index_y + i + 1])){
-      ++i;
-    }
-    
-    if(i + 1 == nx){
-      // this is the only way to match
-      return true;
-    }
-    
-    // we continue
-    i = i_save;
-  }
-  
-  //
-  // step 3: swap 
-  //
-  
-  // x = 'bnojour' y = 'bonjour_les_gens
-  //       |             |
-  // i = 1
-  
-  if(i + 1 < nx && index_y + i + 1 < ny && is_same_letter(x[i], y[index_y + i + 1]) && is_same_letter(x[i + 1], y[index_y + i])){
-    i += 2;
-    while(i + 1 < nx && i + index_y < ny && is_same_letter(x[i], y[index_y + i])){
-      ++i;
-    }
-    
-    if(i + 1 == nx){
-      // this is the only way to match
-      return true;
-    }
-  }
-  
-  return false;
-}
-
-inline bool inclusion_misspell(const string x, const string y, uint &index){
-  
-  const uint nx = x.size();
-  const uint ny = y.size();
-  
-  if(nx > ny + 1 || nx == 0){
-    return false;
-  }
-  
-  // we always match the first letter
-  for(uint j=0 ; j<=(ny - nx + 1) ; ++j){
-    if(is_same_letter(x[0], y[j])){
-      if(startmatch_misspell(x, y, j)){
-        index = j;
-        return true;
-      }
+inline uint span_size_wide(std::string_view y, const uint start, const uint end){
+  // the number of wide characters in y[start, end)
+  uint res = 0;
+  for(uint i = start ; i < end ; ++i){
+    // we skip the continuation bytes
+    if((static_cast<unsigned char>(y[i]) & 0xC0) != 0x80){
+      ++res;
     }
   }
-  
-  return false;
+  return res;
 }
 
 inline bool any_uppercase(string x){
@@ -496,7 +463,7 @@ inline bool any_uppercase(string x){
   return false;
 }
 
-inline bool startmatch(const string x, const string y, const bool strict_case, const uint index_y = 0){
+inline bool startmatch(const string &x, std::string_view y, const bool strict_case, const uint index_y = 0){
   // we look at whether x is included in y, starting from index_y
   // ex: x = 'bon', y = 'bonjour' => true
   // ex: x = 'bon', y = 'bonjour', index_y = 1 => false (x = 'on' => true)
@@ -506,22 +473,10 @@ inline bool startmatch(const string x, const string y, const bool strict_case, c
     return false;
   }
   
-  for(uint i=0 ; i<x.size() ; ++i){
-    if(strict_case){
-      if(x[i] != y[i + index_y]){
-        return false;
-      }
-    } else {
-      if(!is_same_letter(x[i], y[i + index_y])){
-        return false;
-      }
-    }
-  }
-  
-  return true;
+  return simd::starts_with(x, y.substr(index_y), strict_case);
 }
 
-inline bool inclusion_simple(const string x, const string y, const bool strict_case, uint &index){
+inline bool inclusion_simple(const string &x, std::string_view y, const bool strict_case, uint &index){
   // we check if x is included in y
   // ex: 'heur' in 'rosa bonheur'
   
@@ -529,20 +484,134 @@ inline bool inclusion_simple(const string x, const string y, const bool strict_c
     return false;
   }
   
-  const uint nx = x.size();
-  const uint ny = y.size();
+  const size_t pos = simd::find(x, y, strict_case);
+  if(pos == std::string_view::npos){
+    return false;
+  }
   
-  for(uint j=0 ; j<=(ny - nx) ; ++j){
-    if(startmatch(x, y, strict_case, j)){
-      index = j;
-      return true;
+  index = pos;
+  return true;
+}
+
+// the choices to check at a given step:
+// - either all of them (no index)
+// - either the candidates given by the MatchIndex (increasing order)
+class MatchCandidates {
+  bool is_all = true;
+  uint n_all = 0;
+  vector<uint32_t> all_ids;
+  
+public:
+  MatchCandidates(uint n): n_all(n) {}
+  MatchCandidates(vector<uint32_t> &&ids): is_all(false), all_ids(std::move(ids)) {}
+  
+  uint size() const { return is_all ? n_all : all_ids.size(); }
+  uint operator[](uint k) const { return is_all ? k : all_ids[k]; }
+};
+
+// string_match is run in parallel when a tier has at least this number of candidates
+uint string_match_parallel_min_size = 50000;
+void set_string_match_parallel_min_size(uint n){
+  string_match_parallel_min_size = n;
+}
+
+StringMatchTierTimes *ptier_times = nullptr;
+void set_string_match_tier_times(StringMatchTierTimes *ptimes){
+  ptier_times = ptimes;
+}
+
+// the matches of string_match, tier after tier
+// NOTA: the tiers are scanned from the strongest to the weakest and, within a 
+// tier, in the order of the choices => the matches are accumulated in their 
+// final order and the first K matches are the top K, no sorting is needed
+class MatchAccumulator {
+  MatchInfoVec all_match_info;
+  vector<uint> all_id;
+  vector<MATCH_TIER> all_tier;
+  vector<bool> is_done;
+  
+  void add(const uint i, const MatchInfo &info, const MATCH_TIER tier){
+    all_match_info.push_back(info);
+    all_id.push_back(i);
+    all_tier.push_back(tier);
+    is_done[i] = true;
+  }
+  
+public:
+  MatchAccumulator(uint n): is_done(n, false) {}
+  
+  // check(i, info): true if the choice i matches, info is then the match information
+  // the matches are added in the order of the candidates
+  template<typename CHECK>
+  void add_tier(const MatchCandidates &cand, const MATCH_TIER tier, CHECK check){
+    if(!ptier_times){
+      add_tier_internal(cand, tier, check);
+      return;
     }
+    
+    const auto t_start = std::chrono::steady_clock::now();
+    add_tier_internal(cand, tier, check);
+    const auto t_end = std::chrono::steady_clock::now();
+    
+    const int k = static_cast<int>(tier);
+    ptier_times->all_ns[k].push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(t_end - t_start).count());
+    ptier_times->all_n_candidates[k].push_back(cand.size());
   }
   
-  return false;
-}
+  template<typename CHECK>
+  void add_tier_internal(const MatchCandidates &cand, const MATCH_TIER tier, CHECK check){
+    const uint n_cand = cand.size();
+    
+    if(n_cand < string_match_parallel_min_size || get_worker_pool().size() <= 1){
+      MatchInfo info;
+      for(uint k=0 ; k<n_cand ; ++k){
+        const uint i = cand[k];
+        if(!is_done[i] && check(i, info)){
+          add(i, info, tier);
+        }
+      }
+      return;
+    }
+    
+    // the candidates are split in contiguous chunks, the results of the chunks
+    // are merged in order => the results are identical to the sequential ones
+    // NOTA: is_done is only read while the workers run
+    
+    WorkerPool &pool = get_worker_pool();
+    const uint n_chunks = 4 * pool.size();
+    vector<vector<uint>> all_chunk_id(n_chunks);
+    vector<MatchInfoVec> all_chunk_info(n_chunks);
+    
+    pool.run(n_chunks, [&](uint32_t c){
+      const uint k_start = static_cast<uint64_t>(n_cand) * c / n_chunks;
+      const uint k_end = static_cast<uint64_t>(n_cand) * (c + 1) / n_chunks;
+      MatchInfo info;
+      for(uint k=k_start ; k<k_end ; ++k){
+        const uint i = cand[k];
+        if(!is_done[i] && check(i, info)){
+          all_chunk_id[c].push_back(i);
+          all_chunk_info[c].push_back(info);
+        }
+      }
+    });
+    
+    for(uint c=0 ; c<n_chunks ; ++c){
+      for(const auto &i : all_chunk_id[c]){
+        all_id.push_back(i);
+        all_tier.push_back(tier);
+        is_done[i] = true;
+      }
+      all_match_info.append(all_chunk_info[c]);
+    }
+  }
+  
+  StringMatch to_string_match(const string &query, MetaStringVec &choices, const string &msg){
+    // the matches are not copied, the result is a view on the choices
+    return StringMatch(query, choices, std::move(all_match_info), std::move(all_id), std::move(all_tier), msg);
+  }
+};
 
-StringMatch string_match(const string &query, MetaStringVec choices){
+StringMatch string_match(const string &query, MetaStringVec choices, const StringMatch &previous){
   
   /***************************************************************************** 
   * The algorithm is as follows
@@ -554,13 +623,19 @@ StringMatch string_match(const string &query, MetaStringVec choices){
   * 1b) startmatch without case
   * if x is 2+ letters:
   *   2) inclusion
-  * if x is 4+ letters:
-  *   3) inclusion with misspells
+  * if x is 3+ letters:
+  *   3a) if x is a single word and a spell dictionary is set: a token of the 
+  *       choice is a correction of x (see SpellDictionary)
+  *   3b) inclusion with misspells (see MisspellMatcher)
   * 
   * If x is a sequence of words, then we also match as follows:
   * 4) all words are included 
   * 5) all words are included with misspells
   * 
+  * Narrowing: when the query extends the query of `previous` (computed on the
+  * same choices), the matches of the tiers 1, 2 and 4 are necessarily among 
+  * the previous matches. Only the misspell tiers (3 and 5) need to look at all
+  * the choices.
   *
   *****************************************************************************/
   
@@ -577,14 +652,27 @@ StringMatch string_match(const string &query, MetaStringVec choices){
   }
   
   const uint nx_wide = utf8::count_wide_chars(x);
-  ptr_vec_str pchoices_str = choices.get_string_vec_ptr();
-  vec_str &choices_str = *pchoices_str;
   
-  vector<MatchInfo> all_match_info;
-  vector<uint> all_id;
-  vector<bool> is_done(n_choices, false);
+  // the choices are read from the string pool, no string is copied
+  const vec_id &choices_id = choices.get_ids();
+  const StringPool &pool = get_string_pool();
+  auto choices_str = [&](uint i){ return pool.view(choices_id[i]); };
+  
+  MatchAccumulator acc(n_choices);
   
-  uint index = 0;
+  // the index is only built for large sets of choices (nullptr otherwise)
+  std::shared_ptr<const MatchIndex> pindex = MatchIndex::get(choices_id);
+  const bool use_index = static_cast<bool>(pindex);
+  
+  // the previous query must be of 2+ letters so that its inclusions were computed
+  const string x_previous = trim_WS(previous.get_target());
+  const bool is_narrowing = x_previous.size() >= 2 && starts_with(x, x_previous);
+  vector<uint32_t> previous_ids;
+  if(is_narrowing){
+    const vector<uint> &all_id_previous = previous.get_all_id();
+    previous_ids.assign(all_id_previous.begin(), all_id_previous.end());
+    std::sort(previous_ids.begin(), previous_ids.end());
+  }
   
   string msg = n_choices == 1 ? "the only choice does not match" : ("no match found among " + std::to_string(n_choices) + " choices");
   
@@ -592,72 +680,136 @@ StringMatch string_match(const string &query, MetaStringVec choices){
   // step 1: startmatch 
   //
   
-  #define ADD_MATCH(the_match)           \
-    all_match_info.push_back(the_match); \
-    all_id.push_back(i);                 \
-    is_done[i] = true;
-  
   const bool any_upper = any_uppercase(x);
   
+  MatchCandidates cand_start(n_choices);
+  if(is_narrowing){
+    cand_start = MatchCandidates(vector<uint32_t>(previous_ids));
+  } else if(use_index){
+    const uint32_t *first = nullptr, *last = nullptr;
+    pindex->first_letter_bucket(x[0], first, last);
+    cand_start = MatchCandidates(vector<uint32_t>(first, last));
+  }
+  
   if(any_upper){
-    for(uint i=0 ; i<n_choices ; ++i){
-      if(startmatch(x, choices_str[i], true)){
-        ADD_MATCH(MatchInfo(0, nx_wide))
-      }
-    }
-    
-    for(uint i=0 ; i<n_choices ; ++i){
-      if(!is_done[i] && startmatch(x, choices_str[i], false)){
-        ADD_MATCH(MatchInfo(0, nx_wide))
-      }
-    }
-  } else {
-    for(uint i=0 ; i<n_choices ; ++i){
-      if(startmatch(x, choices_str[i], false)){
-        ADD_MATCH(MatchInfo(0, nx_wide))
-      }
-    }
+    acc.add_tier(cand_start, MATCH_TIER::START_CASE, [&](uint i, MatchInfo &info){
+      info.set(0, nx_wide);
+      return startmatch(x, choices_str(i), true);
+    });
   }
   
+  acc.add_tier(cand_start, MATCH_TIER::START, [&](uint i, MatchInfo &info){
+    info.set(0, nx_wide);
+    return startmatch(x, choices_str(i), false);
+  });
+  
   if(n < 2){
-    choices.select(all_id);
-    return StringMatch(query, choices, all_match_info, all_id, msg);
+    return acc.to_string_match(query, choices, msg);
   }
   
   //
   // step 2: inclusion 
   //
   
+  MatchCandidates cand_incl(n_choices);
+  if(is_narrowing){
+    cand_incl = MatchCandidates(vector<uint32_t>(previous_ids));
+  } else if(use_index){
+    cand_incl = MatchCandidates(pindex->inclusion_candidates(x));
+  }
+  
   if(any_upper){
-    for(uint i=0 ; i<n_choices ; ++i){
-      if(!is_done[i] && inclusion_simple(x, choices_str[i], true, index)){
-        ADD_MATCH(MatchInfo(index, nx_wide))
+    acc.add_tier(cand_incl, MATCH_TIER::INCLUSION_CASE, [&](uint i, MatchInfo &info){
+      uint index = 0;
+      if(inclusion_simple(x, choices_str(i), true, index)){
+        info.set(index, nx_wide);
+        return true;
       }
+      return false;
+    });
+  }
+  
+  acc.add_tier(cand_incl, MATCH_TIER::INCLUSION, [&](uint i, MatchInfo &info){
+    uint index = 0;
+    if(inclusion_simple(x, choices_str(i), false, index)){
+      info.set(index, nx_wide);
+      return true;
     }
+    return false;
+  });
+  
+  //
+  // step 3a: corrections 
+  //
+  
+  const int max_edits = get_misspell_max_edits();
+  std::shared_ptr<const SpellDictionary> pdict = get_spell_dictionary();
+  
+  const bool is_single_token = std::all_of(x.begin(), x.end(), [](const char c){ return is_token_char(c); });
+  if(n >= 3 && max_edits > 0 && pdict && is_single_token){
+    // the number of edits is the same as for the misspells
+    const int max_edits_x = MisspellMatcher(x, max_edits).max_edits();
     
-    for(uint i=0 ; i<n_choices ; ++i){
-      if(!is_done[i] && inclusion_simple(x, choices_str[i], false, index)){
-        ADD_MATCH(MatchInfo(index, nx_wide))
-      }
+    vector<string> all_corrections;
+    for(const auto &id : pdict->lookup(x, max_edits_x)){
+      all_corrections.push_back(pdict->word_at(id));
     }
-  } else {
-    for(uint i=0 ; i<n_choices ; ++i){
-      if(!is_done[i] && inclusion_simple(x, choices_str[i], false, index)){
-        ADD_MATCH(MatchInfo(index, nx_wide))
+    
+    if(!all_corrections.empty()){
+      MatchCandidates cand_correction(n_choices);
+      if(use_index){
+        cand_correction = MatchCandidates(pindex->token_candidates(all_corrections));
       }
+      
+      acc.add_tier(cand_correction, MATCH_TIER::CORRECTION, [&](uint i, MatchInfo &info){
+        // we look for the first token of the choice which is a correction
+        const std::string_view y = choices_str(i);
+        const uint ny = y.size();
+        uint j = 0;
+        while(j < ny){
+          if(!is_token_char(y[j])){
+            ++j;
+            continue;
+          }
+          
+          const uint j_start = j;
+          while(j < ny && is_token_char(y[j])){
+            ++j;
+          }
+          
+          const uint token_size = j - j_start;
+          for(const auto &corr : all_corrections){
+            if(corr.size() == token_size && simd::equal(corr.data(), y.data() + j_start, token_size, false)){
+              info.set(j_start, span_size_wide(y, j_start, j));
+              return true;
+            }
+          }
+        }
+        return false;
+      });
     }
   }
   
   //
-  // step 3: inclusion + misspells 
+  // step 3b: inclusion + misspells 
   //
   
-  if(n >= 4){
-    for(uint i=0 ; i<n_choices ; ++i){
-      if(!is_done[i] && inclusion_misspell(x, choices_str[i], index)){
-        ADD_MATCH(MatchInfo(index, nx_wide))
-      }
+  if(n >= 3 && max_edits > 0){
+    const MisspellMatcher matcher(x, max_edits);
+    
+    MatchCandidates cand_misspell(n_choices);
+    if(use_index){
+      cand_misspell = MatchCandidates(pindex->misspell_candidates(x, matcher.max_edits()));
     }
+    
+    acc.add_tier(cand_misspell, MATCH_TIER::MISSPELL, [&](uint i, MatchInfo &info){
+      uint32_t span_start = 0, span_end = 0;
+      if(matcher.match(choices_str(i), span_start, span_end)){
+        info.set(span_start, span_size_wide(choices_str(i), span_start, span_end));
+        return true;
+      }
+      return false;
+    });
   }
   
   //
@@ -672,8 +824,7 @@ StringMatch string_match(const string &query, MetaStringVec choices){
   
   // if no space, we return
   if(i == n){
-    choices.select(all_id);
-    return StringMatch(query, choices, all_match_info, all_id, msg);
+    return acc.to_string_match(query, choices, msg);
   }
   
   vector<string> all_words;
@@ -703,68 +854,142 @@ StringMatch string_match(const string &query, MetaStringVec choices){
   }
   
   // inclusion without misspell
-  for(uint i=0 ; i<n_choices ; ++i){
-    if(is_done[i]){
-      continue;
+  MatchCandidates cand_words(n_choices);
+  if(is_narrowing){
+    cand_words = MatchCandidates(std::move(previous_ids));
+  } else if(use_index){
+    // the postings of the tokens containing each word are intersected
+    vector<uint32_t> all_ids = pindex->word_candidates(all_words[0]);
+    for(uint idx=1 ; idx<n_words && !all_ids.empty() ; ++idx){
+      all_ids = intersect_sorted(all_ids, pindex->word_candidates(all_words[idx]));
     }
-    
-    bool ok = true;
-    MatchInfo current_match;
+    cand_words = MatchCandidates(std::move(all_ids));
+  }
+  
+  acc.add_tier(cand_words, MATCH_TIER::WORDS, [&](uint i, MatchInfo &info){
+    info.clear();
+    uint index = 0;
     for(uint idx=0 ; idx<n_words ; ++idx){
-      if(inclusion_simple(all_words[idx], choices_str[i], false, index)){
-        current_match.add(index, word_sizes[idx]);
+      if(inclusion_simple(all_words[idx], choices_str(i), false, index)){
+        info.add(index, word_sizes[idx]);
       } else {
-        ok = false;
-        break;
+        return false;
       }
     }
-    
-    if(ok){
-      ADD_MATCH(current_match)
-    }
-  }
+    return true;
+  });
   
   // inclusion with misspell
-  if(any_large_word){
-    for(uint i=0 ; i<n_choices ; ++i){
-      if(is_done[i]){
-        continue;
+  if(any_large_word && max_edits > 0){
+    // the matchers are only used for the large words
+    vector<MisspellMatcher> all_matchers;
+    all_matchers.reserve(n_words);
+    for(uint idx=0 ; idx<n_words ; ++idx){
+      all_matchers.emplace_back(all_words[idx], max_edits);
+    }
+    
+    MatchCandidates cand_words_misspell(n_choices);
+    if(use_index){
+      vector<uint32_t> all_ids;
+      for(uint idx=0 ; idx<n_words ; ++idx){
+        vector<uint32_t> word_ids = is_largeq_than_4(word_sizes[idx]) ? 
+                                      pindex->misspell_candidates(all_words[idx], all_matchers[idx].max_edits()) :
+                                      pindex->word_candidates(all_words[idx]);
+        all_ids = idx == 0 ? std::move(word_ids) : intersect_sorted(all_ids, word_ids);
+        if(all_ids.empty()){
+          break;
+        }
       }
-      
-      bool ok = true;
-      MatchInfo current_match;
+      cand_words_misspell = MatchCandidates(std::move(all_ids));
+    }
+    
+    acc.add_tier(cand_words_misspell, MATCH_TIER::WORDS_MISSPELL, [&](uint i, MatchInfo &info){
+      info.clear();
+      uint index = 0;
+      uint32_t span_start = 0, span_end = 0;
       for(uint idx=0 ; idx<n_words ; ++idx){
         if(is_largeq_than_4(word_sizes[idx])){
           // misspell
-          if(inclusion_misspell(all_words[idx], choices_str[i], index)){
-            current_match.add(index, word_sizes[idx]);
+          if(all_matchers[idx].match(choices_str(i), span_start, span_end)){
+            info.add(span_start, span_size_wide(choices_str(i), span_start, span_end));
           } else {
-            ok = false;
-            break;
+            return false;
           } 
         } else {
           // no misspell
-          if(inclusion_simple(all_words[idx], choices_str[i], false, index)){
-            current_match.add(index, word_sizes[idx]);
+          if(inclusion_simple(all_words[idx], choices_str(i), false, index)){
+            info.add(index, word_sizes[idx]);
           } else {
-            ok = false;
-            break;
+            return false;
           }
         }
       }
-      
-      if(ok){
-        ADD_MATCH(current_match)
+      return true;
+    });
+  }
+  
+  return acc.to_string_match(query, choices, msg);
+  
+}
+
+StringMatch StringMatchStack::match(const string &query, MetaStringVec choices){
+  
+  //
+  // step 1: the choices must be the same as in the stack 
+  //
+  
+  if(choices.get_ids() != choices_id){
+    all_matches.clear();
+    choices_id = choices.get_ids();
+  }
+  
+  //
+  // step 2: we drop the matches that the query does not extend 
+  //
+  
+  const string x = trim_WS(query);
+  while(!all_matches.empty()){
+    const StringMatch &last = all_matches.back();
+    if(last.get_target() == query){
+      // backspace or identical query
+      // NOTA: the ids are the same but not necessarily the meta information
+      // (labels, finalize, etc) => the match is bound to the current choices
+      if(last.is_view_on_choices()){
+        StringMatch res = last;
+        return res.rebind_choices(choices);
       }
+      
+      return string_match(query, choices);
     }
+    
+    if(starts_with(x, trim_WS(last.get_target()))){
+      break;
+    }
+    
+    all_matches.pop_back();
   }
   
-  choices.select(all_id);
-  return StringMatch(query, choices, all_match_info, all_id, msg);
+  //
+  // step 3: narrowing 
+  //
+  
+  StringMatch res = all_matches.empty() ? string_match(query, choices) : string_match(query, choices, all_matches.back());
+  all_matches.push_back(res);
   
+  return res;
+}
+
+ParenMatcher::ParenMatcher(const string &line, uint cursor){
+  ParenIndex index;
+  index.update(line);
+  init(line, index, cursor);
+}
+
+ParenMatcher::ParenMatcher(const string_utf8 &line, uint cursor){
+  init(line.str(), line.paren_index(), line.wide_to_narrow_index(cursor));
 }
 
-ParenMatcher::ParenMatcher(string line, uint cursor){
+void ParenMatcher::init(const string &line, const ParenIndex &index, uint cursor){
   const uint &n = line.size();
   
   if(n < 5){
@@ -777,77 +1002,50 @@ ParenMatcher::ParenMatcher(string line, uint cursor){
   
   // priority to the right
   
+  uint i_paren = UNSET::UINT;
   if(cursor < n && is_paren(line[cursor])){
-    if(is_closing_paren(line[cursor])){
-      i_end = cursor;
-    } else {
-      i_start = cursor;
-    }
+    i_paren = cursor;
   } else if(cursor > 0 && is_paren(line[cursor - 1])){
-    if(is_closing_paren(line[cursor - 1])){
-      i_end = cursor - 1;
-    } else {
-      i_start = cursor - 1;
-    }
+    i_paren = cursor - 1;
   } else {
     return;
   }
   
+  if(is_closing_paren(line[i_paren])){
+    i_end = i_paren;
+  } else {
+    i_start = i_paren;
+  }
+  
   //
-  // step 2: we find the match
+  // step 2: we find the match 
   //
   
-  const bool we_seek_a_closing_paren = i_end == UNSET::UINT;
-  
-  const char open_paren = we_seek_a_closing_paren ? line[i_start] : pair_quote_paren_char(line[i_end]);
-  const char closing_paren = pair_quote_paren_char(open_paren);
-  vector<uint> open_stack;
+  // NOTA: the parens within quotes have no match
+  const uint i_match = index.matching_paren(i_paren);
+  if(i_match == UNSET::UINT){
+    return;
+  }
   
-  uint i = 0;
-  while(i < n){
-    const char c = line[i];
-    
-    if(is_quote(c)){
-      const char quote = c;
-      ++i;
-      
-      while( i < n && !( line[i] == quote && !is_escaped(line, i) ) ){
-        ++i;
-      }
-      
-    } else if(c == open_paren){
-      open_stack.push_back(i);
-      
-    } else if(c == closing_paren){
-      if(!open_stack.empty()){
-        uint index_open = open_stack.back();
-        
-        if(we_seek_a_closing_paren){
-          if(index_open == i_start){
-            i_end = i;
-            pair_found = true;
-            return;
-          }
-        } else {
-          if(i == i_end){
-            i_start = index_open;
-            pair_found = true;
-            return;
-          }
-        }
-        
-        open_stack.pop_back();
-      }
-    }
-    
-    ++i;
+  if(i_end == UNSET::UINT){
+    i_end = i_match;
+  } else {
+    i_start = i_match;
   }
   
+  pair_found = true;
 }
 
 
 vector<uint> contextual_selection(const string &x, const uint cursor_left, 
                                   const uint cursor_right, const bool has_moved){
+  ParenIndex index;
+  index.update(x);
+  return contextual_selection(x, index, cursor_left, cursor_right, has_moved);
+}
+
+vector<uint> contextual_selection(const string &x, const ParenIndex &index, const uint cursor_left, 
+                                  const uint cursor_right, const bool has_moved){
   /* Algorithm
   * 
   * objective: to select a wider selection than the current one
@@ -856,6 +1054,11 @@ vector<uint> contextual_selection(const string &x, const uint cursor_left,
   * 
   * if we cannot find a selection => select all
   * 
+  * the containers are read from the paren index of x:
+  * - the cursor is within a quote: the container is the quote
+  * - else: the container is the innermost paren opened before the cursor
+  *   and its pair is the closing element
+  * 
   * RETURN: vector of length 2 correpsonding to starting/end of cursor positions
   * 
   * */
@@ -867,122 +1070,44 @@ vector<uint> contextual_selection(const string &x, const uint cursor_left,
     return vector<uint>{0, n};
   }
   
-  vector<char> all_containers;
-  vector<char> all_positions;
-  uint i = 0;
-  while(i < cursor_left){
-    const char c = x[i];
-    
-    if(is_quote(c)){
-      uint i_bak = i;
-      const char quote = c;
-      
-      ++i;
-      while( i < cursor_left && !( x[i] == quote && !is_escaped(x, i) ) ){
-        ++i;
-      }
-      
-      if(i >= cursor_left){
-        // we save the quote and quit the loop
-        all_containers.push_back(quote);
-        all_positions.push_back(i_bak + 1);
-        break;
-      }
-      
-    } else if(is_opening_paren(c)){
-      all_containers.push_back(c);
-      all_positions.push_back(i + 1);
-      
-    } else if(is_closing_paren(c)){
-      if(all_containers.empty()){
-        // multi line or syntax error, we ignore
-        
-      } else if(c == pair_quote_paren_char(all_containers.back())){
-        all_containers.pop_back();
-        all_positions.pop_back();
-        
-      } else {
-        // multi line or syntax error, we ignore
-      }
-    }
-    
-    ++i;
-  }
-  
-  if(all_containers.empty()){
-    // no containers => select all
-    return vector<uint>{0, n};
-  }
-  
-  bool in_quote = is_quote(all_containers.back());
-  uint i_left = all_positions.back();
-  const char container_left = all_containers.back();
-  all_containers.clear();
-  
   //
   // branch 1: quote 
   //
   
   // quote is the easy case
-  if(in_quote){
-    const char &quote = container_left;
-    while(i < n && !( x[i] == quote && !is_escaped(x, i) )){
-      ++i;
-    }
+  uint quote_start = 0, quote_end = 0;
+  if(index.quote_containing(cursor_left, quote_start, quote_end)){
+    const uint i_left = quote_start + 1;
     
-    if(i < cursor_right){
+    if(quote_end < cursor_right){
       // the quote ended before the cursor => select all
       return vector<uint>{0, n};
     }
     
     // the !has_moved should be useless here since a quote cannot
     // contain anything by definition
-    if(!has_moved && i_left == cursor_left && i == cursor_right){
-      return contextual_selection(x, cursor_left - 1, cursor_right + 1, true);
+    if(!has_moved && i_left == cursor_left && quote_end == cursor_right){
+      return contextual_selection(x, index, cursor_left - 1, cursor_right + 1, true);
     }
     
-    return vector<uint>{i_left, i};
+    return vector<uint>{i_left, quote_end};
   }
   
   //
   // branch 2 : paren
   //
   
+  const uint i_open = index.enclosing_paren(cursor_left);
+  if(i_open == UNSET::UINT){
+    // no containers => select all
+    return vector<uint>{0, n};
+  }
   
-  // we find the index of the closing element
-  uint i_right = 0;
-  while(i < n){
-    const char c = x[i];
-    if(is_quote(c)){
-      const char &quote = c;
-      ++i;
-      while( i < n && !( x[i] == quote && !is_escaped(x, i) ) ){
-        ++i;
-      }
+  const uint i_left = i_open + 1;
       
-    } else if(is_opening_paren(c)){
-      all_containers.push_back(c);
-      
-    } else if(is_closing_paren(c)){
-      
-      if(all_containers.empty()){
-        if(c == pair_quote_paren_char(container_left)){
-          // we're done!
-          i_right = i;
-          break;
-          
-        } else {
-          // multi line or syntax error, we ignore
-        }
-      } else if(c == pair_quote_paren_char(all_containers.back())){
-        all_containers.pop_back();
-      } else {
-        // multi line or syntax error, we ignore
-      }
-    }
-    
-    ++i;
-  }
+  // the index of the closing element
+  const uint i_close = index.closing_paren(i_open);
+  const uint i_right = i_close == UNSET::UINT ? 0 : i_close;
   
   if(i_right < cursor_right){
     // right cursor is past the closing paren
@@ -990,7 +1115,7 @@ vector<uint> contextual_selection(const string &x, const uint cursor_left,
   }
   
   if(!has_moved && i_left == cursor_left && i_right == cursor_right){
-    return contextual_selection(x, cursor_left - 1, cursor_right + 1, true);
+    return contextual_selection(x, index, cursor_left - 1, cursor_right + 1, true);
   }
   
   return vector<uint>{i_left, i_right};
@@ -1007,7 +1132,7 @@ vector<uint> contextual_selection(const string_utf8 &x, const uint cursor_left,
   const uint narrow_cleft = x.wide_to_narrow_index(cursor_left);
   const uint narrow_cright = x.wide_to_narrow_index(cursor_right);
   
-  vector<uint> res = contextual_selection(str, narrow_cleft, narrow_cright);
+  vector<uint> res = contextual_selection(str, x.paren_index(), narrow_cleft, narrow_cright);
   
   // and we rewiden
   const uint i_left = x.narrow_to_wide_index(res[0]);
@@ -1336,53 +1461,53 @@ uint64_t hash_string_vector(const vector<string> &x){
 }
 
 
-vector<string> str_split_at_width(const string &x, const int width){
+vector<std::string_view> str_split_at_width(std::string_view x, const int width){
+  // NOTA: the runs of plain ASCII are consumed in bulk
   
-  vector<string> res;
+  vector<std::string_view> res;
   if(x.empty()){
     return res;
   }
   
-  int i = 0;
-  const int n = x.size();
+  size_t i = 0;
+  const size_t n = x.size();
   
   while(i < n){
     
-    string line;
+    size_t start = i;
     int w = 0;
     while(w < width && i < n){
-      const char &c = x[i];
+      const uchar c = x[i];
       if(c == 27){
         // VTS
-        line += x[i++];
-        while(i < n && !is_ascii_letter(x[i])){
-          line += x[i++];
-        }
-        
-        if(i < n){
-          line += x[i++];
-        }
+        const size_t vts_start = i;
+        i = skip_VTS(x, i);
         
         if(w == 0 && res.size() > 0){
           // special case: string ends with a VTS
-          res.back() += line;
-          line.clear();
+          // the previous line ends right before the VTS
+          res.back() = std::string_view(res.back().data(), res.back().size() + i - vts_start);
+          start = i;
         }
         
-      } else if(utf8::is_starting_byte(c)){
-        ++w;
-        line += x[i++];
-        while(i < n && utf8::is_continuation(x[i])){
-          line += x[i++];
-        }
+      } else if(c < 128){
+        const size_t n_ascii = std::min<size_t>(simd::plain_ascii_prefix(x.data() + i, n - i), width - w);
+        i += n_ascii;
+        w += n_ascii;
+        
       } else {
         ++w;
-        line += x[i++];
+        ++i;
+        if(utf8::is_starting_byte(c)){
+          while(i < n && utf8::is_continuation(x[i])){
+            ++i;
+          }
+        }
       }
     }
     
-    if(!line.empty()){
-      res.push_back(line);
+    if(i > start){
+      res.push_back(x.substr(start, i - start));
     }
     
   }
@@ -8,13 +8,23 @@
 
 #include "metastringvec.hpp"
 #include "constants.hpp"
+#include "simd.hpp"
+#include "parenindex.hpp"
 
 #include <cmath>
 #include <string>
 #include <iostream>
 #include <vector>
+#include <cstdint>
+#include <array>
+#include <string_view>
+#include <cstring>
+#include <algorithm>
 // for utf8/utf16 conversions
+// NOTA: the matching engine is also built headlessly on Linux (see bench_string_match)
+#ifdef _WIN32
 #include <windows.h>
+#endif
 // NOTA: we never want TRUE/FALSE to be defined because it messes up with R
 #ifdef TRUE
   #undef TRUE
@@ -37,18 +47,22 @@ using std::vector;
 
 namespace stringtools {
 
+// the punctuation characters that are part of words (default: "._")
 extern string valid_word_char;
+void set_valid_word_char(string x);
 
 //
 // utf8 ------------------------------------------------------------------------ 
 //
 
 
+#ifdef _WIN32
 wstring utf8_to_utf16(char p_utf8, bool& is_error);
 wstring utf8_to_utf16(string& str, bool& is_error);
 
 string utf16_to_utf8(wchar_t p_utf16, bool& is_error);
 string utf16_to_utf8(wstring& str, bool& is_error);
+#endif
 
 namespace utf8 {
 
@@ -94,15 +108,8 @@ inline void move_i_to_end_of_next_utf8_char(const string &str, uint &i){
   
 }
 
-inline uint count_wide_chars(string str){
-  uint n = 0;
-  for(const char &c : str){
-    if(is_starting_byte(c)){
-      ++n;
-    }
-  }
-  
-  return n;
+inline uint count_wide_chars(std::string_view str){
+  return simd::count_utf8_chars(str.data(), str.size());
 }
 
 } // namespace utf8
@@ -111,7 +118,7 @@ inline uint count_wide_chars(string str){
 // inline ----------------------------------------------------------------------
 //
 
-inline bool is_escaped(const string line, uint index){
+inline bool is_escaped(const string &line, uint index){
   // i is the position of the character being escaped
   // ie: hello \" folks
   //            ^ i would be here and we would return true
@@ -137,60 +144,139 @@ inline bool is_enter(const char c){
   return c == '\r' || c == '\n';
 }
 
-inline bool is_control_char(const uchar c){
+//
+// character classes -----------------------------------------------------------
+//
+
+// Implementation notes:
+// - the class of each byte is stored in a 256 entries table of bit flags
+//   => the predicates below are one load and one mask
+// - the control characters are the ASCII punctuation and the space, minus the
+//   characters of valid_word_char, which are part of words
+// - the bytes of multibyte characters are word characters
+// - the table only depends on valid_word_char: it is built at compile time for
+//   the default value and rebuilt by set_valid_word_char
+//
+
+namespace CHAR_CLASS {
+  const uchar WORD          = 1;
+  const uchar STARTING_WORD = 2;
+  const uchar QUOTE         = 4;
+  const uchar OPENING_PAREN = 8;
+  const uchar CLOSING_PAREN = 16;
+  const uchar WS            = 32;
+};
+
+using CharClassTable = std::array<uchar, 256>;
+
+constexpr CharClassTable make_char_class_table(std::string_view valid_chars){
+  CharClassTable res{};
   
-  if( (c >= 32 && c <= 47) || (c >= 58 && c <= 64) || (c >= 91 && c <= 96) || (c >= 123 && c <= 126) ){
-    for(auto &valid_control_char : valid_word_char){
-      if(c == valid_control_char){
-        return false;
+  for(uint i = 0 ; i < 256 ; ++i){
+    const uchar c = i;
+    
+    bool is_control = (c >= 32 && c <= 47) || (c >= 58 && c <= 64) || (c >= 91 && c <= 96) || (c >= 123 && c <= 126);
+    for(const char &v : valid_chars){
+      if(c == static_cast<uchar>(v)){
+        is_control = false;
       }
     }
     
-    return true;
+    uchar flags = 0;
+    if(!is_control){
+      flags |= CHAR_CLASS::WORD;
+      if(!(c >= '0' && c <= '9')){
+        flags |= CHAR_CLASS::STARTING_WORD;
+      }
+    }
+    
+    if(c == '"' || c == '\'' || c == '`'){
+      flags |= CHAR_CLASS::QUOTE;
+    } else if(c == '(' || c == '[' || c == '{'){
+      flags |= CHAR_CLASS::OPENING_PAREN;
+    } else if(c == ')' || c == ']' || c == '}'){
+      flags |= CHAR_CLASS::CLOSING_PAREN;
+    } else if(c == ' ' || c == '\t' || c == '\r' || c == '\n'){
+      flags |= CHAR_CLASS::WS;
+    }
+    
+    res[i] = flags;
   }
   
-  return false;
+  return res;
+}
+
+// the table for the default valid_word_char
+constexpr CharClassTable CHAR_CLASS_TABLE_DEFAULT = make_char_class_table("._");
+static_assert(!(CHAR_CLASS_TABLE_DEFAULT['('] & CHAR_CLASS::WORD) && (CHAR_CLASS_TABLE_DEFAULT['.'] & CHAR_CLASS::WORD),
+              "the character class table must be built at compile time");
+
+// the table in use, see set_valid_word_char
+extern CharClassTable char_class_table;
+
+inline bool has_char_class(const uchar c, const uchar flags){
+  return char_class_table[c] & flags;
+}
+
+inline bool is_control_char(const uchar c){
+  return !has_char_class(c, CHAR_CLASS::WORD);
 }
 
 inline bool is_word_char(const uchar c){
-  return !is_control_char(c);
+  return has_char_class(c, CHAR_CLASS::WORD);
 }
 
 inline bool is_starting_word_char(const uchar c){  
-  return !is_digit(c) && !is_control_char(c);
+  return has_char_class(c, CHAR_CLASS::STARTING_WORD);
 }
 
 inline bool is_largeq_than_4(int x){
   return x >= 4;
 }
 
-inline string clean_VTS_markup(string x){
+// position right after the VTS starting at i (x[i] == 27)
+inline size_t skip_VTS(std::string_view x, size_t i){
+  const size_t n = x.size();
+  ++i;
+  while(i < n && !is_ascii_letter(x[i])){
+    ++i;
+  }
+  
+  return i < n ? i + 1 : n;
+}
+
+// position of the next VTS from i, or x.size()
+inline size_t find_VTS(std::string_view x, const size_t i){
+  if(i >= x.size()){
+    return x.size();
+  }
+  
+  const void *pesc = std::memchr(x.data() + i, 27, x.size() - i);
+  return pesc ? static_cast<const char*>(pesc) - x.data() : x.size();
+}
+
+inline string clean_VTS_markup(std::string_view x){
+  // the text between the VTS is copied in bulk
   string res;
-  uint n = x.size();
-  uint i = 0;
+  res.reserve(x.size());
+  
+  const size_t n = x.size();
+  size_t i = 0;
   while(i < n){
-    const char &c = x[i];
-    if(c == 27){
-      ++i;
-      while(i < n && !is_ascii_letter(x[i])){
-        ++i;
-      }
-      ++i;
-    } else {
-      res.push_back(c);
-      ++i;
-    }
+    const size_t i_vts = find_VTS(x, i);
+    res.append(x.data() + i, i_vts - i);
+    i = i_vts < n ? skip_VTS(x, i_vts) : n;
   }
   
   return res;
 }
 
 inline bool is_quote(const uchar c){
-  return c == '"' || c == '\'' || c == '`';
+  return has_char_class(c, CHAR_CLASS::QUOTE);
 }
 
 inline bool is_nonquote_control(const uchar c){
-  return is_control_char(c) && !is_quote(c);
+  return (char_class_table[c] & (CHAR_CLASS::WORD | CHAR_CLASS::QUOTE)) == 0;
 }
 
 inline bool is_nonspace_control(const uchar c){
@@ -198,7 +284,7 @@ inline bool is_nonspace_control(const uchar c){
 }
 
 inline bool is_WS(const uchar c){
-  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+  return has_char_class(c, CHAR_CLASS::WS);
 }
 
 inline bool is_int_inside(const string &x){
@@ -253,19 +339,19 @@ inline string to_upper(const string &x){
 }
 
 inline bool is_quote_paren_open(const uchar c){
-  return is_quote(c) || c == '(' || c == '[' || c == '{';
+  return has_char_class(c, CHAR_CLASS::QUOTE | CHAR_CLASS::OPENING_PAREN);
 }
 
 inline bool is_opening_paren(const uchar c){
-  return c == '(' || c == '[' || c == '{';
+  return has_char_class(c, CHAR_CLASS::OPENING_PAREN);
 }
 
 inline bool is_closing_paren(const uchar c){
-  return c == ')' || c == ']' || c == '}';
+  return has_char_class(c, CHAR_CLASS::CLOSING_PAREN);
 }
 
 inline bool is_paren(const uchar c){
-  return c == '(' || c == '[' || c == '{' || c == ')' || c == ']' || c == '}';
+  return has_char_class(c, CHAR_CLASS::OPENING_PAREN | CHAR_CLASS::CLOSING_PAREN);
 }
 
 inline bool is_paren_adjacent(string str, uint cursor_pos){
@@ -400,34 +486,33 @@ inline char pair_quote_paren_char(const uchar c){
   return '0';
 }
 
-inline bool any_open_paren_before(const string &x, const char target, int i = -100){
-  // we start at i inclusive -- paren means ([{ -- we assume the code is well formatted
+inline bool any_open_paren_before(const string &x, const ParenIndex &index, const char target, int i = -100){
+  // we start at i inclusive -- paren means ([{ -- the parens within quotes are ignored
   // target can be either an open or a closed paren
-  
-  const uint n = x.size();
+  // index: the paren index of x, up to date
+  // NOTA: nested pairing => a closing paren of the wrong type is ignored:
+  //       "f(a]" has an open '(' before its end
   
   if(i == -100){
-    i = n - 1;
+    i = static_cast<int>(x.size()) - 1;
   }
   
-  int n_open = 0;
-  for(; i >= 0 ; --i){
-    if(is_closing_paren(x[i])){
-      --n_open;
-    } else if(is_opening_paren(x[i])){
-      if(n_open >= 0){
-        if(x[i] == target || x[i] == pair_quote_paren_char(target)){
-          return true;
-        } else {
-          return false;
-        }
-      } else {
-        ++n_open;
-      }
-    }
+  if(i < 0){
+    return false;
   }
   
-  return false;
+  const uint i_open = index.enclosing_paren(i + 1);
+  if(i_open == UNSET::UINT){
+    return false;
+  }
+  
+  return x[i_open] == target || x[i_open] == pair_quote_paren_char(target);
+}
+
+inline bool any_open_paren_before(const string &x, const char target, int i = -100){
+  ParenIndex index;
+  index.update(x);
+  return any_open_paren_before(x, index, target, i);
 }
 
 
@@ -472,29 +557,20 @@ string shorten(const string &x, const uint nmax, const string ellipsis = "\u2026
 vector<string> shorten(const vector<string> &all_x, const uint nmax, const string ellipsis = "\u2026");
 void shorten_inplace(vector<string> &all_x, const uint nmax, const string ellipsis = "\u2026");
 
-inline bool is_open_paren_left(string line, uint index, const uchar closing_paren){
+inline bool is_open_paren_left(const ParenIndex &paren_index, uint index, const uchar closing_paren){
   // NOTA: in this function index == n is valid
-  // it finds if there is an open paren left
+  // it finds if there is an open paren left, of the same type as closing_paren
   // there is no check as to whether the variable closing_paren is valid
+  // paren_index: the paren index of the line, up to date
   
-  int i = static_cast<int>(index) - 1;
-  const uchar open_paren = pair_quote_paren(closing_paren)[0];
-  int n_open = 0;
-  
-  while(i >= 0){
-    if(line[i] == open_paren){
-      ++n_open;
-      if(n_open > 0){
-        return true;
-      }
-    } else if(line[i] == closing_paren){
-      --n_open;
-    }
-    
-    --i;
-  }
+  const char open_paren = pair_quote_paren(closing_paren)[0];
+  return paren_index.enclosing_paren(index, open_paren) != UNSET::UINT;
+}
   
-  return false;
+inline bool is_open_paren_left(const string &line, uint index, const uchar closing_paren){
+  ParenIndex paren_index;
+  paren_index.update(line);
+  return is_open_paren_left(paren_index, index, closing_paren);
 }
 
 inline bool is_letter_adjacent(string line, uint cursor){
@@ -639,9 +715,9 @@ inline uint word_jump(const string &line, const uint index, const int side){
 inline uint word_jump_default(const string &line, const uint index, const int side){
   // this is a bit ugly... but at least I don't have to refactor everything
   const string valid_bak = valid_word_char;
-  valid_word_char = "_";
+  set_valid_word_char("_");
   uint res = word_jump(line, index, side);
-  valid_word_char = valid_bak;
+  set_valid_word_char(valid_bak);
   return res;
 }
 
@@ -773,9 +849,9 @@ inline uint word_delete(const string &line, const uint index, const int side,
 inline uint word_delete_default(const string &line, const uint index, const int side){
   // this is a bit ugly... but at least I don't have to refactor everything
   const string valid_bak = valid_word_char;
-  valid_word_char = "_";
+  set_valid_word_char("_");
   uint res = word_delete(line, index, side);
-  valid_word_char = valid_bak;
+  set_valid_word_char(valid_bak);
   return res;
 }
 
@@ -814,23 +890,15 @@ inline void print_string_vector(vector<string> x){
   std::cout << "}\n";
 }
 
-inline size_t size_no_vts(const string &x){
+inline size_t size_no_vts(std::string_view x){
+  // the characters of the text between the VTS are counted in bulk
   size_t clean_size = 0;
   const size_t n = x.size();
-  uint i = 0;
+  size_t i = 0;
   while(i < n){
-    
-    if(x[i] == 27){
-      ++i;
-      while(i < n && !is_ascii_letter(x[i])){
-        ++i;
-      }
-      ++i;
-    } else {
-      ++clean_size;
-      utf8::move_i_to_start_of_next_utf8_char(x, i);
-    }
-    
+    const size_t i_vts = find_VTS(x, i);
+    clean_size += utf8::count_wide_chars(x.substr(i, i_vts - i));
+    i = i_vts < n ? skip_VTS(x, i_vts) : n;
   }
   
   return clean_size;
@@ -839,8 +907,9 @@ inline size_t size_no_vts(const string &x){
 inline uint max_size(const vector<string> &all_x){
   uint res = 0;
   for(const auto &x : all_x){
-    if(res < size_no_vts(x)){
-      res = size_no_vts(x);
+    const uint s = size_no_vts(x);
+    if(res < s){
+      res = s;
     }
   }
   return res;
@@ -1425,7 +1494,8 @@ inline vector<string> str_split(const string &x, const char *pvalue){
   return str_split(x, string{pvalue});
 }
 
-vector<string> str_split_at_width(const string &x, const int width);
+// the lines are views on x: x must outlive them
+vector<std::string_view> str_split_at_width(std::string_view x, const int width);
 
 inline void right_fill_with_space_inplace(string &x, const int n, const bool ignore_vts = true){
   
@@ -1682,10 +1752,15 @@ inline string fit_screen(const vector<string> &all_values, int width = 80){
   return res;
 }
 
-inline uint go_to_next_inner_paren(const string &x, int i, bool left){
+inline uint go_to_next_inner_paren(const string &x, const ParenIndex &index, int i, bool left){
   // i corresponds to a cursor position
+  // index: the paren index of x, up to date => the parens within quotes are skipped
   
   const int n = x.size();
+  const vector<uint> &all_paren_pos = index.paren_positions();
+  auto is_paren_at = [&all_paren_pos](const int j){
+    return std::binary_search(all_paren_pos.begin(), all_paren_pos.end(), static_cast<uint>(j));
+  };
   
   if(left){
     
@@ -1694,23 +1769,25 @@ inline uint go_to_next_inner_paren(const string &x, int i, bool left){
     
     // starting point: skipping adjacent
     --i;
-    while(i >= 0 && is_paren(x[i])){
+    while(i >= 0 && is_paren_at(i)){
       --i;
     }
     
-    while(i >= 0 && !is_paren(x[i])){
-      --i;
+    if(i >= 0){
+      auto it = std::upper_bound(all_paren_pos.begin(), all_paren_pos.end(), static_cast<uint>(i));
+      i = it == all_paren_pos.begin() ? -1 : static_cast<int>(*(it - 1));
     }
     
   } else {
     
     // starting point: skipping adjacent
-    while(i < n && is_paren(x[i])){
+    while(i < n && is_paren_at(i)){
       ++i;
     }
     
-    while(i < n && !is_paren(x[i])){
-      ++i;
+    if(i < n){
+      auto it = std::lower_bound(all_paren_pos.begin(), all_paren_pos.end(), static_cast<uint>(i));
+      i = it == all_paren_pos.end() ? n : static_cast<int>(*it);
     }
   }
   
@@ -1718,7 +1795,7 @@ inline uint go_to_next_inner_paren(const string &x, int i, bool left){
   // return
   //
   
-  if(i >= 0 && i < n && is_paren(x[i])){
+  if(i >= 0 && i < n && is_paren_at(i)){
     
     // right
     //    |hello(you()) ; how(are)
@@ -1740,23 +1817,51 @@ inline uint go_to_next_inner_paren(const string &x, int i, bool left){
   
 }
 
+inline uint go_to_next_inner_paren(const string &x, int i, bool left){
+  ParenIndex index;
+  index.update(x);
+  return go_to_next_inner_paren(x, index, i, left);
+}
+
 //
 // non-inline ------------------------------------------------------------------ 
 //
 
 vector<uint> contextual_selection(const string &, const uint, const uint, const bool has_moved = false);
-void set_valid_word_char(string x);
+vector<uint> contextual_selection(const string &, const ParenIndex &, const uint, const uint, const bool has_moved = false);
 
 //
 // string_utf8 -----------------------------------------------------------------
 //
 
+// NOTA:
+// - when the line is all ASCII (is_wide = false), wide and narrow indexes are 
+//   identical: there is no translation at all
+// - otherwise, a sparse table of checkpoints gives the byte offset of a wide
+//   index every CHECKPOINT_STEP characters or so => the translations only scan 
+//   from the closest checkpoint, whatever the length of the line
+// - the checkpoints are updated on edit: the ones after the edit are shifted,
+//   only the part of the line around the edit is rescanned (when needed)
+//
 class string_utf8 {
   string line;
   bool is_wide = false;
   uint wide_line_size = 0;
   
-  uint wide_to_narrow_count_at(uint, uint) const;
+  // the wide index checkpoint_wide[k] starts at the byte checkpoint_narrow[k]
+  // the first checkpoint is always (0, 0), only set when is_wide
+  vector<uint> checkpoint_wide;
+  vector<uint> checkpoint_narrow;
+  
+  static const uint CHECKPOINT_STEP = 64;
+  
+  // the structure of the line: quotes and parens, see paren_index()
+  mutable ParenIndex paren_idx;
+  
+  uint wide_to_narrow_count_at(uint, uint, uint) const;
+  uint checkpoint_before(uint wide_i) const;
+  void build_checkpoints();
+  void refine_checkpoints(uint k);
   
 public:
   
@@ -1774,6 +1879,9 @@ public:
     line.clear();
     is_wide = false;
     wide_line_size = 0;
+    checkpoint_wide.clear();
+    checkpoint_narrow.clear();
+    paren_idx.invalidate_from(0);
   }
   
   void insert(uint, string);
@@ -1788,17 +1896,17 @@ public:
   
   uint word_jump_default(uint index_wide, int side) const{
     const string valid_bak = valid_word_char;
-    valid_word_char = "_";
+    set_valid_word_char("_");
     uint res = word_jump(index_wide, side);
-    valid_word_char = valid_bak;
+    set_valid_word_char(valid_bak);
     return res;
   }
   
   uint word_delete_default(uint index_wide, int side) const {
     const string valid_bak = valid_word_char;
-    valid_word_char = "_";
+    set_valid_word_char("_");
     uint res = word_delete(index_wide, side, true);
-    valid_word_char = valid_bak;
+    set_valid_word_char(valid_bak);
     
     return res;
   }
@@ -1813,6 +1921,12 @@ public:
   uint narrow_to_wide_index(uint) const;
   uint wide_to_narrow_index(uint) const;
   
+  // updated since the last edit, the positions are narrow
+  const ParenIndex& paren_index() const {
+    paren_idx.update(line);
+    return paren_idx;
+  }
+  
 };
 
 string_utf8 trim_WS(const string_utf8 &x);
@@ -1831,6 +1945,8 @@ class MatchInfo {
   vector<uint> start;
   vector<uint> end;
   int n = 0;
+  
+  friend class MatchInfoVec;
 public:
   
   MatchInfo() = default;
@@ -1843,6 +1959,20 @@ public:
     end.push_back(len);
   }
   
+  // NOTA: clear and set reuse the memory => no allocation when checking many choices
+  void clear(){
+    start.clear();
+    end.clear();
+    n = 0;
+  }
+  
+  void set(uint index, uint len){
+    clear();
+    start.push_back(index);
+    end.push_back(index + len);
+    n = 1;
+  }
+  
   void add(uint new_start, uint len){
     // we always order and merge if appropriate
     uint new_end = new_start + len;
@@ -2059,15 +2189,92 @@ public:
   }
 };
 
+// the match information of many matches, stored contiguously
+// => avoids one allocation per match when almost all the choices match
+class MatchInfoVec {
+  vector<uint> all_start;
+  vector<uint> all_end;
+  vector<uint> all_offset = {0};
+
+public:
+  MatchInfoVec() = default;
+  
+  uint size() const { return all_offset.size() - 1; }
+  
+  void push_back(const MatchInfo &x){
+    all_start.insert(all_start.end(), x.start.begin(), x.start.begin() + x.n);
+    all_end.insert(all_end.end(), x.end.begin(), x.end.begin() + x.n);
+    all_offset.push_back(all_start.size());
+  }
+  
+  void append(const MatchInfoVec &x){
+    const uint shift = all_start.size();
+    all_start.insert(all_start.end(), x.all_start.begin(), x.all_start.end());
+    all_end.insert(all_end.end(), x.all_end.begin(), x.all_end.end());
+    for(uint i = 1 ; i < x.all_offset.size() ; ++i){
+      all_offset.push_back(x.all_offset[i] + shift);
+    }
+  }
+  
+  MatchInfo at(uint i) const {
+    MatchInfo res;
+    if(i >= size()){
+      return res;
+    }
+    
+    res.start.assign(all_start.begin() + all_offset[i], all_start.begin() + all_offset[i + 1]);
+    res.end.assign(all_end.begin() + all_offset[i], all_end.begin() + all_offset[i + 1]);
+    res.n = res.start.size();
+    return res;
+  }
+  
+  // the match info of the elements sel
+  MatchInfoVec subset(const vector<uint> &sel) const {
+    MatchInfoVec res;
+    res.all_offset.reserve(sel.size() + 1);
+    for(const auto &i : sel){
+      if(i >= size()){
+        continue;
+      }
+      
+      res.all_start.insert(res.all_start.end(), all_start.begin() + all_offset[i], 
+                           all_start.begin() + all_offset[i + 1]);
+      res.all_end.insert(res.all_end.end(), all_end.begin() + all_offset[i], 
+                         all_end.begin() + all_offset[i + 1]);
+      res.all_offset.push_back(res.all_start.size());
+    }
+    
+    return res;
+  }
+};
+
+// the tiers of string_match, from the strongest to the weakest match
+enum class MATCH_TIER: char {
+  START_CASE, START, INCLUSION_CASE, INCLUSION, CORRECTION, MISSPELL, WORDS, WORDS_MISSPELL, NONE
+};
+
 class StringMatch {
   // class with the string and the index at which the matching is found
+  // 
+  // two representations:
+  // - the matches are copied in all_matches (constructors with a MetaStringVec of matches)
+  // - the matches are a view on the choices: only their ids are kept and the 
+  //   strings are read from the choices on demand (see string_match)
+  //   => the cost of a match does not depend on the size of the strings nor 
+  //      of their meta information, and only the rows displayed are accessed
+  //
   string target; 
   MetaStringVec all_matches;
   vector<MatchInfo> all_match_info;
   vector<uint> all_id;
+  vector<MATCH_TIER> all_tier;
   string cause_no_match;
   uint target_size_wide = 0;
   
+  bool is_view = false;
+  MetaStringVec all_choices;
+  MatchInfoVec all_match_info_view;
+  
   void check_size_str_match_info(){
     if(all_matches.size() != all_match_info.size()){
       std::cerr << "In StringMatch, the size of vectors matched (" << all_matches.size();
@@ -2083,6 +2290,18 @@ class StringMatch {
     }
   }
   
+  // the elements sel of x
+  template<typename V, typename T>
+  static V gather(const V &x, const vector<T> &sel){
+    V res;
+    res.reserve(sel.size());
+    for(const auto &i : sel){
+      res.push_back(x[i]);
+    }
+    
+    return res;
+  }
+  
 public:
   StringMatch() = default;
 
@@ -2135,12 +2354,43 @@ public:
     check_size_str_id();
   };
   
-  uint size() const { return all_matches.size(); };
-  bool empty() const { return all_matches.empty(); };
+  // view: the matches are the elements all_id_vec of the choices
+  StringMatch(string target_in, MetaStringVec choices, MatchInfoVec match_info_vec,
+              vector<uint> &&all_id_vec, vector<MATCH_TIER> &&all_tier_vec, string reason):
+    target(target_in), all_id(std::move(all_id_vec)), all_tier(std::move(all_tier_vec)), 
+    cause_no_match(reason), is_view(true), all_choices(choices), 
+    all_match_info_view(std::move(match_info_vec))
+  {
+    target_size_wide = utf8::count_wide_chars(target);
+    if(all_match_info_view.size() != all_id.size()){
+      std::cerr << "In StringMatch, the number of matches (" << all_id.size();
+      std::cerr << " differ from the size of the match info (" << all_match_info_view.size() << ").\n";
+    }
+  };
   
-  string string_at(uint i) const { return i < all_matches.size() ? all_matches.string_at(i) : ""; }
+  // the total number of matches
+  uint size() const { return is_view ? all_id.size() : all_matches.size(); };
+  bool empty() const { return size() == 0; };
+  
+  string string_at(uint i) const { 
+    if(is_view){
+      return i < all_id.size() ? all_choices.string_at(all_id[i]) : "";
+    }
+    return i < all_matches.size() ? all_matches.string_at(i) : "";
+  }
+  
+  // NOTA: the view is valid as long as the match (which holds a user of the string pool) lives
+  std::string_view view_at(uint i) const { 
+    if(is_view){
+      return i < all_id.size() ? all_choices.view_at(all_id[i]) : std::string_view();
+    }
+    return i < all_matches.size() ? all_matches.view_at(i) : std::string_view();
+  }
   
   MatchInfo match_info_at(uint i) const { 
+    if(is_view){
+      return i < all_match_info_view.size() ? all_match_info_view.at(i) : MatchInfo(target_size_wide);
+    }
     return i < all_match_info.size() ? all_match_info[i] : MatchInfo(target_size_wide);
   }
   
@@ -2152,6 +2402,12 @@ public:
     return i < all_id.size() ? all_id[i] : 0; 
   }
   
+  const vector<uint>& get_all_id() const { return all_id; }
+  
+  MATCH_TIER tier_at(uint i) const {
+    return i < all_tier.size() ? all_tier[i] : MATCH_TIER::NONE;
+  }
+  
   StringMatch& set_cause_no_match(const string &x){ 
     cause_no_match = x;
     return *this;
@@ -2169,45 +2425,150 @@ public:
   uint get_target_size_wide() const { return target_size_wide; }
   
   MetaStringVec at(size_t i) const {
-    if(i > all_matches.size()){
+    if(i >= size()){
       throw std::out_of_range("The index requested is larger than the current number of matches.");
     }
     
-    return all_matches.at(i);
+    return is_view ? all_choices.at(all_id[i]) : all_matches.at(i);
   }
   
   bool has_meta(const string &x) const {
-    return all_matches.has_meta(x);
+    return is_view ? all_choices.has_meta(x) : all_matches.has_meta(x);
+  }
+  
+  bool is_view_on_choices() const { return is_view; }
+  
+  // a view is bound to new choices with the same ids (eg with new meta information)
+  StringMatch& rebind_choices(const MetaStringVec &choices){
+    if(is_view){
+      all_choices = choices;
+    }
+    return *this;
+  }
+  
+  string meta_at(const string &key, uint i) const {
+    return is_view ? all_choices.meta_at(key, id_at(i)) : all_matches.meta_at(key, i);
   }
   
   vector<string> get_meta_vector(const string &x) const {
+    if(is_view){
+      // the key is resolved once
+      const size_t k = all_choices.meta_key_pos(x);
+      vector<string> res;
+      res.reserve(all_id.size());
+      for(const auto &i : all_id){
+        res.push_back(all_choices.meta_at_pos(k, i));
+      }
+      return res;
+    }
     return all_matches.meta(x);
   }
   
   vector<string> get_matches() const {
+    if(is_view){
+      vector<string> res;
+      res.reserve(all_id.size());
+      for(const auto &i : all_id){
+        res.emplace_back(all_choices.view_at(i));
+      }
+      return res;
+    }
     return all_matches.get_string_vec();
   }
   
+  // keeps only the matches sel (in this order), eg to filter the matches
+  // NOTA: the strings and their meta information are not copied
+  StringMatch& select(const vector<uint> &sel){
+    
+    for(const auto &i : sel){
+      if(i >= size()){
+        throw util::index_pblm("When selecting the matches, the selection ID (",
+                               i, ") is invalid given the number of matches ", size(), ".");
+      }
+    }
+    
+    if(is_view){
+      all_id = gather(all_id, sel);
+      all_match_info_view = all_match_info_view.subset(sel);
+    } else {
+      all_matches.select(sel);
+      all_match_info = gather(all_match_info, sel);
+      if(!all_id.empty()){
+        all_id = gather(all_id, sel);
+      }
+    }
+    
+    if(!all_tier.empty()){
+      all_tier = gather(all_tier, sel);
+    }
+    
+    return *this;
+  }
+  
 };
 
-StringMatch string_match(const string &query, MetaStringVec choices);
+// large sets of choices are matched in parallel (50,000 candidates by default)
+void set_string_match_parallel_min_size(uint n);
+
+// instrumentation of string_match, for the benchmarks (see tests/bench_string_match.cpp)
+// when set, each run of a tier is recorded (nullptr: nothing is recorded, the default)
+// NOTA: only the checks of the candidates are timed, not their computation
+struct StringMatchTierTimes {
+  static const int N_TIERS = static_cast<int>(MATCH_TIER::NONE);
+  // for each tier: the time of each run in nanoseconds, and its number of candidates
+  vector<uint64_t> all_ns[N_TIERS];
+  vector<uint64_t> all_n_candidates[N_TIERS];
+};
+
+void set_string_match_tier_times(StringMatchTierTimes *ptimes);
+
+StringMatch string_match(const string &query, MetaStringVec choices, const StringMatch &previous);
+inline StringMatch string_match(const string &query, MetaStringVec choices){
+  return string_match(query, choices, StringMatch());
+}
 inline StringMatch string_match(const string &query, const vector<string> &choices){
   MetaStringVec msv = choices;
   return string_match(query, msv);
 }
 
+// Keeps the successive matches on a given set of choices while the user types:
+// - when the query extends the previous one, only the previous matches are
+//   re-examined (except for the misspell tiers)
+// - when the query is shortened (backspace), the previous result is restored
+//
+class StringMatchStack {
+  vector<StringMatch> all_matches;
+  
+  // to check that the choices have not changed (ids in the string pool)
+  vec_id choices_id;
+  
+public:
+  StringMatchStack() = default;
+  
+  StringMatch match(const string &query, MetaStringVec choices);
+  
+  void clear(){ all_matches.clear(); }
+  uint size() const { return all_matches.size(); }
+};
+
 //
 // ParenMatcher ----------------------------------------------------------------
 //
 
 class ParenMatcher {
   ParenMatcher() = delete;
+  
+  void init(const string &line, const ParenIndex &index, uint cursor);
+  
 public:
   bool pair_found = false;
   uint i_start = UNSET::UINT;
   uint i_end = UNSET::UINT;
   
-  ParenMatcher(string, uint);
+  // the positions are narrow
+  ParenMatcher(const string &line, uint cursor);
+  // the cursor is wide, the positions found are narrow
+  ParenMatcher(const string_utf8 &line, uint cursor);
 };
 
 //
@@ -2227,5 +2588,19 @@ inline bool is_paren_adjacent(string_utf8 x, uint cursor_pos){
 
 vector<uint> contextual_selection(const string_utf8 &, const uint, const uint);
 
+// the cursors are wide
+inline bool any_open_paren_before(const string_utf8 &x, const char target, const uint cursor){
+  if(cursor == 0){
+    return false;
+  }
+  
+  return any_open_paren_before(x.str(), x.paren_index(), target, x.wide_to_narrow_index(cursor) - 1);
+}
+
+inline uint go_to_next_inner_paren(const string_utf8 &x, uint cursor, bool left){
+  const uint narrow_i = go_to_next_inner_paren(x.str(), x.paren_index(), x.wide_to_narrow_index(cursor), left);
+  return x.narrow_to_wide_index(narrow_i);
+}
+
 
 } // namespace stringtools
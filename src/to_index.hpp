@@ -7,39 +7,74 @@
 #pragma once
 
 #include "util.hpp"
+#include "workerpool.hpp"
 
 #include <string>
+#include <string_view>
 #include <vector>
+#include <tuple>
+#include <utility>
+#include <functional>
+#include <type_traits>
+#include <cstdint>
+#include <algorithm>
 using std::vector;
 
 using util::bad_type;
 using util::msg;
 
+// Implementation notes:
+// - to_index gives to each distinct key an id, in the order of first occurrence
+//   (or of last occurrence with reverse)
+// - open addressing with linear probing: each slot of the table stores the
+//   first observation of a key and the hash of the key. The hashes are compared
+//   first, then the keys themselves (Eq) => two distinct keys are never merged,
+//   even when their hashes collide
+// - everything is in 64 bits: hashes, observations, sizes
+// - the default hash, ToIndexHash, is a fast 64 bit hash with a strong mixing:
+//   * integers: the splitmix64 finalizer
+//   * strings: the bytes are read 8 by 8 (hash_bytes64 in to_index.cpp)
+//   * composite keys: std::pair, std::tuple and std::vector, the hashes of the
+//     elements are combined
+//   * other types: std::hash, mixed
+// - large inputs are indexed in parallel (to_index_parallel), radix partitioning:
+//   * the keys are hashed and scattered into P partitions by the top bits of
+//     their hash, each partition keeps the processing order (forward or reverse)
+//   * equal keys fall in the same partition => the partitions are indexed
+//     independently, with the same algorithm as the serial version
+//   * stitching: the global id of a key is the rank of its first occurrence
+//     among all first occurrences => the results (index, first_obs, table) are
+//     identical to the serial ones
+// - the hash and Eq functions are called from several threads, they must not
+//   have side effects
+//
+
 class IndexInfo {
   vector<size_t> index;
   vector<size_t> first_obs;
   vector<size_t> table;
 public:
-  IndexInfo(vector<size_t> index_in, vector<size_t> first_obs_in, 
-            vector<size_t> table_count): 
-    index(index_in), first_obs(first_obs_in), table(table_count) {}
+  IndexInfo(vector<size_t> &&index_in, vector<size_t> &&first_obs_in,
+            vector<size_t> &&table_count):
+    index(std::move(index_in)), first_obs(std::move(first_obs_in)),
+    table(std::move(table_count)) {}
   
-  vector<size_t> get_index() const {
+  const vector<size_t>& get_index() const {
     return index;
   }
   
-  vector<size_t> get_first_obs() const {
+  const vector<size_t>& get_first_obs() const {
     return first_obs;
   }
   
-  vector<size_t> get_table() const {
+  const vector<size_t>& get_table() const {
     return table;
   }
 };
 
 class to_indexOpts {
-  bool do_reverse;
-  bool do_table;
+  bool do_reverse = false;
+  bool do_table = false;
   
 public:
   
@@ -59,12 +94,352 @@ public:
   
 };
 
-IndexInfo to_index(const vector<size_t> &x, const to_indexOpts opts = to_indexOpts());
+//
+// hashing ---------------------------------------------------------------------
+//
+
+inline uint64_t mix64(uint64_t x){
+  // splitmix64 finalizer
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return x;
+}
+
+inline uint64_t hash_combine64(uint64_t h, uint64_t value){
+  return mix64(h ^ (value + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2)));
+}
+
+uint64_t hash_bytes64(const char *px, size_t n);
+
+template<typename T>
+struct is_composite_key : std::false_type {};
+
+template<typename... T>
+struct is_composite_key<std::tuple<T...>> : std::true_type {};
+
+template<typename T1, typename T2>
+struct is_composite_key<std::pair<T1, T2>> : std::true_type {};
 
-IndexInfo to_index(const vector<std::string> &x, const to_indexOpts opts = to_indexOpts());
+template<typename T>
+struct is_vector_key : std::false_type {};
 
+template<typename T>
+struct is_vector_key<vector<T>> : std::true_type {};
 
+struct ToIndexHash {
+  
+  template<typename T>
+  uint64_t operator()(const T &x) const {
+    
+    if constexpr (std::is_integral_v<T> || std::is_enum_v<T>){
+      return mix64(static_cast<uint64_t>(x));
+      
+    } else if constexpr (std::is_convertible_v<const T&, std::string_view>){
+      const std::string_view sv = x;
+      return hash_bytes64(sv.data(), sv.size());
+      
+    } else if constexpr (is_composite_key<T>::value){
+      uint64_t h = 0;
+      std::apply([&](const auto&... elem){ ((h = hash_combine64(h, (*this)(elem))), ...); }, x);
+      return h;
+      
+    } else if constexpr (is_vector_key<T>::value){
+      uint64_t h = mix64(x.size());
+      for(const auto &elem : x){
+        h = hash_combine64(h, (*this)(elem));
+      }
+      return h;
+      
+    } else {
+      return mix64(std::hash<T>{}(x));
+    }
+  }
+};
 
+//
+// to_index --------------------------------------------------------------------
+//
 
+// number of bits of the table: at least 2n + 2 slots
+inline int to_index_shifter(size_t n){
+  int shifter = 8;
+  while((static_cast<size_t>(1) << shifter) < 2 * n + 2){
+    ++shifter;
+  }
+  
+  return shifter;
+}
+
+template<typename Key, typename Hash = ToIndexHash, typename Eq = std::equal_to<Key>>
+IndexInfo to_index_serial(const vector<Key> &x, const to_indexOpts opts = to_indexOpts(),
+                          const Hash &hash = Hash(), const Eq &eq = Eq()){
+  
+  const bool reverse = opts.is_reverse();
+  const bool add_table = opts.is_table();
+  
+  const size_t n = x.size();
+  const size_t n_slots = static_cast<size_t>(1) << to_index_shifter(n);
+  const size_t mask = n_slots - 1;
+  
+  // 1 + the first observation of the key (0: empty slot), and the hash of the key
+  vector<size_t> slot_obs(n_slots, 0);
+  vector<uint64_t> slot_hash(n_slots);
+  
+  vector<size_t> index(n);
+  vector<size_t> first_obs;
+  vector<size_t> table;
+  
+  size_t g = 0;
+  for(size_t k = 0 ; k < n ; ++k){
+    const size_t i = reverse ? n - 1 - k : k;
+    const uint64_t h = hash(x[i]);
+    size_t id = h & mask;
+    
+    bool does_exist = false;
+    while(slot_obs[id] != 0){
+      const size_t obs = slot_obs[id] - 1;
+      if(slot_hash[id] == h && eq(x[obs], x[i])){
+        index[i] = index[obs];
+        does_exist = true;
+        break;
+      }
+      
+      id = (id + 1) & mask;
+    }
+    
+    if(!does_exist){
+      slot_obs[id] = i + 1;
+      slot_hash[id] = h;
+      index[i] = g++;
+      first_obs.push_back(i);
+    }
+    
+    if(add_table){
+      if(does_exist){
+        ++table[index[i]];
+      } else {
+        table.push_back(1);
+      }
+    }
+  }
+  
+  return IndexInfo(std::move(index), std::move(first_obs), std::move(table));
+}
+
+template<typename Key, typename Hash = ToIndexHash, typename Eq = std::equal_to<Key>>
+IndexInfo to_index_parallel(const vector<Key> &x, const to_indexOpts opts = to_indexOpts(),
+                            const Hash &hash = Hash(), const Eq &eq = Eq()){
+  // see the implementation notes
+  
+  const bool reverse = opts.is_reverse();
+  const bool add_table = opts.is_table();
+  
+  const size_t n = x.size();
+  WorkerPool &pool = get_worker_pool();
+  
+  // the processing order is split in chunks, several per thread
+  const uint32_t n_chunks = 4 * pool.size();
+  const size_t chunk_size = (n + n_chunks - 1) / n_chunks;
+  auto chunk_start = [&](uint32_t c){ return std::min(n, c * chunk_size); };
+  
+  // at least 8 partitions per thread
+  int part_bits = 4;
+  while((static_cast<uint32_t>(1) << part_bits) < 8 * pool.size()){
+    ++part_bits;
+  }
+  const uint32_t n_parts = static_cast<uint32_t>(1) << part_bits;
+  const int part_shift = 64 - part_bits;
+  
+  //
+  // step 1: hashing, and number of keys per chunk and partition
+  //
+  
+  vector<uint64_t> all_hash(n);
+  // count of the chunk c in the partition p: chunk_count[c * n_parts + p]
+  vector<size_t> chunk_count(static_cast<size_t>(n_chunks) * n_parts, 0);
+  
+  pool.run(n_chunks, [&](uint32_t c){
+    size_t *pcount = &chunk_count[static_cast<size_t>(c) * n_parts];
+    const size_t k_end = chunk_start(c + 1);
+    for(size_t k = chunk_start(c) ; k < k_end ; ++k){
+      const size_t i = reverse ? n - 1 - k : k;
+      const uint64_t h = hash(x[i]);
+      all_hash[i] = h;
+      ++pcount[h >> part_shift];
+    }
+  });
+  
+  //
+  // step 2: scatter, the observations of each partition are in processing order
+  //
+  
+  vector<size_t> part_start(n_parts + 1);
+  // where the chunk c writes in the partition p: same layout as chunk_count
+  vector<size_t> chunk_offset(chunk_count.size());
+  size_t total = 0;
+  for(uint32_t p = 0 ; p < n_parts ; ++p){
+    part_start[p] = total;
+    for(uint32_t c = 0 ; c < n_chunks ; ++c){
+      const size_t cp = static_cast<size_t>(c) * n_parts + p;
+      chunk_offset[cp] = total;
+      total += chunk_count[cp];
+    }
+  }
+  part_start[n_parts] = total;
+  
+  vector<size_t> part_obs(n);
+  pool.run(n_chunks, [&](uint32_t c){
+    size_t *poffset = &chunk_offset[static_cast<size_t>(c) * n_parts];
+    const size_t k_end = chunk_start(c + 1);
+    for(size_t k = chunk_start(c) ; k < k_end ; ++k){
+      const size_t i = reverse ? n - 1 - k : k;
+      part_obs[poffset[all_hash[i] >> part_shift]++] = i;
+    }
+  });
+  
+  //
+  // step 3: each partition is indexed independently
+  //
+  
+  // local id of the key, aligned with part_obs
+  vector<size_t> local_id(n);
+  // for each partition: position in part_obs of the first occurrence of the keys
+  vector<vector<size_t>> all_first_pos(n_parts);
+  vector<vector<size_t>> all_count(n_parts);
+  // 1 if the observation is the first occurrence of a key
+  vector<char> is_first(n, 0);
+  
+  pool.run(n_parts, [&](uint32_t p){
+    const size_t j_start = part_start[p];
+    const size_t j_end = part_start[p + 1];
+    if(j_start == j_end){
+      return;
+    }
+    
+    const size_t n_slots = static_cast<size_t>(1) << to_index_shifter(j_end - j_start);
+    const size_t mask = n_slots - 1;
+    
+    // 1 + the position in part_obs of the first occurrence (0: empty slot)
+    vector<size_t> slot_pos(n_slots, 0);
+    vector<uint64_t> slot_hash(n_slots);
+    
+    vector<size_t> &first_pos = all_first_pos[p];
+    vector<size_t> &count = all_count[p];
+    
+    for(size_t j = j_start ; j < j_end ; ++j){
+      const size_t i = part_obs[j];
+      const uint64_t h = all_hash[i];
+      size_t id = h & mask;
+      
+      bool does_exist = false;
+      while(slot_pos[id] != 0){
+        const size_t j_first = slot_pos[id] - 1;
+        if(slot_hash[id] == h && eq(x[part_obs[j_first]], x[i])){
+          local_id[j] = local_id[j_first];
+          does_exist = true;
+          break;
+        }
+        
+        id = (id + 1) & mask;
+      }
+      
+      if(!does_exist){
+        slot_pos[id] = j + 1;
+        slot_hash[id] = h;
+        local_id[j] = first_pos.size();
+        first_pos.push_back(j);
+        is_first[i] = 1;
+      }
+      
+      if(add_table){
+        if(does_exist){
+          ++count[local_id[j]];
+        } else {
+          count.push_back(1);
+        }
+      }
+    }
+  });
+  
+  //
+  // step 4: stitching, the global ids of the first occurrences
+  //
+  
+  // number of first occurrences in each chunk => id of the first one
+  vector<size_t> chunk_n_first(n_chunks, 0);
+  pool.run(n_chunks, [&](uint32_t c){
+    const size_t k_end = chunk_start(c + 1);
+    size_t n_first = 0;
+    for(size_t k = chunk_start(c) ; k < k_end ; ++k){
+      n_first += is_first[reverse ? n - 1 - k : k];
+    }
+    chunk_n_first[c] = n_first;
+  });
+  
+  vector<size_t> chunk_g(n_chunks);
+  size_t n_groups = 0;
+  for(uint32_t c = 0 ; c < n_chunks ; ++c){
+    chunk_g[c] = n_groups;
+    n_groups += chunk_n_first[c];
+  }
+  
+  vector<size_t> index(n);
+  vector<size_t> first_obs(n_groups);
+  
+  pool.run(n_chunks, [&](uint32_t c){
+    size_t g = chunk_g[c];
+    const size_t k_end = chunk_start(c + 1);
+    for(size_t k = chunk_start(c) ; k < k_end ; ++k){
+      const size_t i = reverse ? n - 1 - k : k;
+      if(is_first[i]){
+        index[i] = g;
+        first_obs[g] = i;
+        ++g;
+      }
+    }
+  });
+  
+  //
+  // step 5: the ids of all the keys, and the table
+  //
+  
+  vector<size_t> table(add_table ? n_groups : 0);
+  
+  pool.run(n_parts, [&](uint32_t p){
+    const vector<size_t> &first_pos = all_first_pos[p];
+    const size_t j_end = part_start[p + 1];
+    for(size_t j = part_start[p] ; j < j_end ; ++j){
+      index[part_obs[j]] = index[part_obs[first_pos[local_id[j]]]];
+    }
+    
+    if(add_table){
+      const vector<size_t> &count = all_count[p];
+      for(size_t g = 0 ; g < count.size() ; ++g){
+        table[index[part_obs[first_pos[g]]]] = count[g];
+      }
+    }
+  });
+  
+  return IndexInfo(std::move(index), std::move(first_obs), std::move(table));
+}
+
+// to_index is run in parallel when there are at least this number of keys
+size_t get_to_index_parallel_min_size();
+void set_to_index_parallel_min_size(size_t n);
+
+template<typename Key, typename Hash = ToIndexHash, typename Eq = std::equal_to<Key>>
+IndexInfo to_index(const vector<Key> &x, const to_indexOpts opts = to_indexOpts(),
+                   const Hash &hash = Hash(), const Eq &eq = Eq()){
+  
+  // NOTA: the pool is only created when needed
+  if(x.size() >= get_to_index_parallel_min_size() && get_worker_pool().size() > 1){
+    return to_index_parallel(x, opts, hash, eq);
+  }
+  
+  return to_index_serial(x, opts, hash, eq);
+}
 
 
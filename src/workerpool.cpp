@@ -0,0 +1,117 @@
+    //=========================================================================//
+   //            Author: Laurent R. Bergé, University of Bordeaux             //
+  //             Copyright (C) 2025-present, Laurent R. Bergé                //
+ //              MIT License (see project_root/LICENSE)                     //
+//=========================================================================//
+
+#include "workerpool.hpp"
+
+#include <algorithm>
+
+WorkerPool::WorkerPool(uint32_t n_threads){
+  start(n_threads <= 1 ? 0 : n_threads - 1);
+}
+
+WorkerPool::~WorkerPool(){
+  join_all();
+}
+
+void WorkerPool::start(uint32_t n_workers){
+  stop = false;
+  for(uint32_t i = 0 ; i < n_workers ; ++i){
+    all_threads.emplace_back(&WorkerPool::worker_loop, this);
+  }
+}
+
+void WorkerPool::join_all(){
+  {
+    std::lock_guard<std::mutex> lock(mut);
+    stop = true;
+  }
+  cv_work.notify_all();
+  
+  for(auto &t : all_threads){
+    if(t.joinable()){
+      t.join();
+    }
+  }
+  
+  all_threads.clear();
+}
+
+void WorkerPool::resize(uint32_t n_threads){
+  if(n_threads == size()){
+    return;
+  }
+  
+  join_all();
+  start(n_threads <= 1 ? 0 : n_threads - 1);
+}
+
+void WorkerPool::run_tasks(std::unique_lock<std::mutex> &lock){
+  // the lock is held when entering and leaving
+  
+  while(pjob && next_task < n_tasks){
+    const uint32_t t = next_task++;
+    const std::function<void(uint32_t)> &job = *pjob;
+    
+    lock.unlock();
+    job(t);
+    lock.lock();
+    
+    if(++n_done == n_tasks){
+      cv_done.notify_all();
+    }
+  }
+}
+
+void WorkerPool::worker_loop(){
+  std::unique_lock<std::mutex> lock(mut);
+  uint64_t last_job_id = 0;
+  
+  while(true){
+    cv_work.wait(lock, [&]{ return stop || job_id != last_job_id; });
+    
+    if(stop){
+      return;
+    }
+    
+    last_job_id = job_id;
+    run_tasks(lock);
+  }
+}
+
+void WorkerPool::run(uint32_t n_tasks_in, const std::function<void(uint32_t)> &job){
+  
+  if(n_tasks_in == 0){
+    return;
+  }
+  
+  if(all_threads.empty() || n_tasks_in == 1){
+    for(uint32_t t = 0 ; t < n_tasks_in ; ++t){
+      job(t);
+    }
+    return;
+  }
+  
+  std::unique_lock<std::mutex> lock(mut);
+  pjob = &job;
+  n_tasks = n_tasks_in;
+  next_task = 0;
+  n_done = 0;
+  ++job_id;
+  cv_work.notify_all();
+  
+  // the caller works too
+  run_tasks(lock);
+  
+  cv_done.wait(lock, [&]{ return n_done == n_tasks; });
+  pjob = nullptr;
+}
+
+WorkerPool& get_worker_pool(){
+  // NOTA: the pool is never destroyed on purpose: at exit, the worker
+  // threads may already have been terminated by the system
+  static WorkerPool *ppool = new WorkerPool(std::min(8u, std::max(1u, std::thread::hardware_concurrency())));
+  return *ppool;
+}
@@ -0,0 +1,59 @@
+    //=========================================================================//
+   //            Author: Laurent R. Bergé, University of Bordeaux             //
+  //             Copyright (C) 2025-present, Laurent R. Bergé                //
+ //              MIT License (see project_root/LICENSE)                     //
+//=========================================================================//
+
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <cstdint>
+
+// Implementation notes:
+// - a small set of threads created once and reused for all the jobs
+// - a job is a number of tasks: each task t in [0, n_tasks) is run by any worker,
+//   the calling thread also works and run() returns when all the tasks are done
+// - jobs are run one at a time (run is not reentrant)
+//
+
+class WorkerPool {
+  std::vector<std::thread> all_threads;
+  
+  std::mutex mut;
+  std::condition_variable cv_work;
+  std::condition_variable cv_done;
+  
+  const std::function<void(uint32_t)> *pjob = nullptr;
+  uint32_t n_tasks = 0;
+  uint32_t next_task = 0;
+  uint32_t n_done = 0;
+  uint64_t job_id = 0;
+  bool stop = false;
+  
+  void worker_loop();
+  void run_tasks(std::unique_lock<std::mutex> &lock);
+  void start(uint32_t n_workers);
+  void join_all();
+
+public:
+  WorkerPool() = delete;
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+  
+  // n_threads: total number of threads working, including the caller
+  WorkerPool(uint32_t n_threads);
+  ~WorkerPool();
+  
+  uint32_t size() const { return all_threads.size() + 1; }
+  
+  void resize(uint32_t n_threads);
+  
+  void run(uint32_t n_tasks, const std::function<void(uint32_t)> &job);
+};
+
+// the pool shared by the whole program, created on first use
+WorkerPool& get_worker_pool();
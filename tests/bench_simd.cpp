@@ -0,0 +1,182 @@
+
+#include "../src/simd.hpp"
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdio>
+
+using std::string;
+using std::vector;
+
+// NOTA:
+// - micro benchmark of the matching kernels behind startmatch and inclusion_simple
+// - the baseline is the previous byte by byte implementation (arguments by value)
+// - run from the project root: the R identifiers are in tests/data/
+//
+
+//
+// baseline -------------------------------------------------------------------
+//
+
+inline bool is_same_letter_baseline(const char c1, const char c2){
+  if(c1 == c2){
+    return true;
+  
+  } else if(c1 > c2){
+    if(c1 - c2 == 32){
+      return c1 >= 'a' && c1 <= 'z';
+    }
+  
+  } else {
+    if(c2 - c1 == 32){
+      return c2 >= 'a' && c2 <= 'z';
+    }
+  }
+  
+  return false;
+}
+
+bool startmatch_baseline(const string x, const string y, const bool strict_case, const unsigned int index_y = 0){
+  if(y.size() < x.size() + index_y){
+    return false;
+  }
+  
+  for(unsigned int i=0 ; i<x.size() ; ++i){
+    if(strict_case){
+      if(x[i] != y[i + index_y]){
+        return false;
+      }
+    } else {
+      if(!is_same_letter_baseline(x[i], y[i + index_y])){
+        return false;
+      }
+    }
+  }
+  
+  return true;
+}
+
+bool inclusion_baseline(const string x, const string y, const bool strict_case, unsigned int &index){
+  if(y.size() < x.size()){
+    return false;
+  }
+  
+  const unsigned int nx = x.size();
+  const unsigned int ny = y.size();
+  
+  for(unsigned int j=0 ; j<=(ny - nx) ; ++j){
+    if(startmatch_baseline(x, y, strict_case, j)){
+      index = j;
+      return true;
+    }
+  }
+  
+  return false;
+}
+
+//
+// timing ---------------------------------------------------------------------
+//
+
+vector<string> read_lines(const string &path){
+  vector<string> res;
+  std::ifstream file(path);
+  string line;
+  while(std::getline(file, line)){
+    if(!line.empty()){
+      res.push_back(line);
+    }
+  }
+  return res;
+}
+
+template<typename FUN>
+double ns_per_candidate(const vector<string> &choices, FUN fun, size_t &n_found){
+  // we repeat until we reach a reasonable duration
+  const int n_rep = 200;
+  n_found = 0;
+  
+  auto t0 = std::chrono::steady_clock::now();
+  for(int r = 0 ; r < n_rep ; ++r){
+    for(const auto &y : choices){
+      n_found += fun(y);
+    }
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  
+  n_found /= n_rep;
+  const double total = std::chrono::duration<double, std::nano>(t1 - t0).count();
+  return total / (static_cast<double>(n_rep) * choices.size());
+}
+
+int main(){
+  
+  vector<string> choices = read_lines("tests/data/r_functions.txt");
+  vector<string> pkgs = read_lines("tests/data/r_packages.txt");
+  choices.insert(choices.end(), pkgs.begin(), pkgs.end());
+  
+  if(choices.empty()){
+    std::cerr << "The R identifiers could not be read, please run from the project root.\n";
+    return 1;
+  }
+  
+  #if defined(SIMD_AVX2)
+    const string isa = "AVX2";
+  #elif defined(SIMD_SSE2)
+    const string isa = "SSE2";
+  #else
+    const string isa = "scalar";
+  #endif
+  
+  std::cout << "Kernels: " << isa << ", " << choices.size() << " R identifiers\n";
+  std::cout << "Cost per candidate, in nanoseconds\n\n";
+  
+  vector<string> all_queries = {"r", "re", "Sys", "read", "summ", "frame", "as.Date",
+                                "model.matrix", "na.omit", "packageVersion"};
+  
+  std::printf("%-16s %-10s %10s %10s %8s\n", "query", "kernel", "baseline", "simd", "matches");
+  
+  for(const auto &x : all_queries){
+    for(int strict = 0 ; strict < 2 ; ++strict){
+      const bool strict_case = strict == 1;
+      size_t n_base = 0, n_simd = 0;
+      unsigned int index = 0;
+      
+      double t_base = ns_per_candidate(choices, [&](const string &y){
+        return startmatch_baseline(x, y, strict_case);
+      }, n_base);
+      
+      double t_simd = ns_per_candidate(choices, [&](const string &y){
+        return simd::starts_with(x, y, strict_case);
+      }, n_simd);
+      
+      if(n_base != n_simd){
+        std::cerr << "Prefix results differ for \"" << x << "\"\n";
+        return 1;
+      }
+      
+      std::printf("%-16s %-10s %10.2f %10.2f %8zu\n", x.c_str(), strict_case ? "prefix" : "prefix_i",
+                  t_base, t_simd, n_simd);
+      
+      t_base = ns_per_candidate(choices, [&](const string &y){
+        return inclusion_baseline(x, y, strict_case, index);
+      }, n_base);
+      
+      t_simd = ns_per_candidate(choices, [&](const string &y){
+        return simd::find(x, y, strict_case) != std::string_view::npos;
+      }, n_simd);
+      
+      if(n_base != n_simd){
+        std::cerr << "Substring results differ for \"" << x << "\"\n";
+        return 1;
+      }
+      
+      std::printf("%-16s %-10s %10.2f %10.2f %8zu\n", x.c_str(), strict_case ? "substr" : "substr_i",
+                  t_base, t_simd, n_simd);
+    }
+  }
+  
+  return 0;
+}
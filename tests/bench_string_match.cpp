@@ -0,0 +1,326 @@
+
+#include "../src/stringtools.hpp"
+#include "../src/matchindex.hpp"
+#include "../src/spelldict.hpp"
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <random>
+#include <atomic>
+#include <map>
+#include <new>
+#include <cstdlib>
+#include <cstdio>
+
+using namespace stringtools;
+
+// NOTA:
+// - benchmark of string_match, the hot path of the autocompletion
+// - headless: only the matching engine is built, it runs on Linux too
+// - run from the project root: the recorded corpora are in tests/data/
+//   * r_functions.txt: exports of the base R packages
+//   * r_packages.txt: package names
+//   * file_paths.txt: a file listing
+//   the synthetic corpora are R-like identifiers
+// - for each corpus (and subsample size), the queries are built from the
+//   corpus: prefixes, inner parts, misspells and multiple words, of several lengths
+// - the times are reported in microseconds, with percentiles over the queries
+// - all the calls to operator new are counted
+//
+
+//
+// allocation counting ---------------------------------------------------------
+//
+
+std::atomic<uint64_t> n_alloc{0};
+std::atomic<uint64_t> n_alloc_bytes{0};
+
+// NOTA: g++ sees the malloc in operator new and the free in operator delete
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(size_t size){
+  ++n_alloc;
+  n_alloc_bytes += size;
+  void *p = std::malloc(size == 0 ? 1 : size);
+  if(!p){
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void operator delete(void *p) noexcept {
+  std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+  std::free(p);
+}
+
+//
+// utilities -------------------------------------------------------------------
+//
+
+vector<string> read_lines(const string &path){
+  vector<string> res;
+  std::ifstream file(path);
+  string line;
+  while(std::getline(file, line)){
+    if(!line.empty()){
+      res.push_back(line);
+    }
+  }
+  return res;
+}
+
+double percentile(vector<double> x, const double p){
+  if(x.empty()){
+    return 0;
+  }
+  std::sort(x.begin(), x.end());
+  return x[static_cast<size_t>(p * (x.size() - 1) + 0.5)];
+}
+
+vector<string> synthetic_identifiers(const size_t n, std::mt19937 &rng){
+  const vector<string> all_stems = {"get", "set", "read", "write", "data", "frame", "plot", "model",
+                                    "fit", "summary", "table", "list", "vec", "str", "col", "row",
+                                    "na", "is", "as", "to", "from", "by", "geom", "stat", "scale",
+                                    "theme", "lm", "glm", "fixest", "est", "coef", "var", "names"};
+  const vector<string> all_seps = {".", "_", ""};
+  
+  vector<string> res;
+  res.reserve(n);
+  for(size_t i = 0 ; i < n ; ++i){
+    const size_t n_parts = 1 + rng() % 3;
+    const string &sep = all_seps[rng() % all_seps.size()];
+    string id;
+    for(size_t j = 0 ; j < n_parts ; ++j){
+      string stem = all_stems[rng() % all_stems.size()];
+      if(j > 0){
+        if(sep.empty()){
+          // camelCase
+          stem[0] = stem[0] - 'a' + 'A';
+        } else {
+          id += sep;
+        }
+      }
+      id += stem;
+    }
+    // to avoid too many duplicates
+    if(rng() % 2){
+      id += std::to_string(rng() % 100);
+    }
+    res.push_back(id);
+  }
+  
+  return res;
+}
+
+struct Query {
+  string query;
+  string kind;
+};
+
+vector<Query> make_queries(const vector<string> &corpus, std::mt19937 &rng){
+  // from random elements of the corpus
+  
+  const vector<size_t> all_lengths = {1, 2, 3, 4, 6, 8, 12};
+  const int n_per_cell = 3;
+  
+  vector<Query> res;
+  for(const auto &len : all_lengths){
+    for(int r = 0 ; r < n_per_cell ; ++r){
+      const string &x = corpus[rng() % corpus.size()];
+      if(x.size() < len){
+        continue;
+      }
+      
+      // prefix
+      res.push_back({x.substr(0, len), "prefix"});
+      
+      // inner part
+      const size_t start = rng() % (x.size() - len + 1);
+      res.push_back({x.substr(start, len), "inner"});
+      
+      // misspell: transposition
+      if(len >= 4){
+        string typo = x.substr(0, len);
+        const size_t i = 1 + rng() % (len - 2);
+        std::swap(typo[i], typo[i + 1]);
+        res.push_back({typo, "misspell"});
+      }
+      
+      // words: beginnings of two tokens
+      vector<string> all_tokens = split_tokens(x);
+      if(all_tokens.size() >= 2 && len >= 2){
+        const size_t n_char = len / 2;
+        res.push_back({all_tokens[0].substr(0, n_char) + " " + all_tokens[1].substr(0, n_char), "words"});
+      }
+    }
+  }
+  
+  return res;
+}
+
+//
+// measures --------------------------------------------------------------------
+//
+
+struct Measures {
+  vector<double> all_us;
+  uint64_t n_alloc = 0;
+  uint64_t n_bytes = 0;
+  
+  void add(const double us, const uint64_t n_a, const uint64_t n_b){
+    all_us.push_back(us);
+    n_alloc += n_a;
+    n_bytes += n_b;
+  }
+};
+
+void print_header(const string &first){
+  std::printf("%-26s %7s %10s %10s %10s %10s %12s %10s\n", first.c_str(), "queries",
+              "p50", "p90", "p99", "max", "allocs/call", "KB/call");
+}
+
+void print_measures(const string &first, const Measures &m){
+  const size_t n = m.all_us.size();
+  if(n == 0){
+    return;
+  }
+  std::printf("%-26s %7zu %10.1f %10.1f %10.1f %10.1f %12.1f %10.1f\n", first.c_str(), n,
+              percentile(m.all_us, 0.5), percentile(m.all_us, 0.9), percentile(m.all_us, 0.99),
+              percentile(m.all_us, 1), static_cast<double>(m.n_alloc) / n,
+              static_cast<double>(m.n_bytes) / n / 1024);
+}
+
+int main(){
+  
+  vector<string> funs = read_lines("tests/data/r_functions.txt");
+  vector<string> pkgs = read_lines("tests/data/r_packages.txt");
+  vector<string> files = read_lines("tests/data/file_paths.txt");
+  
+  if(funs.empty() || pkgs.empty() || files.empty()){
+    std::cerr << "The corpora could not be read, please run from the project root.\n";
+    return 1;
+  }
+  
+  std::mt19937 rng(42);
+  
+  vector<string> pkg_funs;
+  pkg_funs.reserve(funs.size() * pkgs.size());
+  for(const auto &p : pkgs){
+    for(const auto &f : funs){
+      pkg_funs.push_back(p + "::" + f);
+    }
+  }
+  std::shuffle(pkg_funs.begin(), pkg_funs.end(), rng);
+  
+  vector<string> synthetic = synthetic_identifiers(100000, rng);
+  
+  // name, corpus, sizes of the subsamples (0 = all)
+  struct Corpus {
+    string name;
+    const vector<string> *pcorpus;
+    vector<size_t> all_sizes;
+  };
+  
+  vector<Corpus> all_corpora = {
+    {"R exports", &funs, {0}},
+    {"packages", &pkgs, {0}},
+    {"files", &files, {0}},
+    {"synthetic", &synthetic, {1000, 10000, 100000}},
+    {"pkg::fun", &pkg_funs, {1000, 10000, 100000, 0}}
+  };
+  
+  // the correction tier
+  vector<string> all_identifiers = funs;
+  all_identifiers.insert(all_identifiers.end(), pkgs.begin(), pkgs.end());
+  set_spell_dictionary(std::make_shared<const SpellDictionary>(identifier_tokens(all_identifiers), 1));
+  
+  StringMatchTierTimes tier_times;
+  for(int k = 0 ; k < StringMatchTierTimes::N_TIERS ; ++k){
+    tier_times.all_ns[k].reserve(100000);
+    tier_times.all_n_candidates[k].reserve(100000);
+  }
+  
+  std::map<size_t, Measures> measures_by_length;
+  std::map<string, Measures> measures_by_kind;
+  
+  std::cout << "Time of string_match, in microseconds\n\n";
+  print_header("corpus");
+  
+  for(const auto &corpus : all_corpora){
+    for(const auto &size : corpus.all_sizes){
+      const size_t n = size == 0 ? corpus.pcorpus->size() : std::min(size, corpus.pcorpus->size());
+      vector<string> choices(corpus.pcorpus->begin(), corpus.pcorpus->begin() + n);
+      MetaStringVec msv(choices);
+      
+      vector<Query> all_queries = make_queries(choices, rng);
+      
+      // warmup: the index is built
+      string_match("a", msv);
+      
+      set_string_match_tier_times(&tier_times);
+      
+      Measures m;
+      for(const auto &q : all_queries){
+        const uint64_t n_alloc_start = n_alloc;
+        const uint64_t n_bytes_start = n_alloc_bytes;
+        
+        auto t0 = std::chrono::steady_clock::now();
+        StringMatch res = string_match(q.query, msv);
+        auto t1 = std::chrono::steady_clock::now();
+        
+        const double us = std::chrono::duration<double, std::micro>(t1 - t0).count();
+        const uint64_t n_a = n_alloc - n_alloc_start;
+        const uint64_t n_b = n_alloc_bytes - n_bytes_start;
+        
+        m.add(us, n_a, n_b);
+        measures_by_length[q.query.size()].add(us, n_a, n_b);
+        measures_by_kind[q.kind].add(us, n_a, n_b);
+      }
+      
+      set_string_match_tier_times(nullptr);
+      
+      print_measures(corpus.name + " (" + std::to_string(n) + ")", m);
+    }
+  }
+  
+  std::cout << "\nBy query length (all corpora)\n\n";
+  print_header("length");
+  for(const auto &[len, m] : measures_by_length){
+    print_measures(std::to_string(len), m);
+  }
+  
+  std::cout << "\nBy kind of query (all corpora)\n\n";
+  print_header("kind");
+  for(const auto &[kind, m] : measures_by_kind){
+    print_measures(kind, m);
+  }
+  
+  std::cout << "\nBy tier: checks of the candidates only (all corpora)\n\n";
+  std::printf("%-26s %7s %10s %10s %10s %10s %12s\n", "tier", "runs", "p50", "p90", "p99", "max", "candidates");
+  const vector<string> all_tier_names = {"start (case)", "start", "inclusion (case)", "inclusion",
+                                         "correction", "misspell", "words", "words misspell"};
+  for(int k = 0 ; k < StringMatchTierTimes::N_TIERS ; ++k){
+    const size_t n_runs = tier_times.all_ns[k].size();
+    if(n_runs == 0){
+      continue;
+    }
+    
+    vector<double> all_us;
+    double n_cand = 0;
+    for(size_t r = 0 ; r < n_runs ; ++r){
+      all_us.push_back(tier_times.all_ns[k][r] / 1000.0);
+      n_cand += tier_times.all_n_candidates[k][r];
+    }
+    
+    std::printf("%-26s %7zu %10.1f %10.1f %10.1f %10.1f %12.0f\n", all_tier_names[k].c_str(), n_runs,
+                percentile(all_us, 0.5), percentile(all_us, 0.9), percentile(all_us, 0.99),
+                percentile(all_us, 1), n_cand / n_runs);
+  }
+  
+  return 0;
+}
@@ -0,0 +1,99 @@
+
+#include "../src/stringtools.hpp"
+#include "../src/matchindex.hpp"
+#include "../src/workerpool.hpp"
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <cstdio>
+
+using namespace stringtools;
+
+// NOTA:
+// - scaling of string_match with the number of threads of the worker pool
+// - the choices are all the package::function combinations from tests/data/
+//   => about 250,000 choices
+// - the index is disabled to time the full scan of the tiers
+// - run from the project root
+//
+
+vector<string> read_lines(const string &path){
+  vector<string> res;
+  std::ifstream file(path);
+  string line;
+  while(std::getline(file, line)){
+    if(!line.empty()){
+      res.push_back(line);
+    }
+  }
+  return res;
+}
+
+int main(){
+  
+  vector<string> funs = read_lines("tests/data/r_functions.txt");
+  vector<string> pkgs = read_lines("tests/data/r_packages.txt");
+  
+  if(funs.empty() || pkgs.empty()){
+    std::cerr << "The R identifiers could not be read, please run from the project root.\n";
+    return 1;
+  }
+  
+  vector<string> choices;
+  choices.reserve(funs.size() * pkgs.size());
+  for(const auto &p : pkgs){
+    for(const auto &f : funs){
+      choices.push_back(p + "::" + f);
+    }
+  }
+  
+  MatchIndex::min_size = static_cast<size_t>(-1);
+  set_string_match_parallel_min_size(0);
+  
+  vector<string> all_queries = {"r", "re", "read", "sumary", "dplyr::fil", "data frame"};
+  vector<uint32_t> all_n_threads = {1, 2, 4, 8};
+  const int n_rep = 5;
+  
+  std::cout << choices.size() << " choices, " << std::thread::hardware_concurrency() << " cores available\n";
+  std::cout << "Time per string_match, in milliseconds (speedup wrt 1 thread)\n\n";
+  
+  std::printf("%-12s %9s", "query", "matches");
+  for(const auto &n_threads : all_n_threads){
+    std::printf(" %14u thr", n_threads);
+  }
+  std::printf("\n");
+  
+  for(const auto &q : all_queries){
+    vector<string> res_ref;
+    double t_ref = 0;
+    std::printf("%-12s", q.c_str());
+    
+    for(const auto &n_threads : all_n_threads){
+      get_worker_pool().resize(n_threads);
+      // warmup
+      vector<string> res = string_match(q, choices).get_matches();
+      
+      auto t0 = std::chrono::steady_clock::now();
+      for(int r = 0 ; r < n_rep ; ++r){
+        res = string_match(q, choices).get_matches();
+      }
+      auto t1 = std::chrono::steady_clock::now();
+      const double ms = std::chrono::duration<double, std::milli>(t1 - t0).count() / n_rep;
+      
+      if(n_threads == 1){
+        res_ref = res;
+        t_ref = ms;
+        std::printf(" %9zu %18.1f", res.size(), ms);
+      } else {
+        if(res != res_ref){
+          std::cerr << "\nThe results differ from the single threaded ones for \"" << q << "\"\n";
+          return 1;
+        }
+        std::printf(" %10.1f (%4.1fx)", ms, t_ref / ms);
+      }
+    }
+    std::printf("\n");
+  }
+  
+  return 0;
+}
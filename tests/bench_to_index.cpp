@@ -0,0 +1,114 @@
+
+
+#include "../src/to_index.hpp"
+#include "../src/workerpool.hpp"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cstdio>
+
+using std::vector;
+
+// NOTA:
+// - throughput of to_index, serial and parallel, with the number of threads
+//   of the worker pool
+// - two kinds of keys: integers and short strings, with about n / 10 distinct
+//   values, the table is computed
+// - the results of the parallel version are checked against the serial ones
+//
+
+template<typename Key>
+double time_ms(const vector<Key> &x, bool parallel, IndexInfo &res, int n_rep){
+  
+  auto run = [&](){
+    return parallel ? to_index_parallel(x, to_indexOpts().table()) :
+                      to_index_serial(x, to_indexOpts().table());
+  };
+  
+  // warmup
+  res = run();
+  
+  auto t0 = std::chrono::steady_clock::now();
+  for(int r = 0 ; r < n_rep ; ++r){
+    res = run();
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  
+  return std::chrono::duration<double, std::milli>(t1 - t0).count() / n_rep;
+}
+
+bool same_index(const IndexInfo &a, const IndexInfo &b){
+  return a.get_index() == b.get_index() && a.get_first_obs() == b.get_first_obs() &&
+         a.get_table() == b.get_table();
+}
+
+template<typename Key>
+bool bench(const char *name, const vector<Key> &x, const vector<uint32_t> &all_n_threads){
+  
+  const int n_rep = x.size() >= 10000000 ? 2 : 5;
+  
+  IndexInfo res_ref({}, {}, {});
+  const double t_ref = time_ms(x, false, res_ref, n_rep);
+  // throughput in millions of keys per second
+  auto mps = [&](double ms){ return x.size() / ms / 1000; };
+  
+  std::printf("%-8s %9zu %8.1f", name, x.size(), mps(t_ref));
+  
+  IndexInfo res({}, {}, {});
+  for(const auto &n_threads : all_n_threads){
+    get_worker_pool().resize(n_threads);
+    const double ms = time_ms(x, true, res, n_rep);
+    
+    if(!same_index(res, res_ref)){
+      std::cerr << "\nThe results differ from the serial ones (" << name << ", "
+                << n_threads << " threads)\n";
+      return false;
+    }
+    
+    std::printf(" %8.1f (%4.1fx)", mps(ms), t_ref / ms);
+  }
+  std::printf("\n");
+  
+  return true;
+}
+
+int main(){
+  
+  vector<size_t> all_sizes = {100000, 1000000, 10000000};
+  vector<uint32_t> all_n_threads = {1, 2, 4, 8};
+  
+  std::cout << std::thread::hardware_concurrency() << " cores available\n";
+  std::cout << "Throughput of to_index, in millions of keys per second (speedup wrt serial)\n\n";
+  
+  std::printf("%-8s %9s %8s", "keys", "n", "serial");
+  for(const auto &n_threads : all_n_threads){
+    std::printf(" %11u thr", n_threads);
+  }
+  std::printf("\n");
+  
+  std::mt19937_64 gen(42);
+  
+  for(const auto &n : all_sizes){
+    vector<uint64_t> x_int(n);
+    for(auto &v : x_int){
+      v = gen() % (n / 10);
+    }
+    
+    if(!bench("integer", x_int, all_n_threads)){
+      return 1;
+    }
+    
+    vector<std::string> x_str(n);
+    for(size_t i = 0 ; i < n ; ++i){
+      x_str[i] = "key_" + std::to_string(x_int[i]);
+    }
+    
+    if(!bench("string", x_str, all_n_threads)){
+      return 1;
+    }
+  }
+  
+  return 0;
+}
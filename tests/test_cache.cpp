@@ -0,0 +1,186 @@
+
+
+#include "../src/cache.hpp"
+#include "../src/durablefile.hpp"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+
+using util::test_eq;
+using util::test_eq_vec_str;
+
+// NOTA:
+// - the caches are written in a temporary folder, removed at the end
+//
+
+int main(){
+  
+  const fs::path root = fs::temp_directory_path() / "sircon_test_cache";
+  fs::remove_all(root);
+  fs::create_directories(root);
+  CachedData::root_path = root;
+  
+  util::msg("binary round trip");
+  
+  vector<string> funs = {"plot", "", "lm", "data.frame", "ééé"};
+  vector<string> empty_vec;
+  vector<string> pkgs = {"base", "stats"};
+  
+  CachedData("R-4.5/test.txt").set_cached_vectors({funs, empty_vec, pkgs}, CachedData::SIZE::UNEQUAL);
+  test_eq(fs::exists(root / "R-4.5/test.bin"), true);
+  
+  CachedData::clear_memory_cache();
+  CachedData from_disk("R-4.5/test.txt");
+  test_eq(from_disk.exists(), true);
+  test_eq(from_disk.n_vectors(), 3u);
+  test_eq_vec_str(from_disk.get_cached_vector(0), funs);
+  test_eq(from_disk.get_cached_vector(1).size(), 0u);
+  test_eq_vec_str(from_disk.get_cached_vector(2), pkgs);
+  test_eq(from_disk.get_cached_views(0)[3] == "data.frame", true);
+  
+  util::msg("staleness");
+  
+  test_eq(from_disk.is_stale(CachedData::days(1)), false);
+  test_eq(from_disk.is_stale(std::chrono::seconds(-10)), true);
+  // no TTL stored
+  test_eq(from_disk.is_stale(), false);
+  test_eq(CachedData("absent.txt").is_stale(CachedData::days(1)), true);
+  
+  CachedData("ttl.txt").set_ttl(std::chrono::seconds(-10)).set_fingerprint(42).set_cached_vector(pkgs);
+  CachedData::clear_memory_cache();
+  CachedData with_ttl("ttl.txt");
+  test_eq(with_ttl.is_stale(), true);
+  test_eq(with_ttl.get_meta().fingerprint, 42u);
+  
+  util::msg("fingerprint");
+  
+  int n_fingerprints = 0;
+  uint64_t source_fingerprint = 7;
+  auto fingerprint = [&](){ ++n_fingerprints; return source_fingerprint; };
+  
+  CachedData("fp.txt").set_fingerprint_fun(fingerprint).set_cached_vector(pkgs);
+  CachedData::clear_memory_cache();
+  CachedData fp_same("fp.txt");
+  fp_same.set_fingerprint_fun(fingerprint);
+  test_eq(fp_same.is_stale(), false);
+  test_eq(fp_same.is_stale(), false);
+  test_eq(n_fingerprints, 2);
+  
+  source_fingerprint = 8;
+  CachedData fp_changed("fp.txt");
+  fp_changed.set_fingerprint_fun(fingerprint);
+  test_eq(fp_changed.is_stale(), true);
+  fp_changed.set_cached_vector(funs);
+  test_eq(n_fingerprints, 3);
+  test_eq(CachedData("fp.txt").set_fingerprint_fun(fingerprint).is_stale(), false);
+  
+  // an empty result is stored with its fingerprint
+  CachedData("fp_empty.txt").set_fingerprint_fun(fingerprint).set_cached_vectors({empty_vec, empty_vec}, CachedData::SIZE::UNEQUAL);
+  CachedData::clear_memory_cache();
+  CachedData fp_empty("fp_empty.txt");
+  test_eq(fp_empty.set_fingerprint_fun(fingerprint).is_stale(), false);
+  test_eq(fp_empty.get_cached_views(0).size(), 0u);
+  
+  util::msg("stale-while-revalidate");
+  
+  int n_calls = 0;
+  vector<string> refreshed = {"refreshed"};
+  auto refresh_ok = [&](){ ++n_calls; return vector<vector<string>>{refreshed}; };
+  auto refresh_fail = [&](){ ++n_calls; return vector<vector<string>>(); };
+  
+  // unset: computed right away
+  CachedData swr("swr.txt");
+  swr.refresh_if_stale(CachedData::days(1), refresh_ok);
+  test_eq(n_calls, 1);
+  test_eq_vec_str(swr.get_cached_vector(), refreshed);
+  
+  // stale: the old data is kept until the refresh is run
+  refreshed = {"refreshed again"};
+  CachedData swr_stale("swr.txt");
+  swr_stale.refresh_if_stale(std::chrono::seconds(-10), refresh_ok);
+  swr_stale.refresh_if_stale(std::chrono::seconds(-10), refresh_ok);
+  test_eq(n_calls, 1);
+  test_eq(CachedData::has_pending_refresh(), true);
+  test_eq_vec_str(swr_stale.get_cached_vector(), {"refreshed"});
+  
+  CachedData::run_pending_refreshes();
+  test_eq(n_calls, 2);
+  test_eq(CachedData::has_pending_refresh(), false);
+  // the old object keeps its data, the new ones see the refresh
+  test_eq_vec_str(swr_stale.get_cached_vector(), {"refreshed"});
+  test_eq_vec_str(CachedData("swr.txt").get_cached_vector(), refreshed);
+  CachedData::clear_memory_cache();
+  test_eq_vec_str(CachedData("swr.txt").get_cached_vector(), refreshed);
+  
+  // a failure is not retried
+  CachedData swr_fail("swr_fail.txt");
+  swr_fail.refresh_if_stale(CachedData::days(1), refresh_fail);
+  swr_fail.refresh_if_stale(CachedData::days(1), refresh_fail);
+  test_eq(n_calls, 3);
+  test_eq(swr_fail.is_unset(), true);
+  
+  util::msg("update in memory");
+  
+  CachedData("R-4.5/test.txt").set_cached_vector(pkgs);
+  test_eq(CachedData("R-4.5/test.txt").n_vectors(), 1u);
+  
+  util::msg("replacement while loaded");
+  
+  // another instance replaces the file while this one holds the cache read
+  // from it (with its MappedFile) => the write must succeed, including on Windows
+  CachedData::clear_memory_cache();
+  CachedData loaded("R-4.5/test.txt");
+  test_eq(loaded.exists(), true);
+  
+  vector<string> other_pkgs = {"utils"};
+  CachedData::clear_memory_cache();
+  CachedData("R-4.5/other.txt").set_cached_vector(other_pkgs);
+  string other_content;
+  {
+    std::ifstream other_in{root / "R-4.5/other.bin", std::ios::binary};
+    std::ostringstream all_bytes;
+    all_bytes << other_in.rdbuf();
+    other_content = all_bytes.str();
+  }
+  
+  test_eq(write_file_atomic(root / "R-4.5/test.bin", other_content), 0);
+  test_eq_vec_str(loaded.get_cached_vector(0), pkgs);
+  CachedData::clear_memory_cache();
+  test_eq_vec_str(CachedData("R-4.5/test.txt").get_cached_vector(0), other_pkgs);
+  
+  util::msg("migration of the text format");
+  
+  {
+    std::ofstream text_out{root / "legacy.txt"};
+    text_out << "plot\nlm\n^^^\nbase\n\n";
+  }
+  
+  CachedData legacy("legacy.txt");
+  test_eq(legacy.exists(), true);
+  test_eq(legacy.n_vectors(), 2u);
+  test_eq_vec_str(legacy.get_cached_vector(0), {"plot", "lm"});
+  test_eq_vec_str(legacy.get_cached_vector(1), {"base"});
+  test_eq(fs::exists(root / "legacy.txt"), false);
+  test_eq(fs::exists(root / "legacy.bin"), true);
+  // the text file was written just now
+  test_eq(legacy.is_stale(std::chrono::seconds(60)), false);
+  
+  CachedData::clear_memory_cache();
+  test_eq_vec_str(CachedData("legacy.txt").get_cached_vector(1), {"base"});
+  
+  util::msg("corrupt files");
+  
+  {
+    std::ofstream bad_out{root / "bad.bin", std::ios::binary};
+    bad_out << "SIRCACHE and then garbage";
+  }
+  
+  test_eq(CachedData("bad.txt").exists(), false);
+  
+  CachedData::clear_memory_cache();
+  fs::remove_all(root);
+  
+  std::cout << "\ntests perfomed successfully\n";
+  
+  return 0;
+}
@@ -0,0 +1,164 @@
+
+
+#include "../src/durablefile.hpp"
+#include "../src/mappedfile.hpp"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <set>
+#include <thread>
+#include <cstdlib>
+
+using std::vector;
+
+// NOTA:
+// - stress test: several writer processes run concurrently (this program,
+//   called with the argument "writer")
+// - each writer appends lines to a history, regularly rewrites the history
+//   under the lock (as a deduplication would), and replaces a cache file
+//   while checking that it only ever reads complete cache files
+// - at the end, no appended line must be lost or duplicated
+//
+
+const int N_WRITERS = 6;
+const int N_ITER = 150;
+const int N_CACHE_LINES = 500;
+
+string cache_content(int writer, int iter){
+  std::ostringstream out;
+  out << "begin\n";
+  for(int j = 0 ; j < N_CACHE_LINES ; ++j){
+    out << writer << " " << iter << "\n";
+  }
+  out << "end\n";
+  return out.str();
+}
+
+bool is_complete_cache(const string &x){
+  // the file starts with begin, ends with end, all the lines in between are equal
+  std::istringstream in(x);
+  string line, first_line;
+  std::getline(in, line);
+  if(line != "begin"){
+    return false;
+  }
+  
+  int n_lines = 0;
+  while(std::getline(in, line) && line != "end"){
+    if(n_lines == 0){
+      first_line = line;
+    } else if(line != first_line){
+      return false;
+    }
+    ++n_lines;
+  }
+  
+  return line == "end" && n_lines == N_CACHE_LINES;
+}
+
+int run_writer(int writer, const fs::path &root){
+  
+  const fs::path hist_path = root / "history";
+  const fs::path cache_path = root / "cache";
+  int n_errors = 0;
+  
+  for(int iter = 0 ; iter < N_ITER ; ++iter){
+    const string line = std::to_string(writer) + " " + std::to_string(iter) + "\n";
+    n_errors += append_file_locked(hist_path, line, util::DoCheck(true));
+    
+    if(iter % 10 == 0){
+      // read-modify-rewrite under the lock
+      FileLock lock(hist_path);
+      std::ifstream hist_in(hist_path, std::ios::binary);
+      std::ostringstream all_lines;
+      all_lines << hist_in.rdbuf();
+      hist_in.close();
+      n_errors += write_file_atomic(hist_path, all_lines.str(), util::DoCheck(true));
+    }
+    
+    n_errors += write_file_atomic(cache_path, cache_content(writer, iter), util::DoCheck(true));
+    
+    MappedFile cache_file;
+    if(cache_file.open(cache_path) && !is_complete_cache(string(cache_file.data(), cache_file.size()))){
+      std::cerr << "writer " << writer << ": incomplete cache file read\n";
+      ++n_errors;
+    }
+  }
+  
+  return n_errors == 0 ? 0 : 1;
+}
+
+int main(int argc, char *argv[]){
+  
+  if(argc == 4 && string(argv[1]) == "writer"){
+    return run_writer(std::atoi(argv[2]), argv[3]);
+  }
+  
+  const fs::path root = fs::temp_directory_path() / "sircon_test_durablefile";
+  fs::remove_all(root);
+  fs::create_directories(root);
+  
+  util::msg("single process");
+  
+  const fs::path single_path = root / "single";
+  util::test_eq(write_file_atomic(single_path, "hello\n"), 0);
+  util::test_eq(append_file_locked(single_path, "world\n"), 0);
+  {
+    std::ifstream single_in(single_path);
+    std::ostringstream content;
+    content << single_in.rdbuf();
+    util::test_eq(content.str(), string("hello\nworld\n"));
+  }
+  
+  util::msg("concurrent writer processes");
+  
+  vector<std::thread> all_threads;
+  vector<int> all_status(N_WRITERS, -1);
+  for(int k = 0 ; k < N_WRITERS ; ++k){
+    string cmd = "\"" + string(argv[0]) + "\" writer " + std::to_string(k) + " \"" + root.string() + "\"";
+#ifdef _WIN32
+    // cmd.exe removes the outer quotes
+    cmd = "\"" + cmd + "\"";
+#endif
+    all_threads.emplace_back([&all_status, k, cmd](){ all_status[k] = std::system(cmd.c_str()); });
+  }
+  
+  for(auto &t : all_threads){
+    t.join();
+  }
+  
+  for(int k = 0 ; k < N_WRITERS ; ++k){
+    util::test_eq(all_status[k], 0);
+  }
+  
+  // all the lines are there, once
+  std::ifstream hist_in(root / "history");
+  std::set<string> all_lines;
+  string line;
+  int n_lines = 0;
+  while(std::getline(hist_in, line)){
+    all_lines.insert(line);
+    ++n_lines;
+  }
+  hist_in.close();
+  
+  util::test_eq(n_lines, N_WRITERS * N_ITER);
+  util::test_eq(all_lines.size(), static_cast<size_t>(N_WRITERS * N_ITER));
+  
+  // no temporary file left
+  int n_files = 0;
+  for(const auto &p : fs::directory_iterator(root)){
+    (void)p;
+    ++n_files;
+  }
+  // single, single.lock, history, history.lock, cache
+  util::test_eq(n_files, 5);
+  
+  fs::remove_all(root);
+  
+  std::cout << "\ntests perfomed successfully\n";
+  
+  return 0;
+}
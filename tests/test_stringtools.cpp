@@ -1,6 +1,11 @@
 
 #include "../src/stringtools.hpp"
 #include "../src/VTS.hpp"
+#include "../src/matchindex.hpp"
+#include "../src/misspell.hpp"
+#include "../src/spelldict.hpp"
+#include "../src/stringpool.hpp"
+#include "../src/commandlines.hpp"
 
 using namespace util;
 using namespace stringtools;
@@ -19,6 +24,34 @@ int main(){
   SetConsoleOutputCP(CP_UTF8);
   SetConsoleCP(CP_UTF8);
   
+  msg("string pool trimming");
+  
+  // NOTA: first test => no other object refers to the pool
+  // one-shot candidates (eg the values of a large column in introspection)
+  // are released once no object refers to them
+  const size_t pool_max_size = 50000;
+  for(int iter = 0 ; iter < 4 ; ++iter){
+    {
+      // the first letter differs at each iteration (the index buckets by first letter)
+      const string prefix = string(1, 'a' + iter) + "_value_";
+      vector<string> values(200000);
+      for(size_t i = 0 ; i < values.size() ; ++i){
+        values[i] = prefix + std::to_string(i);
+      }
+      
+      // same ids at each iteration: the index of the previous generation must not be reused
+      MetaStringVec column(values);
+      StringMatch res = string_match(prefix + "1234", column);
+      test_eq_str(res.string_at(0), prefix + "1234");
+      
+      // in use: not cleared
+      test_eq(trim_string_pool(pool_max_size), false);
+    }
+    
+    test_eq(trim_string_pool(pool_max_size), true);
+    test_eq(get_string_pool().size() <= pool_max_size, true);
+  }
+  
   msg("delete_until");
   
   string x = "bonjour    les gens";
@@ -54,13 +87,21 @@ int main(){
   msg("stpli at width");
   
   string m = VTS::FG_BRIGHT_BLUE + "Bonjour Bergé" + VTS::FG_BRIGHT_GREEN + " et Marlène!" + VTS::FG_DEFAULT;
-  vector<string> m_7 = str_split_at_width(m, 7);
+  vector<std::string_view> m_7 = str_split_at_width(m, 7);
   
   std::cout << m << "\nSplit at 7 chars:\n";
   for(auto &s : m_7){
     std::cout << "\"" << s << "\"\n";
   }
   
+  // the lines are views on m, the VTS are kept
+  test_eq(m_7.size(), 4u);
+  test_eq(m_7[0].data() == m.data(), true);
+  test_eq_str(clean_VTS_markup(m_7[1]), " Bergé ");
+  test_eq_str(string(m_7[3]), "ène!" + VTS::FG_DEFAULT);
+  test_eq(size_no_vts(m), 25u);
+  test_eq_str(clean_VTS_markup(m), "Bonjour Bergé et Marlène!");
+  
   msg("shorten");
   
   vector<string> lb = {"laurent", "robert", "bergé"};
@@ -69,6 +110,340 @@ int main(){
     std::cout << "\"" << s << "\"\n";
   }
   
+  msg("character classes");
+  
+  // the table must give the same results as the definitions
+  for(const string &valid : {string("._"), string("_"), string("._$")}){
+    set_valid_word_char(valid);
+    for(uint i = 0 ; i < 256 ; ++i){
+      const uchar c = i;
+      const bool is_punct = (c >= 32 && c <= 47) || (c >= 58 && c <= 64) || (c >= 91 && c <= 96) || (c >= 123 && c <= 126);
+      const bool is_control_ref = is_punct && valid.find(c) == string::npos;
+      test_eq(is_control_char(c), is_control_ref);
+      test_eq(is_starting_word_char(c), !is_control_ref && !is_digit(c));
+      test_eq(is_paren(c), string("()[]{}").find(c) != string::npos && c != 0);
+    }
+  }
+  set_valid_word_char("._");
+  
+  // the word jumps of the default version do not use "."
+  test_eq(word_jump_default("read.csv(x)", 0, SIDE::RIGHT), 4u);
+  test_eq(word_jump("read.csv(x)", 0, SIDE::RIGHT), 8u);
+  test_eq(is_word_char('.'), true);
+  
+  msg("string_utf8");
+  
+  // long line: the translations use the checkpoints
+  string_utf8 long_line;
+  for(int i = 0 ; i < 1000 ; ++i){
+    long_line.push_back("x, é");
+  }
+  test_eq(long_line.size(), 4000u);
+  test_eq(long_line.wide_to_narrow_index(2001), 2501u);
+  test_eq(long_line.narrow_to_wide_index(2501), 2001u);
+  
+  long_line.insert(1000, "€€");
+  test_eq(long_line.wide_to_narrow_index(2003), 2507u);
+  test_eq_str(long_line.at(1001), "€");
+  test_eq_str(long_line.substr(1000, 3), "€€x");
+  
+  long_line.erase(0, 3000);
+  test_eq(long_line.size(), 1002u);
+  test_eq_str(long_line.substr(0, 3), " éx");
+  
+  // back to ASCII: no translation
+  string_utf8 ascii_line("é_abc");
+  ascii_line.erase(0, 1);
+  test_eq(ascii_line.narrow_to_wide_index(3), 3u);
+  
+  msg("command lines");
+  
+  // the lines are stored in blocks: we compare with a vector
+  CommandLines cmd_lines;
+  CommandTextView cmd_text(&cmd_lines);
+  CommandQuoteView cmd_quotes(&cmd_lines);
+  vector<string> cmd_ref = {""};
+  for(int i = 0 ; i < 3000 ; ++i){
+    const uint pos = (i * 7919u) % (cmd_ref.size() + 1);
+    cmd_lines.insert(pos, {string_utf8("line " + std::to_string(i)), "", '"'});
+    cmd_ref.insert(cmd_ref.begin() + pos, "line " + std::to_string(i));
+    if(i % 3 == 0){
+      const uint pos_del = (i * 104729u) % cmd_ref.size();
+      cmd_lines.erase(pos_del);
+      cmd_ref.erase(cmd_ref.begin() + pos_del);
+    }
+  }
+  test_eq(cmd_lines.size(), static_cast<uint>(cmd_ref.size()));
+  for(uint i = 0 ; i < cmd_ref.size() ; ++i){
+    test_eq_str(cmd_text[i].str(), cmd_ref[i]);
+  }
+  
+  // bulk insertion, in the middle
+  vector<CommandLine> all_pasted(500);
+  for(int i = 0 ; i < 500 ; ++i){
+    all_pasted[i].text = string_utf8("pasted " + std::to_string(i));
+  }
+  cmd_lines.insert(1000, std::move(all_pasted));
+  test_eq(cmd_lines.size(), static_cast<uint>(cmd_ref.size() + 500));
+  test_eq_str(cmd_text[999].str(), cmd_ref[999]);
+  test_eq_str(cmd_text[1000].str(), "pasted 0");
+  test_eq_str(cmd_text[1499].str(), "pasted 499");
+  test_eq_str(cmd_text[1500].str(), cmd_ref[1000]);
+  test_eq(cmd_quotes[1000], NOT_A_QUOTE);
+  test_eq_str(cmd_text.back().str(), cmd_ref.back());
+  
+  cmd_lines.reset();
+  test_eq(cmd_lines.size(), 1u);
+  test_eq(cmd_text[0].size(), 0u);
+  
+  msg("paren index");
+  
+  // the parens within quotes are ignored, the index follows the edits
+  string_utf8 code("f(x, \")\", g(y[1]))");
+  ParenMatcher paren_first(code, 1);
+  test_eq(paren_first.pair_found, true);
+  test_eq(paren_first.i_end, 17u);
+  test_eq(is_open_paren_left(code.paren_index(), 17, ']'), false);
+  test_eq(is_open_paren_left(code.paren_index(), 15, ']'), true);
+  test_eq(contextual_selection(code, 6, 6)[1], 7u);
+  test_eq(contextual_selection(code, 13, 13)[0], 12u);
+  test_eq(contextual_selection(code, 13, 13)[1], 16u);
+  
+  code.insert(0, "é <- ");
+  test_eq(ParenMatcher(code, 22).i_start, 7u);
+  test_eq(any_open_paren_before(code, '(', 14), true);
+  test_eq(any_open_paren_before(code, '[', 19), true);
+  // mismatched parens: a closing paren of another type does not close the open one
+  test_eq(any_open_paren_before(string("f(a]"), '('), true);
+  test_eq(any_open_paren_before(string("f[a)"), ']'), true);
+  test_eq(any_open_paren_before(string("f(a)]"), '('), false);
+  test_eq(any_open_paren_before(string("f(a[b)"), '('), false);
+  code.erase(15, 2);
+  test_eq_str(code.str(), "é <- f(x, \")\", y[1]))");
+  test_eq(go_to_next_inner_paren(code, 0, false), 7u);
+  test_eq(go_to_next_inner_paren(code, 7, false), 17u);
+  
+  msg("misspell");
+
+  uint32_t span_start = 0, span_end = 0;
+  MisspellMatcher sumary("sumary", 1);
+  test_eq(sumary.match("summary", span_start, span_end), true);
+  test_eq(span_start, 0u);
+  test_eq(span_end, 7u);
+  
+  // transposition, the first letter must match
+  test_eq(MisspellMatcher("smumary", 1).match("base::summary", span_start, span_end), true);
+  test_eq(span_start, 6u);
+  test_eq(MisspellMatcher("qummary", 1).match("summary", span_start, span_end), false);
+  
+  // 3 letters queries
+  test_eq(MisspellMatcher("lsi", 1).match("list", span_start, span_end), true);
+  
+  // 2 edits
+  test_eq(MisspellMatcher("sumarry", 1).match("my_summary", span_start, span_end), false);
+  test_eq(MisspellMatcher("sumarry", 2).match("my_summary", span_start, span_end), true);
+  
+  msg("string_match with index");
+  
+  // the index must not change the results: we compare with the brute force
+  vector<string> stems = {"read", "write", "data", "frame", "Table", "csv", "plot", "est",
+                          "feols", "summary", "as", "is", "na", "omit", "list", "char"};
+  vector<string> seps = {".", "_", ""};
+  vector<string> all_choices;
+  for(auto &s1 : stems){
+    for(auto &sep : seps){
+      for(auto &s2 : stems){
+        all_choices.push_back(s1 + sep + s2);
+      }
+    }
+  }
+  
+  vector<string> all_queries = {"r", "re", "rea", "Rea", "dat", "dtaa", "frmae", "readcsv", 
+                                "read csv", "tabl wrte", "Tab", "summry", "om na", "frame.list",
+                                "fe", "sumary list", "na as", "t re", "is.na ch"};
+  
+  const size_t min_size_origin = MatchIndex::min_size;
+  for(auto &q : all_queries){
+    MatchIndex::min_size = static_cast<size_t>(-1);
+    vector<string> res_brute = string_match(q, all_choices).get_matches();
+    
+    MatchIndex::min_size = 1;
+    vector<string> res_index = string_match(q, all_choices).get_matches();
+    
+    test_eq_vec_str(res_index, res_brute);
+  }
+  MatchIndex::min_size = min_size_origin;
+  
+  msg("string_match narrowing");
+  
+  // typing + backspaces: the stack must give the same results as a full match
+  vector<string> all_typed = {"r", "re", "rea", "read", "read.", "read.c", "read.", "read", 
+                              "readT", "readTa", "read", "read ", "read c", "read cs", "fr"};
+  StringMatchStack match_stack;
+  for(auto &q : all_typed){
+    vector<string> res_full = string_match(q, all_choices).get_matches();
+    vector<string> res_stack = match_stack.match(q, all_choices).get_matches();
+    
+    test_eq_vec_str(res_stack, res_full);
+  }
+  
+  // same ids, new meta information: the stack returns the new one
+  MetaStringVec choices_v1(vector<string>{"plot", "print", "paste"});
+  choices_v1.set_meta("labels", vector<string>{"{v1}", "{v1}", "{v1}"});
+  MetaStringVec choices_v2(vector<string>{"plot", "print", "paste"});
+  choices_v2.set_meta("labels", vector<string>{"{v2}", "{v2}", "{v2}"});
+  StringMatchStack meta_stack;
+  meta_stack.match("pl", choices_v1);
+  test_eq_str(meta_stack.match("pl", choices_v2).meta_at("labels", 0), "{v2}");
+  meta_stack.match("", choices_v1);
+  test_eq_str(meta_stack.match("", choices_v2).meta_at("labels", 0), "{v2}");
+  
+  msg("string_match as a view on the choices");
+  
+  // the matches are read from the choices: strings, meta and match info
+  MetaStringVec choices_meta(vector<string>{"plot", "summary", "barplot", "print"});
+  choices_meta.set_meta("labels", vector<string>{"{graphics}", "{base}", "{graphics}", "{base}"});
+  StringMatch view = string_match("plot", choices_meta);
+  test_eq(view.size(), 2u);
+  test_eq_vec_str(view.get_matches(), {"plot", "barplot"});
+  test_eq_vec_str(view.get_meta_vector("labels"), {"{graphics}", "{graphics}"});
+  test_eq_str(view.meta_at("labels", 1), "{graphics}");
+  test_eq_str(view.at(1).string_at(0), "barplot");
+  test_eq(view.id_at(1), 2u);
+  test_eq(view.match_info_at(1).start_at(0), 3u);
+  test_eq(view.match_info_at(1).end_at(0), 7u);
+  
+  // filtering the matches: still a view on the choices
+  StringMatch view_filtered = view;
+  view_filtered.select({1});
+  test_eq_vec_str(view_filtered.get_matches(), {"barplot"});
+  test_eq(view_filtered.id_at(0), 2u);
+  test_eq(view_filtered.match_info_at(0).start_at(0), 3u);
+  test_eq(view.size(), 2u);
+  
+  msg("selection views");
+  
+  // the selections compose, the copies are never modified
+  MetaStringVec choices_sel = choices_meta;
+  choices_sel.select(vector<uint>{3, 2, 0});
+  test_eq(choices_sel.is_view(), true);
+  test_eq_vec_str(choices_sel.meta("labels"), {"{base}", "{graphics}", "{graphics}"});
+  choices_sel.select(vector<uint>{2, 1});
+  test_eq_vec_str(choices_sel.get_string_vec(), {"plot", "barplot"});
+  test_eq_str(choices_sel.meta_at("labels", 1), "{graphics}");
+  
+  choices_sel.set_meta("labels", vector<string>{"{a}", "{b}"});
+  test_eq(choices_sel.is_view(), false);
+  test_eq_vec_str(choices_meta.meta("labels"), {"{graphics}", "{base}", "{graphics}", "{base}"});
+  
+  MetaStringVec choices_grown = choices_meta;
+  choices_grown.push_back(choices_sel);
+  test_eq(choices_grown.size(), 6u);
+  test_eq(choices_meta.size(), 4u);
+  test_eq_str(choices_grown.meta_at("labels", 5), "{b}");
+  
+  msg("concatenation");
+  
+  // several vectors at once, possibly the object itself, none is modified
+  MetaStringVec funs_ls(vector<string>{"my_fun"});
+  MetaStringVec funs_exports(vector<string>{"lm", "glm"});
+  funs_exports.set_meta("finalize", "function", Meta::SCALAR_TYPE::NO_INHERIT);
+  MetaStringVec funs_none;
+  funs_none.set_cause_empty("no package");
+  MetaStringVec all_funs;
+  all_funs.concat({&funs_ls, &funs_none, &funs_exports});
+  all_funs.concat({&all_funs, &funs_ls});
+  test_eq_vec_str(all_funs.get_string_vec(), {"my_fun", "lm", "glm", "my_fun", "lm", "glm", "my_fun"});
+  test_eq_vec_str(all_funs.meta("finalize"), {"", "function", "function", "", "function", "function", ""});
+  test_eq_str(all_funs.get_cause_empty(), "no package");
+  test_eq(funs_ls.size(), 1u);
+  test_eq(funs_ls.has_meta("finalize"), false);
+  
+  msg("string pool");
+  
+  // interned strings: same string <=> same id, the views never move
+  StringPool &pool = get_string_pool();
+  const uint32_t id_plot = pool.intern("plot");
+  std::string_view view_plot = pool.view(id_plot);
+  for(int i = 0 ; i < 100000 ; ++i){
+    pool.intern("tmp_" + std::to_string(i));
+  }
+  test_eq(pool.intern(string("plot")), id_plot);
+  test_eq_str(string(view_plot), "plot");
+  test_eq(choices_meta.get_ids()[0], id_plot);
+  
+  MetaStringVec pkgs(vector<string>{"base", "stats"});
+  MetaStringVec pkgs_colon = pkgs.copy();
+  pkgs_colon.add_suffix("::");
+  test_eq_vec_str(pkgs_colon.get_string_vec(), {"base::", "stats::"});
+  test_eq_vec_str(pkgs.get_string_vec(), {"base", "stats"});
+  
+  msg("meta columns");
+  
+  // typed columns, read as strings
+  MetaStringVec paths(vector<string>{"src/", "README.md", "tests/"});
+  paths.set_meta("continue", vector<bool>{true, false, true});
+  paths.set_meta("cursor_shift", vector<int>{-1, 0, -1});
+  paths.set_meta("is_char", true);
+  test_eq(paths.get_meta().get_type(paths.get_meta().get_key_pos("continue")) == META_TYPE::BOOL, true);
+  test_eq_vec_str(paths.meta("continue"), {"true", "false", "true"});
+  test_eq_str(paths.meta_at("cursor_shift", 2), "-1");
+  test_eq_str(paths.meta_at("is_char", 1), "true");
+  
+  // bind: missing values, inherited scalars, mixed types
+  MetaStringVec other(vector<string>{"data/"});
+  other.set_meta("labels", vector<string>{"{dir}"});
+  other.set_meta("cursor_shift", vector<string>{"-3"});
+  other.set_meta("is_char", true);
+  paths.push_back(other);
+  test_eq(paths.size(), 4u);
+  test_eq_vec_str(paths.meta("continue"), {"true", "false", "true", "false"});
+  test_eq_vec_str(paths.meta("labels"), {"", "", "", "{dir}"});
+  test_eq_vec_str(paths.meta("cursor_shift"), {"-1", "0", "-1", "-3"});
+  test_eq(paths.get_meta().get_type(paths.get_meta().get_key_pos("cursor_shift")) == META_TYPE::STRING, true);
+  test_eq_str(paths.meta_at("is_char", 3), "true");
+  
+  paths.select(vector<uint>{3, 0});
+  test_eq_vec_str(paths.get_string_vec(), {"data/", "src/"});
+  test_eq_vec_str(paths.meta("continue"), {"false", "true"});
+  test_eq_vec_str(paths.get_meta().get_row(1), {"true", "-1", "true", ""});
+  
+  
+  msg("spell dictionary");
+  
+  test_eq_vec_str(split_tokens("base::requireNamespace"), {"base", "requirenamespace"});
+  
+  SpellDictionary dict(identifier_tokens({"summary", "read.csv", "write_csv", "requireNamespace"}), 1);
+  vector<uint32_t> all_corr = dict.lookup("sumary", 1);
+  test_eq(all_corr.size(), 1u);
+  test_eq_str(dict.word_at(all_corr[0]), "summary");
+  test_eq(dict.lookup("requireNmsepace", 1).size(), 0u);
+  test_eq(dict.lookup("requireNmsepace", 2).size(), 0u);
+  
+  std::shared_ptr<const SpellDictionary> pdict = SpellDictionary::from_lines(dict.to_lines());
+  test_eq(pdict != nullptr, true);
+  test_eq(pdict->lookup("raed", 1).size(), 1u);
+  
+  // the correction tier: the token is highlighted
+  set_spell_dictionary(pdict);
+  StringMatch corr = string_match("raed", vector<string>{"bread", "readr::read_csv"});
+  test_eq_vec_str(corr.get_matches(), {"readr::read_csv", "bread"});
+  test_eq(corr.tier_at(0) == MATCH_TIER::CORRECTION, true);
+  test_eq(corr.match_info_at(0).start_at(0), 7u);
+  test_eq(corr.match_info_at(0).end_at(0), 11u);
+  
+  set_spell_dictionary(std::make_shared<const SpellDictionary>(identifier_tokens(all_choices), 1));
+  for(auto &q : {"sumary", "rade", "raed", "lisst", "plto", "Frmae"}){
+    MatchIndex::min_size = static_cast<size_t>(-1);
+    vector<string> res_brute = string_match(q, all_choices).get_matches();
+    
+    MatchIndex::min_size = 1;
+    vector<string> res_index = string_match(q, all_choices).get_matches();
+    
+    test_eq_vec_str(res_index, res_brute);
+  }
+  MatchIndex::min_size = min_size_origin;
+  set_spell_dictionary(nullptr);
   
   msg("tests perfomed successfully");
   
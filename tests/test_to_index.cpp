@@ -4,6 +4,7 @@
 #include <iostream>
 #include <stdint.h>
 #include <vector>
+#include <random>
 
 using std::vector;
 
@@ -38,6 +39,62 @@ int main(){
   print_vector(index.get_index());
   print_vector(index.get_first_obs());
   
+  std::cout << "\nStrings, with a hash where everything collides\n";
+  vector<std::string> x_str = {"plot", "lm", "plot", "glm", "lm", "lm"};
+  auto same_hash = [](const std::string &){ return static_cast<uint64_t>(42); };
+  index = to_index(x_str, to_indexOpts().table(), same_hash);
+  print_vector(index.get_index());
+  print_vector(index.get_table());
+  util::test_eq(index.get_first_obs().size(), 3u);
+  util::test_eq(index.get_index()[5], 1u);
+  util::test_eq(index.get_table()[1], 3u);
+  
+  std::cout << "\nComposite keys\n";
+  vector<std::pair<std::string, int>> x_pair = {{"a", 1}, {"a", 2}, {"b", 1}, {"a", 1}};
+  index = to_index(x_pair, to_indexOpts().reverse());
+  print_vector(index.get_index());
+  util::test_eq(index.get_index()[0], index.get_index()[3]);
+  util::test_eq(index.get_first_obs()[0], 3u);
+  
+  vector<vector<std::string>> x_lines = {{"f <- function(x){", "}"}, {"f <- function(x){"}, 
+                                         {"f <- function(x){", "}"}};
+  util::test_eq(to_index(x_lines).get_first_obs().size(), 2u);
+  
+  std::cout << "\nParallel version\n";
+  get_worker_pool().resize(4);
+  std::mt19937_64 gen(1);
+  vector<uint64_t> x_large(200000);
+  for(auto &v : x_large){
+    v = gen() % 5000;
+  }
+  
+  auto test_same = [](const IndexInfo &a, const IndexInfo &b){
+    util::test_eq(a.get_index() == b.get_index(), true);
+    util::test_eq(a.get_first_obs() == b.get_first_obs(), true);
+    util::test_eq(a.get_table() == b.get_table(), true);
+  };
+  
+  test_same(to_index_serial(x_large, to_indexOpts().table()),
+            to_index_parallel(x_large, to_indexOpts().table()));
+  test_same(to_index_serial(x_large, to_indexOpts().table().reverse()),
+            to_index_parallel(x_large, to_indexOpts().table().reverse()));
+  
+  // a weak hash: all the keys fall in the same partition
+  auto weak_hash = [](const uint64_t &v){ return v % 97; };
+  test_same(to_index_serial(x_large, to_indexOpts().table(), weak_hash),
+            to_index_parallel(x_large, to_indexOpts().table(), weak_hash));
+  
+  // fewer keys than chunks
+  test_same(to_index_serial(x), to_index_parallel(x));
+  test_same(to_index_serial(x_str, to_indexOpts().reverse()),
+            to_index_parallel(x_str, to_indexOpts().reverse()));
+  
+  set_to_index_parallel_min_size(0);
+  test_same(to_index(x_lines, to_indexOpts().table()),
+            to_index_serial(x_lines, to_indexOpts().table()));
+  
+  std::cout << "\ntests perfomed successfully\n";
+  
   return 0;
 }
 